@@ -31,22 +31,16 @@ SOFTWARE.
 #include <unistd.h> // access
 #include <math.h> // sqrt
 
-#include "khash.h"
 #include "BFSseed.h"
+#include "ctggraph.h"
 #include "hitseeds.h"
 #include "graphtools.h"
 #include "log.h"
 #include "misc.h"
 
 
-typedef struct {
-    int* node3;
-    int num3;
-    int* node5;
-    int num5;
-} nodeArr;
-
-KHASH_MAP_INIT_INT(Ha_node, nodeArr)
+#define bit_get(b, x) ((b)[(x) >> 6] >> ((x) & 63) & 1)
+#define bit_set(b, x) ((b)[(x) >> 6] |= 1ULL << ((x) & 63))
 
 static void BFSmain(const char* type, int num_links, int num_ctg, Ctglinks* ctglinks, CtgDepth* ctgdepth, 
             int* num_dynseeds, int** dynseeds, float nucl_depth , float filter_depth);
@@ -55,35 +49,21 @@ static void BFSmain(const char* type, int num_links, int num_ctg, Ctglinks* ctgl
 void BFSseeds(const char* type, int num_links, int num_ctg, Ctglinks* ctglinks, CtgDepth* ctgdepth, 
             int* num_dynseeds, int** dynseeds, float nucl_depth, float filter_depth, BFSlinks** bfslinks, int* num_bfslinks) {
     
-    clock_t start, end;
-    int tm = 1;
-    
     log_message(INFO, "BFS algorithm starts...");
     log_info("        num\n");
     log_info("  times seeds\n");
     log_info("-------------\n");
-    while (1) {
-        int temp_num_dynseeds = *num_dynseeds;
-        start = clock();
-        log_info("  No.%-3d %-4d| ", tm, *num_dynseeds);
-        BFSmain(type, num_links, num_ctg, ctglinks, ctgdepth, num_dynseeds, dynseeds, nucl_depth, filter_depth);
-        end = clock();
-        tm++;
-        log_info(" %.2fs\n", (double)(end - start) / CLOCKS_PER_SEC);
-        if (tm > 100) {
-            log_message(ERROR, "BFS algorithm ends abnormally.");
-            exit(EXIT_FAILURE);
-        }
-        if (temp_num_dynseeds == *num_dynseeds) {
-            break;
-        }
-    }
+    BFSmain(type, num_links, num_ctg, ctglinks, ctgdepth, num_dynseeds, dynseeds, nucl_depth, filter_depth);
     log_info("-------------\n");
     
     uint64_t i, j;
+    uint64_t* in_seeds = calloc((num_ctg >> 6) + 1, sizeof(uint64_t));
+    for (i = 0; i < *num_dynseeds; i++) {
+        bit_set(in_seeds, (*dynseeds)[i] - 1);
+    }
     for (i = 0; i < num_links; i++) {
-        if (findint(*dynseeds, *num_dynseeds, ctglinks[i].lctg) == 1 && 
-            findint(*dynseeds, *num_dynseeds, ctglinks[i].rctg) == 1 &&
+        if (bit_get(in_seeds, ctglinks[i].lctg - 1) && 
+            bit_get(in_seeds, ctglinks[i].rctg - 1) &&
             ctglinks[i].linkdepth > 0.3*MIN(ctgdepth[ctglinks[i].lctg - 1].depth, ctgdepth[ctglinks[i].rctg - 1].depth)) 
         {
             (*bfslinks) = realloc(*bfslinks, (*num_bfslinks + 1)*sizeof(BFSlinks));
@@ -105,102 +85,55 @@ void BFSseeds(const char* type, int num_links, int num_ctg, Ctglinks* ctglinks,
             (*num_bfslinks)++;
         }
     }
+    free(in_seeds);
 
     while (*num_bfslinks > 0 && *num_dynseeds > 0) {
         /* Remove the bubbles （contg length <= 50bp）*/
-        khash_t(Ha_node) *node_hash = kh_init(Ha_node);
-
-        for (i = 0; i < *num_dynseeds; i++) 
-        {
-            nodeArr node_arr;
-            node_arr.num3 = 0;
-            node_arr.num5 = 0;
-            node_arr.node3 = (int*) malloc((*num_dynseeds + 1)*sizeof(int));
-            node_arr.node5 = (int*) malloc((*num_dynseeds + 1)*sizeof(int));
-
-            int ret;
-            khint_t k = kh_put(Ha_node, node_hash, (*dynseeds)[i], &ret);
-
-            for (j = 0; j < *num_bfslinks; j++) 
-            {
-                if ((*bfslinks)[j].lctgsmp == (*dynseeds)[i]) {
-                    if ((*bfslinks)[j].lutrsmp == 3) {
-                        node_arr.node3[node_arr.num3] = (*bfslinks)[j].rctgsmp;
-                        node_arr.num3++;
-                    } else if ((*bfslinks)[j].lutrsmp == 5) {
-                        node_arr.node5[node_arr.num5] = (*bfslinks)[j].rctgsmp;
-                        node_arr.num5++;
-                    } else {
-                        log_message(ERROR, "Wrong link type: %d", (*bfslinks)[j].lutrsmp);
-                    }
-                } else if ((*bfslinks)[j].rctgsmp == (*dynseeds)[i]) {
-                    if ((*bfslinks)[j].rutrsmp == 3) {
-                        node_arr.node3[node_arr.num3] = (*bfslinks)[j].lctgsmp;
-                        node_arr.num3++;
-                    } else if ((*bfslinks)[j].rutrsmp == 5) {
-                        node_arr.node5[node_arr.num5] = (*bfslinks)[j].lctgsmp;
-                        node_arr.num5++;
-                    } else {
-                        log_message(ERROR, "Wrong link type: %d", (*bfslinks)[j].rutrsmp);
-                    }
-                }
-            }
-            kh_value(node_hash, k) = node_arr;
-        }
-
-        int* del_node = (int*) malloc((*num_dynseeds + 1)*sizeof(int));
+        CtgGraph* graph = ctggraph_build(*bfslinks, *num_bfslinks, *dynseeds, *num_dynseeds);
+        uint64_t* del_node = calloc((num_ctg >> 6) + 1, sizeof(uint64_t));
         int del_num = 0;
 
         for (i = 0; i < *num_dynseeds; i++) 
         {
-            if (ctgdepth[(*dynseeds)[i] - 1].len <= 50) {
-                nodeArr temp_node_arr = kh_value(node_hash, kh_get(Ha_node, node_hash, (*dynseeds)[i]));
-                if (temp_node_arr.num3 == 1 && temp_node_arr.num5 == 1) {
-                    nodeArr temp_node_arr3 = kh_value(node_hash, kh_get(Ha_node, node_hash, temp_node_arr.node3[0]));
-                    nodeArr temp_node_arr5 = kh_value(node_hash, kh_get(Ha_node, node_hash, temp_node_arr.node5[0]));
-                    if (
-                        ((findint(temp_node_arr3.node3, temp_node_arr3.num3, (*dynseeds)[i]) == 1 && findint(temp_node_arr3.node3, temp_node_arr3.num3, temp_node_arr.node5[0]) == 1) ||
-                        (findint(temp_node_arr3.node5, temp_node_arr3.num5, (*dynseeds)[i]) == 1 && findint(temp_node_arr3.node5, temp_node_arr3.num5, temp_node_arr.node5[0]) == 1)) &&
-
-                        ((findint(temp_node_arr5.node3, temp_node_arr5.num3, (*dynseeds)[i]) == 1 && findint(temp_node_arr5.node3, temp_node_arr5.num3, temp_node_arr.node3[0]) == 1) ||
-                        (findint(temp_node_arr5.node5, temp_node_arr5.num5, (*dynseeds)[i]) == 1 && findint(temp_node_arr5.node5, temp_node_arr5.num5, temp_node_arr.node3[0]) == 1))
-                        
-                    ) {
-                        del_node[del_num] = (*dynseeds)[i];
-                        del_num++;
-                    }
-                }
+            int node = graph->node[(*dynseeds)[i]];
+            int end3 = CG_END(node, 3);
+            int end5 = CG_END(node, 5);
+            if (ctgdepth[(*dynseeds)[i] - 1].len > 50 || 
+                ctggraph_degree(graph, end3) != 1 || ctggraph_degree(graph, end5) != 1) continue;
+
+            /* x is a bubble when its only neighbours y and z are linked on the same ends as x */
+            int node3 = CG_NODE(graph->nbr[graph->off[end3]]);
+            int node5 = CG_NODE(graph->nbr[graph->off[end5]]);
+            if (node3 == node || node5 == node) continue;
+            if (
+                ((ctggraph_has(graph, CG_END(node3, 3), node) && ctggraph_has(graph, CG_END(node3, 3), node5)) ||
+                (ctggraph_has(graph, CG_END(node3, 5), node) && ctggraph_has(graph, CG_END(node3, 5), node5))) &&
+
+                ((ctggraph_has(graph, CG_END(node5, 3), node) && ctggraph_has(graph, CG_END(node5, 3), node3)) ||
+                (ctggraph_has(graph, CG_END(node5, 5), node) && ctggraph_has(graph, CG_END(node5, 5), node3)))
+            ) {
+                bit_set(del_node, (*dynseeds)[i] - 1);
+                del_num++;
             }
         }
+        ctggraph_free(graph);
 
-        for (i = 0; i < *num_dynseeds; i++) {
-            nodeArr temp_node_arr = kh_value(node_hash, kh_get(Ha_node, node_hash, (*dynseeds)[i]));
-            if (temp_node_arr.node3 != NULL) {
-                free(temp_node_arr.node3);
-                temp_node_arr.node3 = NULL;
-            }
-            if (temp_node_arr.node5 != NULL) {
-                free(temp_node_arr.node5);
-                temp_node_arr.node5 = NULL;
+        if (del_num > 0) {
+            int temp_num = 0;
+            for (i = 0; i < *num_dynseeds; i++) {
+                if (!bit_get(del_node, (*dynseeds)[i] - 1)) (*dynseeds)[temp_num++] = (*dynseeds)[i];
             }
-        }
-        kh_destroy(Ha_node, node_hash);
+            *num_dynseeds = temp_num;
 
-        if (del_num > 0) {
-            for (i = 0; i < del_num; i++) 
+            temp_num = 0;
+            for (j = 0; j < *num_bfslinks; j++) 
             {
-                remove_element(*dynseeds, num_dynseeds, del_node[i]);
-                int temp_num_bfslinks = 0;
-
-                for (j = 0; j < *num_bfslinks; j++) 
-                {
-                    if ((*bfslinks)[j].lctgsmp != del_node[i] && (*bfslinks)[j].rctgsmp != del_node[i]) {
-                        (*bfslinks)[temp_num_bfslinks] = (*bfslinks)[j];
-                        temp_num_bfslinks++;
-                    }
+                if (!bit_get(del_node, (*bfslinks)[j].lctgsmp - 1) && !bit_get(del_node, (*bfslinks)[j].rctgsmp - 1)) {
+                    (*bfslinks)[temp_num] = (*bfslinks)[j];
+                    temp_num++;
                 }
-                *num_bfslinks = temp_num_bfslinks;
             }
+            *num_bfslinks = temp_num;
         }
 
         free(del_node);
@@ -212,45 +145,125 @@ void BFSseeds(const char* type, int num_links, int num_ctg, Ctglinks* ctglinks,
 }
 
 
+/* min-heap of sweep << 32 | link index */
+static void heap_push(uint64_t** heap, int* n, int* m, uint64_t x) {
+    if (*n == *m) {
+        *m = *m ? *m << 1 : 256;
+        *heap = realloc(*heap, *m * sizeof(uint64_t));
+    }
+    int c = (*n)++;
+    while (c > 0 && (*heap)[(c - 1) >> 1] > x) {
+        (*heap)[c] = (*heap)[(c - 1) >> 1];
+        c = (c - 1) >> 1;
+    }
+    (*heap)[c] = x;
+}
+
+static uint64_t heap_pop(uint64_t* heap, int* n) {
+    uint64_t top = heap[0], x = heap[--(*n)];
+    int c = 0;
+    while (2 * c + 1 < *n) {
+        int k = 2 * c + 1;
+        if (k + 1 < *n && heap[k + 1] < heap[k]) k++;
+        if (heap[k] >= x) break;
+        heap[c] = heap[k];
+        c = k;
+    }
+    heap[c] = x;
+    return top;
+}
+
+/* 
+ * Grow the seeds to a fixed point over the well-supported links. Seeds are 
+ * appended in the order of repeated sweeps over ctglinks (a contig found at 
+ * link i is followed up by the links after i in the same sweep and by the 
+ * others in the next one), but each link is only visited when one of its 
+ * contigs has just joined, through a per-contig adjacency index.
+ */
 static void BFSmain(const char* type, int num_links, int num_ctg, Ctglinks* ctglinks, CtgDepth* ctgdepth, 
             int* num_dynseeds, int** dynseeds, float nucl_depth, float filter_depth) {
 
-    int progress_step = num_links / 36;
-    if (progress_step == 0) {
-        progress_step = 1;
-    }
+    uint64_t i, j;
+    clock_t start = clock();
 
-    uint64_t i;
+    /* adjacency of the links passing the depth filters */
+    int* adj_off = calloc(num_ctg + 2, sizeof(int));
     for (i = 0; i < num_links; i++) {
         if (ctgdepth[ctglinks[i].lctg - 1].depth > filter_depth && 
             ctgdepth[ctglinks[i].rctg - 1].depth > filter_depth &&
             ctglinks[i].linkdepth > 0.5*MIN(ctgdepth[ctglinks[i].lctg - 1].depth, ctgdepth[ctglinks[i].rctg - 1].depth)) 
         {
-            // log_info("link %d: %s %d %s %g\n", ctglinks[i].lctg, ctglinks[i].lutr, ctglinks[i].rctg, ctglinks[i].rutr, ctglinks[i].linkdepth);
-            // log_info("depth of %s: %g\n", ctgdepth[ctglinks[i].lctg - 1].ctg, ctgdepth[ctglinks[i].lctg - 1].depth);
-            // log_info("depth of %s: %g\n", ctgdepth[ctglinks[i].rctg - 1].ctg, ctgdepth[ctglinks[i].rctg - 1].depth);
+            adj_off[ctglinks[i].lctg + 1]++;
+            if (ctglinks[i].rctg != ctglinks[i].lctg) adj_off[ctglinks[i].rctg + 1]++;
+        }
+    }
+    for (i = 1; i <= num_ctg + 1; i++) adj_off[i] += adj_off[i - 1];
+    int* adj = malloc((adj_off[num_ctg + 1] + 1) * sizeof(int));
+    int* adj_n = calloc(num_ctg + 1, sizeof(int));
+    for (i = 0; i < num_links; i++) {
+        if (ctgdepth[ctglinks[i].lctg - 1].depth > filter_depth && 
+            ctgdepth[ctglinks[i].rctg - 1].depth > filter_depth &&
+            ctglinks[i].linkdepth > 0.5*MIN(ctgdepth[ctglinks[i].lctg - 1].depth, ctgdepth[ctglinks[i].rctg - 1].depth)) 
+        {
+            int l = ctglinks[i].lctg, r = ctglinks[i].rctg;
+            adj[adj_off[l] + adj_n[l]++] = i;
+            if (r != l) adj[adj_off[r] + adj_n[r]++] = i;
+        }
+    }
+    free(adj_n);
+
+    uint64_t* in_seeds = calloc((num_ctg >> 6) + 1, sizeof(uint64_t));
+    int seeds_m = *num_dynseeds > 0 ? *num_dynseeds : 1;
+    uint64_t* heap = NULL;
+    int heap_n = 0, heap_m = 0;
+    for (i = 0; i < *num_dynseeds; i++) {
+        int ctg = (*dynseeds)[i];
+        if (bit_get(in_seeds, ctg - 1)) continue;
+        bit_set(in_seeds, ctg - 1);
+        for (j = adj_off[ctg]; j < adj_off[ctg + 1]; j++) heap_push(&heap, &heap_n, &heap_m, adj[j]);
+    }
 
-            if (findint(*dynseeds, *num_dynseeds, ctglinks[i].lctg) == 1 &&
-                findint(*dynseeds, *num_dynseeds, ctglinks[i].rctg) == 0) 
-            {
-                *num_dynseeds += 1;
-                *dynseeds = realloc(*dynseeds, (*num_dynseeds)*sizeof(int));
-                (*dynseeds)[*num_dynseeds - 1] = ctglinks[i].rctg;
-
-            } else if (findint(*dynseeds, *num_dynseeds, ctglinks[i].rctg) == 1 &&
-                       findint(*dynseeds, *num_dynseeds, ctglinks[i].lctg) == 0) {
-                *num_dynseeds += 1;
-                *dynseeds = realloc(*dynseeds, (*num_dynseeds)*sizeof(int));
-                (*dynseeds)[*num_dynseeds - 1] = ctglinks[i].lctg;
+    uint64_t sweep = 0;
+    int sweep_seeds = *num_dynseeds;
+    while (heap_n > 0) {
+        uint64_t x = heap_pop(heap, &heap_n);
+        if (x >> 32 != sweep) {
+            clock_t end = clock();
+            log_info("  No.%-3d %-4d| %.2fs\n", (int)sweep + 1, sweep_seeds, (double)(end - start) / CLOCKS_PER_SEC);
+            start = end;
+            sweep = x >> 32;
+            sweep_seeds = *num_dynseeds;
+        }
+        int link = x & 0xffffffff;
+        int add;
+        if (bit_get(in_seeds, ctglinks[link].lctg - 1) && !bit_get(in_seeds, ctglinks[link].rctg - 1)) {
+            add = ctglinks[link].rctg;
+        } else if (bit_get(in_seeds, ctglinks[link].rctg - 1) && !bit_get(in_seeds, ctglinks[link].lctg - 1)) {
+            add = ctglinks[link].lctg;
+        } else {
+            continue;
+        }
+        if (*num_dynseeds == seeds_m) {
+            seeds_m <<= 1;
+            *dynseeds = realloc(*dynseeds, seeds_m * sizeof(int));
+            if (*dynseeds == NULL) {
+                log_message(ERROR, "Failed to allocate memory for seeds");
+                exit(EXIT_FAILURE);
             }
         }
-        if (i % progress_step == 0) {
-            // 1000 * 10000
-            sleep_ms(10);
-            log_info("#");
-            fflush(stdout);
+        (*dynseeds)[(*num_dynseeds)++] = add;
+        bit_set(in_seeds, add - 1);
+        for (j = adj_off[add]; j < adj_off[add + 1]; j++) {
+            uint64_t next = adj[j] > link ? sweep : sweep + 1;
+            heap_push(&heap, &heap_n, &heap_m, next << 32 | adj[j]);
         }
     }
+    log_info("  No.%-3d %-4d| %.2fs\n", (int)sweep + 1, sweep_seeds, (double)(clock() - start) / CLOCKS_PER_SEC);
+
+    free(heap);
+    free(in_seeds);
+    free(adj);
+    free(adj_off);
 }
 
 
@@ -39,6 +39,11 @@ SOFTWARE.
 #include "misc.h"
 #include "pmat.h"
 
+/* long-only options */
+#define OPT_PATH_TIME_LIMIT 256
+#define OPT_PATH_MAX_EXPANSIONS 257
+#define OPT_PATH_BEAM_WIDTH 258
+
 
 void usage() {
     fprintf(stdout, 
@@ -114,6 +119,9 @@ void autoMito_usage() {
         "   -L, --minoverlaplen  Set minimum overlap length (default: 40)\n"
         "   -T, --cpu            Number of threads (default: 8)\n"
         "   -m, --mem            Keep sequence data in memory to speed up computation\n"
+        "   --path-time-limit    Seconds the M-path searches may take in all; the best paths found are kept (default: 0, no limit)\n"
+        "   --path-max-expansions  Search states one M-path search may expand (default: 0, no limit)\n"
+        "   --path-beam-width    Paths kept at each step of the M-path search of a structure of over 200 contigs (default: 64)\n"
         "   -h, --help           Show this help message and exit\n"
         
     );
@@ -140,6 +148,9 @@ void graphBuild_usage() {
         "   -d, --depth         Contig depth threshold\n"
         "   -s, --seeds         ContigID for extending. Multiple contigIDs should be separated by space. For example: 1 312 356\n"
         "   -T, --cpu           Number of threads (default: 8)\n"
+        "   --path-time-limit   Seconds the M-path searches may take in all; the best paths found are kept (default: 0, no limit)\n"
+        "   --path-max-expansions  Search states one M-path search may expand (default: 0, no limit)\n"
+        "   --path-beam-width   Paths kept at each step of the M-path search of a structure of over 200 contigs (default: 64)\n"
         "   -h, --help          Show this help message and exit\n"
     );
 }
@@ -169,6 +180,9 @@ void autoMito_arguments(int argc, char *argv[], char* exe_path, autoMitoArgs *op
         {"minoverlaplen", 1, 0, 'L'},
         {"cpu", 1, 0, 'T'},
         {"mem", 0, 0, 'm'},
+        {"path-time-limit", 1, 0, OPT_PATH_TIME_LIMIT},
+        {"path-max-expansions", 1, 0, OPT_PATH_MAX_EXPANSIONS},
+        {"path-beam-width", 1, 0, OPT_PATH_BEAM_WIDTH},
         {"help", 0, 0, 'h'},
         {"version", 0, 0, 'v'},
         {0, 0, 0, 0}
@@ -205,6 +219,9 @@ void autoMito_arguments(int argc, char *argv[], char* exe_path, autoMitoArgs *op
             case 'L': opts->ml = atoi(optarg); break;
             case 'T': opts->cpu = atoi(optarg); break;
             case'm': opts->mem = 1; break;
+            case OPT_PATH_TIME_LIMIT: opts->path_time_limit = atof(optarg); break;
+            case OPT_PATH_MAX_EXPANSIONS: opts->path_max_expansions = strtoull(optarg, NULL, 10); break;
+            case OPT_PATH_BEAM_WIDTH: opts->path_beam_width = atoi(optarg); break;
             case 'h': autoMito_usage(); exit(EXIT_SUCCESS);
             case 'v': log_info("PMAT v%s\n", VERSION_PMAT); exit(EXIT_SUCCESS);
             default: log_message(ERROR, "Invalid option: %c", c); autoMito_usage(); exit(EXIT_FAILURE);
@@ -247,6 +264,14 @@ void autoMito_arguments(int argc, char *argv[], char* exe_path, autoMitoArgs *op
         log_message(ERROR, "Invalid cpu: %d", opts->cpu);
         exit(EXIT_FAILURE);
     }
+    if (opts->path_time_limit < 0) {
+        log_message(ERROR, "Invalid path time limit: %f", opts->path_time_limit);
+        exit(EXIT_FAILURE);
+    }
+    if (opts->path_beam_width < 1) {
+        log_message(ERROR, "Invalid path beam width: %d", opts->path_beam_width);
+        exit(EXIT_FAILURE);
+    }
 
     if (opts->kmersize < 1 || opts->kmersize > 31) {
         log_message(ERROR, "Invalid kmer size (k<=31): %d", opts->kmersize);
@@ -327,11 +352,6 @@ void autoMito_arguments(int argc, char *argv[], char* exe_path, autoMitoArgs *op
         opts->organelles = strdup("mt");
     }
 
-    if (which_executable("blastn") == 0) {
-        log_message(ERROR, "Can't find blastn, please install it");
-        exit(EXIT_FAILURE);
-    }
-
     if (which_executable("apptainer") == 0 && which_executable("singularity") == 0) {
         log_message(ERROR, "Can't find apptainer or singularity, please install one of them");
         exit(EXIT_FAILURE);
@@ -358,6 +378,9 @@ void graphBuild_arguments(int argc, char *argv[], graphBuildArgs *args) {
         {"depth", 1, 0, 'd'},
         {"seeds", 1, 0, 's'},
         {"cpu", 1, 0, 'T'},
+        {"path-time-limit", 1, 0, OPT_PATH_TIME_LIMIT},
+        {"path-max-expansions", 1, 0, OPT_PATH_MAX_EXPANSIONS},
+        {"path-beam-width", 1, 0, OPT_PATH_BEAM_WIDTH},
         {"help", 0, 0, 'h'},
         {"version", 0, 0, 'v'},
         {0, 0, 0, 0}
@@ -395,6 +418,9 @@ void graphBuild_arguments(int argc, char *argv[], graphBuildArgs *args) {
                 }
                 break;
             case 'T': args->cpu = atoi(optarg); break;
+            case OPT_PATH_TIME_LIMIT: args->path_time_limit = atof(optarg); break;
+            case OPT_PATH_MAX_EXPANSIONS: args->path_max_expansions = strtoull(optarg, NULL, 10); break;
+            case OPT_PATH_BEAM_WIDTH: args->path_beam_width = atoi(optarg); break;
             case 'h': graphBuild_usage(); exit(EXIT_SUCCESS);
             case 'v': log_info("PMAT v%s\n", VERSION_PMAT); exit(EXIT_SUCCESS);
             case '?':
@@ -449,6 +475,14 @@ void graphBuild_arguments(int argc, char *argv[], graphBuildArgs *args) {
         log_message(ERROR, "Invalid cpu: %d", args->cpu);
         exit(EXIT_FAILURE);
     }
+    if (args->path_time_limit < 0) {
+        log_message(ERROR, "Invalid path time limit: %f", args->path_time_limit);
+        exit(EXIT_FAILURE);
+    }
+    if (args->path_beam_width < 1) {
+        log_message(ERROR, "Invalid path beam width: %d", args->path_beam_width);
+        exit(EXIT_FAILURE);
+    }
 
     if (args->organelles != NULL) {
         if (strcmp(args->organelles, "mt") != 0 && strcmp(args->organelles, "pt") != 0) {
@@ -469,11 +503,6 @@ void graphBuild_arguments(int argc, char *argv[], graphBuildArgs *args) {
         }
     }
 
-    if (which_executable("blastn") == 0) {
-        log_message(ERROR, "Can't find blastn, please install it");
-        exit(EXIT_FAILURE);
-    }
-
 }
 
 int main(int argc, char *argv[]) {
@@ -506,6 +535,9 @@ int main(int argc, char *argv[]) {
             optauto.cpu = 8;
             optauto.mem = 0;
             optauto.kmersize = 31;
+            optauto.path_time_limit = 0;
+            optauto.path_max_expansions = 0;
+            optauto.path_beam_width = 64;
             
             autoMito_arguments(argc - 1, argv + 1, exe_path, &optauto);
             
@@ -527,6 +559,9 @@ int main(int argc, char *argv[]) {
             optgraph.seedCount = 0;
             optgraph.taxo = 0;
             optgraph.cpu = 8;
+            optgraph.path_time_limit = 0;
+            optgraph.path_max_expansions = 0;
+            optgraph.path_beam_width = 64;
 
             graphBuild_arguments(argc - 1, argv + 1, &optgraph);
 
@@ -39,6 +39,8 @@ SOFTWARE.
 #include "hitseeds.h"
 #include "BFSseed.h"
 #include "graphtools.h"
+#include "ctgstore.h"
+#include "ntsearch.h"
 #include "gkmer.h"
 #include "pmat.h"
 
@@ -344,7 +346,15 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
     free(line);
     
     /* addseq */
-    addseq(assembly_graph, assembly_fna, ctgdepth);
+    addseq(assembly_graph, assembly_fna, ctgdepth, num_ctg);
+    /* contig store */
+    ctgstore_build(assembly_fna, assembly_fna);
+    CtgStore* ctgstore = ctgstore_open(assembly_fna, assembly_fna);
+    trim_circular(ctgstore, ctgdepth, num_ctg, opts->cpu);
+    /* read index for the circularity check, kept next to the cut reads */
+    char* reads_idx_path = (char*)malloc(sizeof(*reads_idx_path) * (snprintf(NULL, 0, "%s.mzi", cut_seq) + 1));
+    sprintf(reads_idx_path, "%s.mzi", cut_seq);
+    NtIndex* reads_idx = ntindex_reads(cut_seq, reads_idx_path, opts->cpu);
 
     FILE *fin = fopen(assembly_graph, "r");
     if (!fin) {
@@ -396,7 +406,7 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
         int pt_ctg_threshold;
         pt_ctg_threshold = 1;
         pt_dynseeds = calloc(pt_ctg_threshold, sizeof(int));
-        PtHitseeds(exe_path, "pt", assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, pt_dynseeds, pt_ctg_threshold, 2*seq_depth, 0);
+        PtHitseeds(exe_path, "pt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, pt_dynseeds, pt_ctg_threshold, 2*seq_depth, 0);
         for (i = 0; i < pt_ctg_threshold; i++) {
             if (pt_dynseeds[i] != 0) {
                 pt_num_dynseeds++;
@@ -412,7 +422,7 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
             BFSseeds("pt", num_links, num_ctg, ctglinks, ctgdepth, &pt_num_dynseeds, &pt_dynseeds, seq_depth, filter_depth, &pt_bfslinks, &pt_num_BFSlinks);
             pt_mainseeds = (int*) malloc(sizeof(int) * pt_num_BFSlinks * 2);
             optgfa(exe_path, pt_num_dynseeds, &pt_dynseeds, &pt_bfslinks, &pt_num_BFSlinks, ctgdepth, opts->output_file, 
-                    assembly_fna, assembly_graph, "pt", &pt_mainseeds_num, &pt_mainseeds, 0, NULL, 0, filter_depth, cut_seq);
+                    assembly_fna, ctgstore, assembly_graph, "pt", &pt_mainseeds_num, &pt_mainseeds, 0, NULL, 0, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
             
             // for (int i = 0; i < pt_num_BFSlinks; i++) {
             //     free(pt_bfslinks[i].lctg); free(pt_bfslinks[i].lutr); free(pt_bfslinks[i].rctg); free(pt_bfslinks[i].rutr);
@@ -433,7 +443,7 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
                 filter_depth = 1.5;
             }
             mt_dynseeds = calloc(mt_ctg_threshold, sizeof(int));
-            HitSeeds(exe_path, "mt", assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, &mt_dynseeds, &mt_ctg_threshold, 1.5*seq_depth, 0, 0);
+            HitSeeds(exe_path, "mt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, &mt_dynseeds, &mt_ctg_threshold, 1.5*seq_depth, 0, 0);
             for (i = 0; i < mt_ctg_threshold; i++) {
                 if (mt_dynseeds[i] != 0) {
                     mt_num_dynseeds++;
@@ -447,7 +457,7 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
                 int mt_mainseeds_num = 0;
                 int* mt_mainseeds = (int*) malloc(sizeof(int) * mt_num_BFSlinks * 2);
                 optgfa(exe_path, mt_num_dynseeds, &mt_dynseeds, &mt_bfslinks, &mt_num_BFSlinks, ctgdepth, opts->output_file, 
-                        assembly_fna, assembly_graph, "mt", &mt_mainseeds_num, &mt_mainseeds, pt_mainseeds_num, pt_mainseeds, 0, filter_depth, cut_seq);
+                        assembly_fna, ctgstore, assembly_graph, "mt", &mt_mainseeds_num, &mt_mainseeds, pt_mainseeds_num, pt_mainseeds, 0, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                 
                 // for (int i = 0; i < mt_num_BFSlinks; i++) {
                 //     free(mt_bfslinks[i].lctg); free(mt_bfslinks[i].lutr); free(mt_bfslinks[i].rctg); free(mt_bfslinks[i].rutr);
@@ -472,7 +482,7 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
             filter_depth = 1.5;
         }
         mt_dynseeds = calloc(mt_ctg_threshold, sizeof(int));
-        HitSeeds(exe_path, "mt", assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, &mt_dynseeds, &mt_ctg_threshold, 2*seq_depth, 1, 0);
+        HitSeeds(exe_path, "mt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, &mt_dynseeds, &mt_ctg_threshold, 2*seq_depth, 1, 0);
         for (i = 0; i < mt_ctg_threshold; i++) {
             if (mt_dynseeds[i] != 0) {
                 mt_num_dynseeds++;
@@ -486,7 +496,7 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
             int mt_mainseeds_num = 0;
             int* mt_mainseeds = (int*) malloc(sizeof(int) * mt_num_BFSlinks * 2);
             optgfa(exe_path, mt_num_dynseeds, &mt_dynseeds, &mt_bfslinks, &mt_num_BFSlinks, ctgdepth, opts->output_file, 
-                    assembly_fna, assembly_graph, "mt", &mt_mainseeds_num, &mt_mainseeds, 0, NULL, 1, filter_depth, cut_seq);
+                    assembly_fna, ctgstore, assembly_graph, "mt", &mt_mainseeds_num, &mt_mainseeds, 0, NULL, 1, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
             
             // for (int i = 0; i < mt_num_BFSlinks; i++) {
             //     free(mt_bfslinks[i].lctg); free(mt_bfslinks[i].lutr); free(mt_bfslinks[i].rctg); free(mt_bfslinks[i].rutr);
@@ -508,7 +518,7 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
             filter_depth = 1.5;
         }
         mt_dynseeds = calloc(mt_ctg_threshold, sizeof(int));
-        HitSeeds(exe_path, "mt", assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, &mt_dynseeds, &mt_ctg_threshold, 2*seq_depth, 2, 0);
+        HitSeeds(exe_path, "mt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, &mt_dynseeds, &mt_ctg_threshold, 2*seq_depth, 2, 0);
         for (i = 0; i < mt_ctg_threshold; i++) {
             if (mt_dynseeds[i] != 0) {
                 mt_num_dynseeds++;
@@ -522,7 +532,7 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
             int mt_mainseeds_num = 0;
             int* mt_mainseeds = (int*) malloc(sizeof(int) * mt_num_BFSlinks * 2);
             optgfa(exe_path, mt_num_dynseeds, &mt_dynseeds, &mt_bfslinks, &mt_num_BFSlinks, ctgdepth, opts->output_file, 
-                    assembly_fna, assembly_graph, "mt", &mt_mainseeds_num, &mt_mainseeds, 0, NULL, 2, filter_depth, cut_seq);
+                    assembly_fna, ctgstore, assembly_graph, "mt", &mt_mainseeds_num, &mt_mainseeds, 0, NULL, 2, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
             
             // for (int i = 0; i < mt_num_BFSlinks; i++) {
             //     free(mt_bfslinks[i].lctg); free(mt_bfslinks[i].lutr); free(mt_bfslinks[i].rctg); free(mt_bfslinks[i].rutr);
@@ -543,6 +553,9 @@ void autoMito(const char* exe_path, autoMitoArgs* opts) {
     }
     
     free(ctglinks);
+    ctgstore_free(ctgstore);
+    ntindex_free(reads_idx);
+    free(reads_idx_path);
 
     /* free memory */
     if(high_quality_seq!= NULL) free(high_quality_seq);
@@ -0,0 +1,680 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 Hanfc <h2624366594@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ctggraph.h"
+#include "log.h"
+#include "misc.h"
+
+
+static void* cg_alloc(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (p == NULL) {
+        log_message(ERROR, "Failed to allocate memory for the contig graph");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void add_node(CtgGraph* g, int ctg) {
+    if (g->node[ctg] < 0) {
+        g->node[ctg] = g->num_nodes;
+        g->ctg[g->num_nodes++] = ctg;
+    }
+}
+
+CtgGraph* ctggraph_build(const BFSlinks* links, int num_links, const int* ctgs, int num_ctgs) {
+    uint64_t i;
+    CtgGraph* g = cg_alloc(sizeof(CtgGraph));
+    g->num_nodes = 0;
+    g->num_links = num_links;
+    g->max_ctg = 0;
+    for (i = 0; i < num_ctgs; i++) {
+        if (ctgs[i] > g->max_ctg) g->max_ctg = ctgs[i];
+    }
+    for (i = 0; i < num_links; i++) {
+        if (links[i].lctgsmp > g->max_ctg) g->max_ctg = links[i].lctgsmp;
+        if (links[i].rctgsmp > g->max_ctg) g->max_ctg = links[i].rctgsmp;
+    }
+
+    g->node = cg_alloc((g->max_ctg + 1) * sizeof(int));
+    memset(g->node, -1, (g->max_ctg + 1) * sizeof(int));
+    g->ctg = cg_alloc((num_ctgs + 2 * (size_t)num_links) * sizeof(int));
+    for (i = 0; i < num_ctgs; i++) add_node(g, ctgs[i]);
+    for (i = 0; i < num_links; i++) {
+        add_node(g, links[i].lctgsmp);
+        add_node(g, links[i].rctgsmp);
+    }
+
+    /* count, prefix sum, then fill in link order */
+    int num_ends = 2 * g->num_nodes;
+    g->off = calloc(num_ends + 1, sizeof(uint32_t));
+    if (g->off == NULL) {
+        log_message(ERROR, "Failed to allocate memory for the contig graph");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < num_links; i++) {
+        int lend = CG_END(g->node[links[i].lctgsmp], links[i].lutrsmp);
+        int rend = CG_END(g->node[links[i].rctgsmp], links[i].rutrsmp);
+        g->off[lend + 1]++;
+        if (rend != lend) g->off[rend + 1]++;
+    }
+    for (i = 0; i < num_ends; i++) g->off[i + 1] += g->off[i];
+
+    uint32_t num_entries = g->off[num_ends];
+    g->nbr = cg_alloc(num_entries * sizeof(int));
+    g->link = cg_alloc(num_entries * sizeof(int));
+    g->depth = cg_alloc(num_entries * sizeof(float));
+    uint32_t* pos = cg_alloc((num_ends + 1) * sizeof(uint32_t));
+    memcpy(pos, g->off, (num_ends + 1) * sizeof(uint32_t));
+    for (i = 0; i < num_links; i++) {
+        int lend = CG_END(g->node[links[i].lctgsmp], links[i].lutrsmp);
+        int rend = CG_END(g->node[links[i].rctgsmp], links[i].rutrsmp);
+        uint32_t p = pos[lend]++;
+        g->nbr[p] = rend;
+        g->link[p] = i;
+        g->depth[p] = links[i].linkdepth;
+        if (rend != lend) {
+            p = pos[rend]++;
+            g->nbr[p] = lend;
+            g->link[p] = i;
+            g->depth[p] = links[i].linkdepth;
+        }
+    }
+    free(pos);
+    return g;
+}
+
+CtgGraph* ctggraph_dup(const CtgGraph* g) {
+    CtgGraph* d = cg_alloc(sizeof(CtgGraph));
+    *d = *g;
+    uint32_t num_entries = g->off[2 * g->num_nodes];
+    d->ctg = cg_alloc((g->num_nodes + 1) * sizeof(int));
+    memcpy(d->ctg, g->ctg, g->num_nodes * sizeof(int));
+    d->node = cg_alloc((g->max_ctg + 1) * sizeof(int));
+    memcpy(d->node, g->node, (g->max_ctg + 1) * sizeof(int));
+    d->off = cg_alloc((2 * g->num_nodes + 1) * sizeof(uint32_t));
+    memcpy(d->off, g->off, (2 * g->num_nodes + 1) * sizeof(uint32_t));
+    d->nbr = cg_alloc(num_entries * sizeof(int));
+    memcpy(d->nbr, g->nbr, num_entries * sizeof(int));
+    d->link = cg_alloc(num_entries * sizeof(int));
+    memcpy(d->link, g->link, num_entries * sizeof(int));
+    d->depth = cg_alloc(num_entries * sizeof(float));
+    memcpy(d->depth, g->depth, num_entries * sizeof(float));
+    return d;
+}
+
+void ctggraph_free(CtgGraph* g) {
+    if (g == NULL) return;
+    free(g->ctg);
+    free(g->node);
+    free(g->off);
+    free(g->nbr);
+    free(g->link);
+    free(g->depth);
+    free(g);
+}
+
+/* the end on the other side of a link that may be merged into a chain, -1 if there is none */
+static int chain_next(const CtgGraph* g, const uint8_t* mergeable, int end) {
+    if (ctggraph_degree(g, end) != 1) return -1;
+    int nbr = g->nbr[g->off[end]];
+    if (CG_NODE(nbr) == CG_NODE(end) || ctggraph_degree(g, nbr) != 1) return -1;
+    if (!mergeable[CG_NODE(end)] || !mergeable[CG_NODE(nbr)]) return -1;
+    return nbr;
+}
+
+static void add_chain(const CtgGraph* g, const uint8_t* mergeable, CtgChains* chains, int* chain_of, int node, int utr) {
+    int id = chains->num++;
+    uint32_t k = chains->off[id];
+    int first = node, first_utr = utr;
+    while (1) {
+        chains->member[k] = node;
+        chains->utr[k] = utr;
+        chain_of[node] = id;
+        k++;
+        int next = chain_next(g, mergeable, CG_END(node, utr == 3 ? 5 : 3));
+        if (next < 0) break;
+        node = CG_NODE(next);
+        utr = CG_UTR(next);
+    }
+    chains->off[id + 1] = k;
+    chains->end[CG_END(first, first_utr)] = CG_END(id, first_utr);
+    chains->end[CG_END(node, utr == 3 ? 5 : 3)] = CG_END(id, first_utr == 3 ? 5 : 3);
+}
+
+CtgGraph* ctggraph_compact(const CtgGraph* g, const uint8_t* mergeable, CtgChains* chains) {
+    int num_ends = 2 * g->num_nodes;
+    int i;
+    chains->num = 0;
+    chains->off = cg_alloc((g->num_nodes + 1) * sizeof(uint32_t));
+    chains->member = cg_alloc(g->num_nodes * sizeof(int));
+    chains->utr = cg_alloc(g->num_nodes * sizeof(int));
+    chains->end = cg_alloc(num_ends * sizeof(int));
+    chains->off[0] = 0;
+    for (i = 0; i < num_ends; i++) chains->end[i] = -1;
+
+    /* chains start at a node with at most one mergeable link, entered through the other end */
+    int* chain_of = cg_alloc(g->num_nodes * sizeof(int));
+    for (i = 0; i < g->num_nodes; i++) chain_of[i] = -1;
+    for (i = 0; i < g->num_nodes; i++) {
+        if (chain_of[i] >= 0) continue;
+        int next3 = chain_next(g, mergeable, CG_END(i, 3));
+        int next5 = chain_next(g, mergeable, CG_END(i, 5));
+        if (next3 >= 0 && next5 >= 0) continue;
+        add_chain(g, mergeable, chains, chain_of, i, next3 >= 0 ? 5 : 3);
+    }
+    /* what is left lies on closed cycles of chain links; those nodes stay on their own */
+    for (i = 0; i < g->num_nodes; i++) {
+        if (chain_of[i] < 0) {
+            int id = chains->num++;
+            chains->member[chains->off[id]] = i;
+            chains->utr[chains->off[id]] = 5;
+            chains->off[id + 1] = chains->off[id] + 1;
+            chain_of[i] = id;
+            chains->end[CG_END(i, 3)] = CG_END(id, 3);
+            chains->end[CG_END(i, 5)] = CG_END(id, 5);
+        }
+    }
+    free(chain_of);
+
+    CtgGraph* c = cg_alloc(sizeof(CtgGraph));
+    c->num_nodes = chains->num;
+    c->num_links = g->num_links;
+    c->max_ctg = g->max_ctg;
+    c->ctg = cg_alloc(c->num_nodes * sizeof(int));
+    c->node = cg_alloc((c->max_ctg + 1) * sizeof(int));
+    memset(c->node, -1, (c->max_ctg + 1) * sizeof(int));
+    c->off = cg_alloc((2 * c->num_nodes + 1) * sizeof(uint32_t));
+    for (i = 0; i < c->num_nodes; i++) {
+        c->ctg[i] = g->ctg[chains->member[chains->off[i]]];
+        c->node[c->ctg[i]] = i;
+    }
+
+    /* the slice of a compacted end is the slice of the input end it stands for */
+    int* src = cg_alloc(2 * c->num_nodes * sizeof(int));
+    for (i = 0; i < num_ends; i++) {
+        if (chains->end[i] >= 0) src[chains->end[i]] = i;
+    }
+    c->off[0] = 0;
+    for (i = 0; i < 2 * c->num_nodes; i++) c->off[i + 1] = c->off[i] + ctggraph_degree(g, src[i]);
+    c->nbr = cg_alloc(c->off[2 * c->num_nodes] * sizeof(int));
+    c->link = cg_alloc(c->off[2 * c->num_nodes] * sizeof(int));
+    c->depth = cg_alloc(c->off[2 * c->num_nodes] * sizeof(float));
+    for (i = 0; i < 2 * c->num_nodes; i++) {
+        uint32_t p, q = c->off[i];
+        for (p = g->off[src[i]]; p < g->off[src[i] + 1]; p++, q++) {
+            c->nbr[q] = chains->end[g->nbr[p]];
+            c->link[q] = g->link[p];
+            c->depth[q] = g->depth[p];
+        }
+    }
+    free(src);
+    return c;
+}
+
+void ctggraph_free_chains(CtgChains* chains) {
+    free(chains->off);
+    free(chains->member);
+    free(chains->utr);
+    free(chains->end);
+}
+
+/* 
+ * A closed walk enters and leaves every end of node v copies[v] times. Only links 
+ * between nodes with copies count. An end left with one unknown link fixes it.
+ */
+int ctggraph_link_copies(const CtgGraph* g, const int* copies, int* mult) {
+    int num_ends = 2 * g->num_nodes;
+    int i, balanced = 1;
+    uint32_t p;
+    /* need[end]: passes of the node not yet matched by a link; open[end]: links of the end still unknown */
+    int* need = cg_alloc(num_ends * sizeof(int));
+    int* open = calloc(num_ends, sizeof(int));
+    int* queue = cg_alloc(num_ends * sizeof(int));
+    if (open == NULL) {
+        log_message(ERROR, "Failed to allocate memory for the contig graph");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < g->num_links; i++) mult[i] = 0;
+    for (i = 0; i < num_ends; i++) {
+        need[i] = copies[CG_NODE(i)];
+        if (need[i] == 0) continue;
+        for (p = g->off[i]; p < g->off[i + 1]; p++) {
+            if (copies[CG_NODE(g->nbr[p])] == 0) continue;
+            mult[g->link[p]] = -1;
+            open[i]++;
+        }
+    }
+
+    /* an end with one unknown link fixes it */
+    int n = 0, head = 0;
+    for (i = 0; i < num_ends; i++) {
+        if (open[i] == 1) queue[n++] = i;
+    }
+    while (head < n && balanced) {
+        int e = queue[head++];
+        if (open[e] != 1) continue;
+        for (p = g->off[e]; p < g->off[e + 1]; p++) {
+            if (mult[g->link[p]] < 0) break;
+        }
+        int other = g->nbr[p];
+        /* a link from an end to itself passes it twice */
+        int m = other == e ? need[e] / 2 : need[e];
+        if (m < 0 || (other == e && need[e] % 2)) {
+            balanced = 0;
+            break;
+        }
+        mult[g->link[p]] = m;
+        need[e] -= other == e ? 2 * m : m;
+        open[e]--;
+        if (other != e) {
+            need[other] -= m;
+            if (--open[other] == 1) queue[n++] = other;
+        }
+    }
+    for (i = 0; i < num_ends && balanced; i++) {
+        if (open[i] != 0 || need[i] != 0) balanced = 0;
+    }
+    free(need);
+    free(open);
+    free(queue);
+    return balanced;
+}
+
+/* 
+ * The walk enters start first and last. It passes node v at most copies[v] times and 
+ * takes a link at most mult times; an open link as often as its nodes' copies allow. 
+ * walk needs room for 1 + the passes. When ctggraph_link_copies balances g and the 
+ * nodes are connected, the walk passes every node copies times.
+ */
+uint32_t ctggraph_euler(const CtgGraph* g, const int* copies, const int* mult, int start, int* walk) {
+    int num_ends = 2 * g->num_nodes;
+    uint64_t total = 1;
+    int i;
+    uint32_t p;
+    int* pass = cg_alloc(g->num_nodes * sizeof(int));
+    for (i = 0; i < g->num_nodes; i++) {
+        pass[i] = copies[i];
+        total += copies[i];
+    }
+    /* an unknown link is bounded by the passes of its nodes */
+    int* left = cg_alloc((g->num_links ? g->num_links : 1) * sizeof(int));
+    for (i = 0; i < g->num_links; i++) left[i] = mult[i];
+    for (i = 0; i < num_ends; i++) {
+        for (p = g->off[i]; p < g->off[i + 1]; p++) {
+            if (mult[g->link[p]] >= 0) continue;
+            int m = copies[CG_NODE(i)] < copies[CG_NODE(g->nbr[p])] ? copies[CG_NODE(i)] : copies[CG_NODE(g->nbr[p])];
+            if (left[g->link[p]] < 0 || m < left[g->link[p]]) left[g->link[p]] = m;
+        }
+    }
+    for (i = 0; i < g->num_links; i++) total += left[i];
+    uint32_t* next = cg_alloc(num_ends * sizeof(uint32_t));
+    memcpy(next, g->off, num_ends * sizeof(uint32_t));
+
+    /* 
+     * Hierholzer's algorithm on the ends, alternating between passing a node and taking a link. 
+     * An entry at an even height has arrived by a link and passes the node next. 
+     * An entry at an odd height takes a link next.
+     */
+    int* stack = cg_alloc(total * sizeof(int));
+    int* order = cg_alloc(total * sizeof(int));
+    uint64_t top = 0, num = 0;
+    stack[top++] = start;
+    while (top > 0) {
+        int e = stack[top - 1];
+        if ((top - 1) % 2 == 0) {
+            if (pass[CG_NODE(e)] > 0) {
+                pass[CG_NODE(e)]--;
+                stack[top++] = CG_OTHER(e);
+                continue;
+            }
+        } else {
+            while (next[e] < g->off[e + 1] && left[g->link[next[e]]] == 0) next[e]++;
+            if (next[e] < g->off[e + 1]) {
+                left[g->link[next[e]]]--;
+                stack[top++] = g->nbr[next[e]];
+                continue;
+            }
+        }
+        order[num++] = e;
+        top--;
+    }
+
+    /* 
+     * Sub-walks are only spliced in right when every end is balanced. The walk is kept if it 
+     * alternates passes and links from start back to start, within the copies of every node.
+     */
+    uint32_t len = 0;
+    int valid = num % 2 == 1 && order[0] == start;
+    uint64_t k;
+    for (i = 0; i < g->num_nodes; i++) pass[i] = copies[i];
+    for (k = 1; k < num && valid; k++) {
+        int from = order[num - k], to = order[num - 1 - k];
+        if (k % 2) {
+            valid = to == CG_OTHER(from) && pass[CG_NODE(from)]-- > 0;
+        } else {
+            valid = 0;
+            for (p = g->off[from]; p < g->off[from + 1]; p++) {
+                if (g->nbr[p] == to) valid = 1;
+            }
+        }
+    }
+    if (valid) {
+        for (k = 0; k < num; k += 2) walk[len++] = order[num - 1 - k];
+    }
+    free(pass);
+    free(left);
+    free(next);
+    free(stack);
+    free(order);
+    return len;
+}
+
+/* cost of c copies on an arc with target t and weight w; a pass arc with a target is not meant to be left empty */
+static double copy_cost(int c, double t, double w, int pass) {
+    double d = c > t ? c - t : t - c;
+    return w * d + (pass && c == 0 ? 1e3 * w : 0);
+}
+
+/* min-heap of vertices by distance, entries left stale when a vertex gets closer */
+typedef struct {
+    double dist;
+    int v;
+} flowItem;
+
+static void flow_push(flowItem* heap, int* n, double dist, int v) {
+    int c = (*n)++;
+    while (c > 0 && heap[(c - 1) >> 1].dist > dist) {
+        heap[c] = heap[(c - 1) >> 1];
+        c = (c - 1) >> 1;
+    }
+    heap[c].dist = dist;
+    heap[c].v = v;
+}
+
+static flowItem flow_pop(flowItem* heap, int* n) {
+    flowItem top = heap[0], x = heap[--(*n)];
+    int c = 0;
+    while (2 * c + 1 < *n) {
+        int k = 2 * c + 1;
+        if (k + 1 < *n && heap[k + 1].dist < heap[k].dist) k++;
+        if (heap[k].dist >= x.dist) break;
+        heap[c] = heap[k];
+        c = k;
+    }
+    heap[c] = x;
+    return top;
+}
+
+int ctggraph_copy_flow(const CtgGraph* g, const double* target, const double* weight, 
+                       double link_unit, double link_weight, double deadline, int* copies, int* mult) {
+    int i, k;
+    for (i = 0; i < g->num_nodes; i++) copies[i] = 0;
+    for (i = 0; i < g->num_links; i++) mult[i] = 0;
+    if (g->num_nodes > CG_FLOW_MAX_NODES) return 0;
+
+    /* 
+     * Circulation on the oriented graph, carrying a walk and its reverse complement. 
+     * Vertex 2e has arrived at end e by a link; 2e + 1 leaves by one. 
+     * Node v has a pass arc from each end 2e to 2e' + 1 of its other end, aiming at target[v]. 
+     * A node costs weight[v] per copy off target, and more when left out. 
+     * A link between ends a and b has arcs 2a + 1 -> 2b and 2b + 1 -> 2a, aiming at depth / link_unit. 
+     * A link from an end to itself has a single arc aiming at twice that. 
+     * Links cost link_weight per copy off their aim. Every arc cost is convex.
+     */
+    int num_ends = 2 * g->num_nodes;
+    int num_verts = 2 * num_ends;
+    uint32_t num_slots = g->off[num_ends];
+    int* from = cg_alloc((num_ends + num_slots) * sizeof(int));
+    int* to = cg_alloc((num_ends + num_slots) * sizeof(int));
+    int* var = cg_alloc((num_ends + num_slots) * sizeof(int));
+    int* flow = cg_alloc((num_ends + num_slots) * sizeof(int));
+    double* aim = cg_alloc((num_ends + num_slots) * sizeof(double));
+    double* cost = cg_alloc((num_ends + num_slots) * sizeof(double));
+    int num_arcs = 0, num_pass;
+    uint32_t p;
+    for (i = 0; i < num_ends; i++) {
+        if (target[CG_NODE(i)] <= 0) continue;
+        from[num_arcs] = 2 * i;
+        to[num_arcs] = 2 * CG_OTHER(i) + 1;
+        var[num_arcs] = CG_NODE(i);
+        aim[num_arcs] = target[CG_NODE(i)];
+        cost[num_arcs++] = weight[CG_NODE(i)];
+    }
+    num_pass = num_arcs;
+    for (i = 0; i < num_ends; i++) {
+        if (target[CG_NODE(i)] <= 0) continue;
+        for (p = g->off[i]; p < g->off[i + 1]; p++) {
+            if (target[CG_NODE(g->nbr[p])] <= 0) continue;
+            from[num_arcs] = 2 * i + 1;
+            to[num_arcs] = 2 * g->nbr[p];
+            var[num_arcs] = g->link[p];
+            aim[num_arcs] = (g->nbr[p] == i ? 2 : 1) * g->depth[p] / link_unit;
+            cost[num_arcs++] = link_weight;
+        }
+    }
+
+    /* 
+     * Every arc starts at its own cheapest copies, so no residual step costs less than nothing. 
+     * What is left is the excess of the vertices, to route to those short of copies.
+     */
+    int* excess = cg_alloc(num_verts * sizeof(int));
+    memset(excess, 0, num_verts * sizeof(int));
+    for (k = 0; k < num_arcs; k++) {
+        flow[k] = 0;
+        while (copy_cost(flow[k] + 1, aim[k], cost[k], k < num_pass) - copy_cost(flow[k], aim[k], cost[k], k < num_pass) < -1e-9) {
+            flow[k]++;
+        }
+        excess[to[k]] += flow[k];
+        excess[from[k]] -= flow[k];
+    }
+
+    /* residual steps by vertex: step 2a takes arc a forward from from[a], 2a + 1 back from to[a] */
+    uint32_t* step_off = cg_alloc((num_verts + 1) * sizeof(uint32_t));
+    int* step = cg_alloc((2 * num_arcs + 1) * sizeof(int));
+    memset(step_off, 0, (num_verts + 1) * sizeof(uint32_t));
+    for (k = 0; k < num_arcs; k++) {
+        step_off[from[k] + 1]++;
+        step_off[to[k] + 1]++;
+    }
+    for (i = 0; i < num_verts; i++) step_off[i + 1] += step_off[i];
+    uint32_t* fill = cg_alloc((num_verts + 1) * sizeof(uint32_t));
+    memcpy(fill, step_off, (num_verts + 1) * sizeof(uint32_t));
+    for (k = 0; k < num_arcs; k++) {
+        step[fill[from[k]]++] = 2 * k;
+        step[fill[to[k]]++] = 2 * k + 1;
+    }
+    free(fill);
+
+    /* 
+     * Successive shortest paths. Dijkstra runs from all vertices with excess, on costs reduced 
+     * by the potentials, to the nearest one short of copies; one copy then moves along the path. 
+     * With convex costs a step taken only gets dearer, and its way back is free under the new 
+     * potentials. No reduced cost drops below zero.
+     */
+    double* pot = cg_alloc(num_verts * sizeof(double));
+    double* dist = cg_alloc(num_verts * sizeof(double));
+    int* pred = cg_alloc(num_verts * sizeof(int));
+    uint8_t* done = cg_alloc(num_verts);
+    flowItem* heap = cg_alloc((2 * num_arcs + num_verts + 1) * sizeof(flowItem));
+    memset(pot, 0, num_verts * sizeof(double));
+    int fit = 1;
+    while (fit) {
+        int num_heap = 0, sink = -1;
+        for (i = 0; i < num_verts; i++) {
+            dist[i] = -1;
+            pred[i] = -1;
+            done[i] = 0;
+            if (excess[i] > 0) {
+                dist[i] = 0;
+                flow_push(heap, &num_heap, 0, i);
+            }
+        }
+        if (num_heap == 0) break;
+        if (deadline > 0 && realtime() >= deadline) {
+            fit = 0;
+            break;
+        }
+        while (num_heap > 0) {
+            flowItem top = flow_pop(heap, &num_heap);
+            int u = top.v;
+            if (done[u]) continue;
+            done[u] = 1;
+            if (excess[u] < 0) {
+                sink = u;
+                break;
+            }
+            for (p = step_off[u]; p < step_off[u + 1]; p++) {
+                int a = step[p] >> 1, d = step[p] & 1 ? -1 : 1;
+                if (d < 0 && flow[a] == 0) continue;
+                int v = d > 0 ? to[a] : from[a];
+                if (done[v]) continue;
+                double c = copy_cost(flow[a] + d, aim[a], cost[a], a < num_pass) - copy_cost(flow[a], aim[a], cost[a], a < num_pass);
+                c += pot[u] - pot[v];
+                if (c < 0) c = 0;
+                if (dist[v] < 0 || dist[u] + c < dist[v] - 1e-9) {
+                    dist[v] = dist[u] + c;
+                    pred[v] = step[p];
+                    flow_push(heap, &num_heap, dist[v], v);
+                }
+            }
+        }
+        if (sink < 0) {
+            fit = 0;
+            break;
+        }
+        for (i = 0; i < num_verts; i++) {
+            if (dist[i] >= 0) pot[i] += dist[i] < dist[sink] ? dist[i] : dist[sink];
+            else pot[i] += dist[sink];
+        }
+        int y = sink;
+        excess[sink]++;
+        while (pred[y] >= 0) {
+            int a = pred[y] >> 1;
+            flow[a] += pred[y] & 1 ? -1 : 1;
+            y = pred[y] & 1 ? to[a] : from[a];
+        }
+        excess[y]--;
+    }
+
+    /* 
+     * The circulation and its reverse complement cost the same, so their mean is cheapest too. 
+     * A node's copies are the mean of its pass arcs, a link's the mean of its two arcs. 
+     * Only whole copies are kept.
+     */
+    int whole = fit;
+    if (fit) {
+        for (k = 0; k < num_arcs; k++) {
+            if (k < num_pass) copies[var[k]] += flow[k];
+            else mult[var[k]] += flow[k];
+        }
+        for (i = 0; i < g->num_nodes; i++) {
+            if (copies[i] % 2) whole = 0;
+            copies[i] /= 2;
+        }
+        for (i = 0; i < g->num_links; i++) {
+            if (mult[i] % 2) whole = 0;
+            mult[i] /= 2;
+        }
+    }
+    free(from);
+    free(to);
+    free(var);
+    free(flow);
+    free(aim);
+    free(cost);
+    free(excess);
+    free(step_off);
+    free(step);
+    free(pot);
+    free(dist);
+    free(pred);
+    free(done);
+    free(heap);
+    return whole;
+}
+
+/* 
+ * g is taken as a graph of its nodes. Removing a bridge leaves the nodes on its two 
+ * sides unconnected.
+ */
+int ctggraph_bridges(const CtgGraph* g, uint8_t* bridge) {
+    int n = g->num_nodes;
+    int num_bridges = 0;
+    int r;
+    memset(bridge, 0, g->num_links);
+    /* Tarjan's low links on an explicit stack; a node's two slices are one run of nbr */
+    uint32_t* disc = cg_alloc(n * sizeof(uint32_t));
+    memset(disc, 0, n * sizeof(uint32_t));
+    uint32_t* low = cg_alloc(n * sizeof(uint32_t));
+    uint32_t* next = cg_alloc(n * sizeof(uint32_t));
+    int* from = cg_alloc(n * sizeof(int));
+    int* stack = cg_alloc(n * sizeof(int));
+    uint32_t time = 0;
+    for (r = 0; r < n; r++) {
+        if (disc[r]) continue;
+        int top = 0;
+        stack[top++] = r;
+        disc[r] = low[r] = ++time;
+        from[r] = -1;
+        next[r] = g->off[r << 1];
+        while (top > 0) {
+            int v = stack[top - 1];
+            if (next[v] < g->off[(v << 1) + 2]) {
+                uint32_t p = next[v]++;
+                int u = CG_NODE(g->nbr[p]);
+                /* only the link the node was reached by leads back: a parallel one closes a cycle */
+                if (u == v || g->link[p] == from[v]) continue;
+                if (disc[u] == 0) {
+                    disc[u] = low[u] = ++time;
+                    from[u] = g->link[p];
+                    next[u] = g->off[u << 1];
+                    stack[top++] = u;
+                } else if (disc[u] < low[v]) {
+                    low[v] = disc[u];
+                }
+                continue;
+            }
+            if (--top == 0) break;
+            int w = stack[top - 1];
+            if (low[v] < low[w]) low[w] = low[v];
+            if (low[v] > disc[w]) {
+                bridge[from[v]] = 1;
+                num_bridges++;
+            }
+        }
+    }
+    free(disc);
+    free(low);
+    free(next);
+    free(from);
+    free(stack);
+    return num_bridges;
+}
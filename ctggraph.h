@@ -0,0 +1,121 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 Hanfc <h2624366594@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef CTGGRAPH_H
+#define CTGGRAPH_H
+
+#include <stdint.h>
+
+#include "BFSseed.h"
+
+/* 
+ * Contig graph in compressed sparse row form.
+ * Contigs are renumbered to dense nodes 0..num_nodes-1 and every node has two 
+ * ends, end = node << 1 | (utr == 5). The links of an end are the slice 
+ * nbr[off[end] .. off[end + 1]), in input order; a link between two different 
+ * ends is stored on both of them, a link from an end to itself only once.
+ */
+typedef struct {
+    int num_nodes;
+    int num_links;
+    int max_ctg;
+    int* ctg;               /* ctg[node]: contig id */
+    int* node;              /* node[ctg]: dense node, -1 if the contig is not in the graph */
+    uint32_t* off;          /* 2 * num_nodes + 1 slice offsets */
+    int* nbr;               /* end on the other side of the link */
+    int* link;              /* index of the link in the input array */
+    float* depth;           /* link depth */
+} CtgGraph;
+
+/* 
+ * Non-branching chains of a graph: runs of nodes joined by links whose ends both have degree 1. 
+ * Chain i is walked forward from member off[i], entered through utr[off[i]], and is node i of the 
+ * compacted graph, whose end CG_END(i, utr[off[i]]) stands for the entry end of the first member 
+ * and the other end for the exit end of the last one
+ */
+typedef struct {
+    int num;
+    uint32_t* off;          /* num + 1 member offsets */
+    int* member;            /* node of the input graph */
+    int* utr;               /* utr the member is entered through when the chain is walked forward */
+    int* end;               /* end[e]: end of the compacted graph for end e of the input graph, -1 inside a chain */
+} CtgChains;
+
+#define CG_END(node, utr) ((node) << 1 | ((utr) == 5))
+#define CG_NODE(end) ((end) >> 1)
+#define CG_UTR(end) ((end) & 1 ? 5 : 3)
+#define CG_OTHER(end) ((end) ^ 1)
+
+/* nodes are numbered in the order of ctgs, then of first appearance in links */
+CtgGraph* ctggraph_build(const BFSlinks* links, int num_links, const int* ctgs, int num_ctgs);
+CtgGraph* ctggraph_dup(const CtgGraph* g);
+void ctggraph_free(CtgGraph* g);
+
+/* 
+ * collapse the chains of g into single nodes; only nodes with mergeable[node] set join a chain. 
+ * The slices of the compacted graph keep the order of the slices they come from
+ */
+CtgGraph* ctggraph_compact(const CtgGraph* g, const uint8_t* mergeable, CtgChains* chains);
+void ctggraph_free_chains(CtgChains* chains);
+
+/* links taken by a closed walk passing node v copies[v] times; 1 if all are fixed and balance every end, open ones -1 */
+int ctggraph_link_copies(const CtgGraph* g, const int* copies, int* mult);
+
+/* closed walk from end start within copies and mult; walk receives the ends it enters, returns their number or 0 */
+uint32_t ctggraph_euler(const CtgGraph* g, const int* copies, const int* mult, int start, int* walk);
+
+/* 
+ * copies near target and link mult of the cheapest circulation; 1 if whole, 0 with all copies 0 
+ * above CG_FLOW_MAX_NODES nodes or past deadline (0 for none)
+ */
+#define CG_FLOW_MAX_NODES 2048
+int ctggraph_copy_flow(const CtgGraph* g, const double* target, const double* weight, 
+                       double link_unit, double link_weight, double deadline, int* copies, int* mult);
+
+/* set bridge[link] for the links no cycle of nodes passes; returns their number */
+int ctggraph_bridges(const CtgGraph* g, uint8_t* bridge);
+
+static inline int ctggraph_node(const CtgGraph* g, int ctg) {
+    return ctg > 0 && ctg <= g->max_ctg ? g->node[ctg] : -1;
+}
+
+static inline int ctggraph_ctg(const CtgGraph* g, int end) {
+    return g->ctg[CG_NODE(end)];
+}
+
+static inline uint32_t ctggraph_degree(const CtgGraph* g, int end) {
+    return g->off[end + 1] - g->off[end];
+}
+
+/* 1 if the slice of end holds a link to any end of node */
+static inline int ctggraph_has(const CtgGraph* g, int end, int node) {
+    uint32_t i;
+    for (i = g->off[end]; i < g->off[end + 1]; i++) {
+        if (CG_NODE(g->nbr[i]) == node) return 1;
+    }
+    return 0;
+}
+
+#endif // CTGGRAPH_H
@@ -0,0 +1,379 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 Hanfc <h2624366594@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>      // open
+#include <unistd.h>     // close
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // stat
+#include <pthread.h>    // pthread_once
+
+#include "ctgstore.h"
+#include "misc.h"
+#include "log.h"
+
+
+static char* store_path(const char* prefix, const char* suffix) {
+    size_t path_len = snprintf(NULL, 0, "%s%s", prefix, suffix) + 1;
+    char* path = malloc(path_len);
+    if (path == NULL) {
+        log_message(ERROR, "Failed to allocate memory for %s%s", prefix, suffix);
+        exit(EXIT_FAILURE);
+    }
+    snprintf(path, path_len, "%s%s", prefix, suffix);
+    return path;
+}
+
+static void write_fai(FILE* fai, const char* name, uint64_t seq_len, uint64_t seq_off) {
+    /* name, length, offset, line bases, line width */
+    fprintf(fai, "%s\t%lu\t%lu\t%lu\t%lu\n", name, seq_len, seq_off, seq_len, seq_len + 1);
+}
+
+void ctgstore_build(const char* all_fna, const char* prefix) {
+
+    char* ctg_file = store_path(prefix, ".ctg");
+    char* fai_file = store_path(prefix, ".ctg.fai");
+    char* fai_tmp = store_path(prefix, ".ctg.fai.tmp");
+
+    FILE* fin = fopen(all_fna, "r");
+    if (fin == NULL) {
+        log_message(ERROR, "Failed to open %s", all_fna);
+        exit(EXIT_FAILURE);
+    }
+    FILE* fseq = fopen(ctg_file, "w");
+    FILE* ffai = fopen(fai_tmp, "w");
+    if (fseq == NULL || ffai == NULL) {
+        log_message(ERROR, "Failed to create the contig store %s", ctg_file);
+        exit(EXIT_FAILURE);
+    }
+
+    char* line = NULL;
+    size_t len = 0;
+    ssize_t nread;
+    char* name = NULL;
+    uint64_t file_off = 0;
+    uint64_t seq_off = 0;
+    uint64_t seq_len = 0;
+    while ((nread = getline(&line, &len, fin)) != -1) {
+        if (line[0] == '>') {
+            if (name != NULL) {
+                fputc('\n', fseq);
+                file_off++;
+                write_fai(ffai, name, seq_len, seq_off);
+                free(name);
+            }
+            char* token = strtok(line + 1, " \t\r\n");
+            name = strdup(token == NULL ? "" : token);
+            file_off += fprintf(fseq, ">%s\n", name);
+            seq_off = file_off;
+            seq_len = 0;
+        } else if (name != NULL) {
+            while (nread > 0 && (line[nread - 1] == '\n' || line[nread - 1] == '\r')) {
+                line[--nread] = '\0';
+            }
+            to_upper(line);
+            fwrite(line, 1, nread, fseq);
+            file_off += nread;
+            seq_len += nread;
+        }
+    }
+    if (name != NULL) {
+        fputc('\n', fseq);
+        write_fai(ffai, name, seq_len, seq_off);
+        free(name);
+    }
+
+    free(line);
+    fclose(fin);
+    fclose(fseq);
+    fclose(ffai);
+    /* the index is moved into place last, so a present .fai means a complete store */
+    rename_file(fai_tmp, fai_file);
+
+    free(ctg_file);
+    free(fai_file);
+    free(fai_tmp);
+}
+
+CtgStore* ctgstore_open(const char* all_fna, const char* prefix) {
+
+    char* ctg_file = store_path(prefix, ".ctg");
+    char* fai_file = store_path(prefix, ".ctg.fai");
+
+    struct stat st_fna, st_fai;
+    if (stat(all_fna, &st_fna) != 0) {
+        log_message(ERROR, "Failed to open %s", all_fna);
+        exit(EXIT_FAILURE);
+    }
+    if (stat(fai_file, &st_fai) != 0 || is_file(ctg_file) == 0 || st_fai.st_mtime < st_fna.st_mtime) {
+        log_message(INFO, "Indexing contigs: %s", all_fna);
+        ctgstore_build(all_fna, prefix);
+    }
+
+    CtgStore* store = calloc(1, sizeof(CtgStore));
+
+    /* index */
+    FILE* ffai = fopen(fai_file, "r");
+    if (ffai == NULL) {
+        log_message(ERROR, "Failed to open %s", fai_file);
+        exit(EXIT_FAILURE);
+    }
+    char* line = NULL;
+    size_t len = 0;
+    while (getline(&line, &len, ffai) != -1) {
+        char* token = strtok(line, "\t");
+        int ctg = rm_contig(token);
+        if (ctg > store->ctg_num) store->ctg_num = ctg;
+    }
+    rewind(ffai);
+    store->offset = calloc(store->ctg_num, sizeof(uint64_t));
+    store->len = calloc(store->ctg_num, sizeof(uint32_t));
+    store->trim = calloc(store->ctg_num, sizeof(uint32_t));
+    store->name = calloc(store->ctg_num, sizeof(char*));
+    while (getline(&line, &len, ffai) != -1) {
+        char* token = strtok(line, "\t");
+        char* name = strdup(token);
+        int ctg = rm_contig(token);
+        if (ctg < 1) {
+            free(name);
+            continue;
+        }
+        if (store->name[ctg - 1] != NULL) {
+            log_message(ERROR, "Contig %d appears more than once in %s", ctg, all_fna);
+            exit(EXIT_FAILURE);
+        }
+        store->name[ctg - 1] = name;
+        store->len[ctg - 1] = strtoul(strtok(NULL, "\t"), NULL, 10);
+        store->offset[ctg - 1] = strtoull(strtok(NULL, "\t"), NULL, 10);
+    }
+    free(line);
+    fclose(ffai);
+
+    /* sequences */
+    int fd = open(ctg_file, O_RDONLY);
+    if (fd == -1) {
+        log_message(ERROR, "Failed to open %s", ctg_file);
+        exit(EXIT_FAILURE);
+    }
+    struct stat st_ctg;
+    fstat(fd, &st_ctg);
+    store->data_size = st_ctg.st_size;
+    if (store->data_size > 0) {
+        store->data = mmap(NULL, store->data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (store->data == MAP_FAILED) {
+            log_message(ERROR, "Failed to map %s", ctg_file);
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(fd);
+
+    int i;
+    for (i = 0; i < store->ctg_num; i++) {
+        if (store->len[i] != 0 && store->offset[i] + store->len[i] > store->data_size) {
+            log_message(ERROR, "The contig store %s does not match its index, please remove %s", ctg_file, fai_file);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    free(ctg_file);
+    free(fai_file);
+    return store;
+}
+
+const char* ctgstore_seq(const CtgStore* store, int ctg, uint32_t* len) {
+    if (ctg < 1 || ctg > store->ctg_num || store->len[ctg - 1] == 0) {
+        *len = 0;
+        return NULL;
+    }
+    *len = store->len[ctg - 1];
+    return store->data + store->offset[ctg - 1];
+}
+
+void ctgstore_trim(CtgStore* store, int ctg, uint32_t len) {
+    if (ctg < 1 || ctg > store->ctg_num || store->len[ctg - 1] <= len) return;
+    store->len[ctg - 1] -= len;
+    store->trim[ctg - 1] += len;
+}
+
+const char* ctgstore_name(const CtgStore* store, int ctg) {
+    if (ctg < 1 || ctg > store->ctg_num) return NULL;
+    return store->name[ctg - 1];
+}
+
+void ctgstore_free(CtgStore* store) {
+    if (store == NULL) return;
+    int i;
+    for (i = 0; i < store->ctg_num; i++) {
+        free(store->name[i]);
+    }
+    free(store->name);
+    if (store->data != NULL) munmap(store->data, store->data_size);
+    free(store->offset);
+    free(store->len);
+    free(store->trim);
+    free(store);
+}
+
+
+static uint8_t nt4_table[256];
+static char dec4_table[256][4];    /* packed byte -> 4 bases */
+static char rc4_table[256][4];     /* packed byte -> 4 complemented bases, reversed */
+static pthread_once_t pack_once = PTHREAD_ONCE_INIT;
+
+static void pack_tables_init(void) {
+    static const char nt[4] = {'A', 'C', 'G', 'T'};
+    int i, j;
+    memset(nt4_table, 4, sizeof(nt4_table));
+    nt4_table['A'] = nt4_table['a'] = 0;
+    nt4_table['C'] = nt4_table['c'] = 1;
+    nt4_table['G'] = nt4_table['g'] = 2;
+    nt4_table['T'] = nt4_table['t'] = 3;
+    for (i = 0; i < 256; i++) {
+        for (j = 0; j < 4; j++) {
+            int c = (i >> (6 - 2 * j)) & 3;
+            dec4_table[i][j] = nt[c];
+            rc4_table[i][3 - j] = nt[3 - c];
+        }
+    }
+}
+
+CtgPack* ctgpack_build(const CtgStore* store, const int* ctgs, int num_ctgs) {
+
+    pthread_once(&pack_once, pack_tables_init);
+
+    CtgPack* pack = calloc(1, sizeof(CtgPack));
+    pack->ctg_num = store->ctg_num;
+    pack->offset = calloc(pack->ctg_num, sizeof(uint64_t));
+    pack->len = calloc(pack->ctg_num, sizeof(uint32_t));
+    pack->amb_idx = calloc(pack->ctg_num + 1, sizeof(uint64_t));
+
+    int i;
+    uint32_t j, seq_len;
+    uint64_t bits_size = 0;
+    uint64_t amb_num = 0;
+    const char* seq;
+    /* sizes */
+    for (i = 0; i < num_ctgs; i++) {
+        int ctg = ctgs[i];
+        seq = ctgstore_seq(store, ctg, &seq_len);
+        if (seq == NULL || pack->len[ctg - 1] != 0) continue;
+        pack->len[ctg - 1] = seq_len;
+        pack->offset[ctg - 1] = bits_size;
+        bits_size += (seq_len + 3) / 4;
+        for (j = 0; j < seq_len; j++) {
+            if (nt4_table[(uint8_t)seq[j]] > 3 && (j == 0 || seq[j - 1] != seq[j])) {
+                pack->amb_idx[ctg]++;
+                amb_num++;
+            }
+        }
+    }
+    for (i = 0; i < pack->ctg_num; i++) {
+        pack->amb_idx[i + 1] += pack->amb_idx[i];
+    }
+
+    pack->bits = calloc(bits_size > 0 ? bits_size : 1, sizeof(uint8_t));
+    pack->amb = malloc((amb_num > 0 ? amb_num : 1) * sizeof(AmbBlock));
+    if (pack->bits == NULL || pack->amb == NULL) {
+        log_message(ERROR, "Failed to allocate memory for packed contigs");
+        exit(EXIT_FAILURE);
+    }
+    /* pack */
+    for (i = 0; i < pack->ctg_num; i++) {
+        seq_len = pack->len[i];
+        if (seq_len == 0) continue;
+        seq = store->data + store->offset[i];
+        uint8_t* bits = pack->bits + pack->offset[i];
+        AmbBlock* amb = pack->amb + pack->amb_idx[i];
+        for (j = 0; j < seq_len; j++) {
+            uint8_t c = nt4_table[(uint8_t)seq[j]];
+            if (c > 3) {
+                if (j == 0 || seq[j - 1] != seq[j]) {
+                    amb->pos = j;
+                    amb->len = 0;
+                    amb->base = seq[j];
+                    amb++;
+                }
+                (amb - 1)->len++;
+                c = 0;
+            }
+            bits[j >> 2] |= c << (6 - ((j & 3) << 1));
+        }
+    }
+
+    return pack;
+}
+
+uint32_t ctgpack_len(const CtgPack* pack, int ctg) {
+    if (ctg < 1 || ctg > pack->ctg_num) return 0;
+    return pack->len[ctg - 1];
+}
+
+uint32_t ctgpack_seq(const CtgPack* pack, int ctg, int utr, char* dest) {
+    uint32_t seq_len = ctgpack_len(pack, ctg);
+    if (seq_len == 0) return 0;
+
+    const uint8_t* bits = pack->bits + pack->offset[ctg - 1];
+    uint32_t full = seq_len >> 2;
+    uint32_t rest = seq_len & 3;
+    uint32_t i;
+    uint64_t k;
+    if (utr == 5) {
+        char* p = dest;
+        if (rest) {
+            memcpy(p, rc4_table[bits[full]] + 4 - rest, rest);
+            p += rest;
+        }
+        for (i = full; i > 0; i--, p += 4) {
+            memcpy(p, rc4_table[bits[i - 1]], 4);
+        }
+        for (k = pack->amb_idx[ctg - 1]; k < pack->amb_idx[ctg]; k++) {
+            memset(dest + seq_len - pack->amb[k].pos - pack->amb[k].len, pack->amb[k].base, pack->amb[k].len);
+        }
+    } else {
+        for (i = 0; i < full; i++) {
+            memcpy(dest + 4 * i, dec4_table[bits[i]], 4);
+        }
+        if (rest) {
+            memcpy(dest + 4 * full, dec4_table[bits[full]], rest);
+        }
+        for (k = pack->amb_idx[ctg - 1]; k < pack->amb_idx[ctg]; k++) {
+            memset(dest + pack->amb[k].pos, pack->amb[k].base, pack->amb[k].len);
+        }
+    }
+    return seq_len;
+}
+
+void ctgpack_free(CtgPack* pack) {
+    if (pack == NULL) return;
+    free(pack->offset);
+    free(pack->len);
+    free(pack->amb_idx);
+    free(pack->amb);
+    free(pack->bits);
+    free(pack);
+}
@@ -0,0 +1,80 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 Hanfc <h2624366594@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef CTGSTORE_H
+#define CTGSTORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* 
+ * Random-access contig store.
+ * PMATAllContigs.fna is rewritten once as <prefix>.ctg (one upper-cased line per 
+ * sequence) with a samtools-style <prefix>.ctg.fai next to it. The store file is 
+ * mmap'd and contigs are fetched by their numeric id without rescanning.
+ */
+typedef struct {
+    int ctg_num;            /* largest contig id in the index */
+    uint64_t* offset;       /* offset[ctg - 1]: byte offset of the sequence */
+    uint32_t* len;          /* len[ctg - 1]: sequence length, 0 if absent */
+    uint32_t* trim;         /* trim[ctg - 1]: bases dropped from the end by ctgstore_trim */
+    char** name;            /* name[ctg - 1]: contig name in the fna */
+    char* data;             /* mmap'd store file */
+    size_t data_size;
+} CtgStore;
+
+void ctgstore_build(const char* all_fna, const char* prefix);       /* write <prefix>.ctg and <prefix>.ctg.fai */
+CtgStore* ctgstore_open(const char* all_fna, const char* prefix);   /* (re)build if missing or older than <fna>, then mmap */
+const char* ctgstore_seq(const CtgStore* store, int ctg, uint32_t* len); /* NULL if ctg is not in the store */
+const char* ctgstore_name(const CtgStore* store, int ctg);
+void ctgstore_trim(CtgStore* store, int ctg, uint32_t len); /* drop the last len bases of ctg from what the store returns */
+void ctgstore_free(CtgStore* store);
+
+/* 
+ * 2-bit packed copy of a subset of the store (A=0 C=1 G=2 T=3, 4 bases per 
+ * byte, each contig starting on a byte boundary). Runs of other letters are 
+ * kept as ambiguity blocks and patched in after decoding.
+ */
+typedef struct {
+    uint32_t pos;
+    uint32_t len;
+    char base;
+} AmbBlock;
+
+typedef struct {
+    int ctg_num;
+    uint64_t* offset;       /* offset[ctg - 1]: byte offset into bits */
+    uint32_t* len;          /* len[ctg - 1]: sequence length, 0 if not packed */
+    uint64_t* amb_idx;      /* ambiguity blocks of ctg: amb[amb_idx[ctg - 1] .. amb_idx[ctg]) */
+    AmbBlock* amb;
+    uint8_t* bits;
+} CtgPack;
+
+CtgPack* ctgpack_build(const CtgStore* store, const int* ctgs, int num_ctgs);
+uint32_t ctgpack_len(const CtgPack* pack, int ctg);     /* 0 if ctg is not packed */
+uint32_t ctgpack_seq(const CtgPack* pack, int ctg, int utr, char* dest); /* utr 3: forward, 5: reverse complement; returns bases written */
+void ctgpack_free(CtgPack* pack);
+
+#endif // CTGSTORE_H
@@ -37,6 +37,8 @@ SOFTWARE.
 #include "hitseeds.h"
 #include "BFSseed.h"
 #include "graphtools.h"
+#include "ctgstore.h"
+#include "ntsearch.h"
 #include "gkmer.h"
 #include "pmat.h"
 
@@ -142,6 +144,22 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
     log_message(INFO, "Number of contigs: %d", num_ctg);
     log_message(INFO, "Longest contig: %s %dbp", ctgdepth[log_idx].ctg, ctgdepth[log_idx].len);
     log_message(INFO, "Sequence depth: %.2f", seq_depth);
+
+    /* contig store: kept in the output, the input assembly may be read-only */
+    char* store_prefix = (char*)malloc(sizeof(*store_prefix) * (snprintf(NULL, 0, "%s/PMATAllContigs.fna", opts->output_file) + 1));
+    sprintf(store_prefix, "%s/PMATAllContigs.fna", opts->output_file);
+    CtgStore* ctgstore = ctgstore_open(opts->assembly_fna, store_prefix);
+    free(store_prefix);
+    trim_circular(ctgstore, ctgdepth, num_ctg, opts->cpu);
+    /* read index: reuse the one saved next to the cut reads, otherwise keep it in the output */
+    char* reads_idx_path = (char*)malloc(sizeof(*reads_idx_path) * (snprintf(NULL, 0, "%s.mzi", opts->cutseq) + 1));
+    sprintf(reads_idx_path, "%s.mzi", opts->cutseq);
+    if (is_file(reads_idx_path) == 0) {
+        free(reads_idx_path);
+        reads_idx_path = (char*)malloc(sizeof(*reads_idx_path) * (snprintf(NULL, 0, "%s/PMAT_cut_seq.mzi", opts->output_file) + 1));
+        sprintf(reads_idx_path, "%s/PMAT_cut_seq.mzi", opts->output_file);
+    }
+    NtIndex* reads_idx = ntindex_reads(opts->cutseq, reads_idx_path, opts->cpu);
     // log_message(INFO, "Contig filter depth: %.2f", filter_depth);
 
     int num_dynseeds = 0;
@@ -158,7 +176,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                 int pt_ctg_threshold;
                 pt_ctg_threshold = 1;
                 pt_dynseeds = calloc(pt_ctg_threshold, sizeof(int));
-                PtHitseeds(exe_path, "pt", opts->assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, pt_dynseeds, pt_ctg_threshold, 2*seq_depth, 1);
+                PtHitseeds(exe_path, "pt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, pt_dynseeds, pt_ctg_threshold, 2*seq_depth, 1);
                 for (i = 0; i < pt_ctg_threshold; i++) {
                     if (pt_dynseeds[i] != 0) {
                         pt_num_dynseeds++;
@@ -174,7 +192,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                     BFSseeds("pt", num_links, num_ctg, ctglinks, ctgdepth, &pt_num_dynseeds, &pt_dynseeds, seq_depth, filter_depth, &pt_bfslinks, &pt_num_BFSlinks);
                     pt_mainseeds = (int*) malloc(sizeof(int) * pt_num_BFSlinks * 2);
                     optgfa(exe_path, pt_num_dynseeds, &pt_dynseeds, &pt_bfslinks, &pt_num_BFSlinks, ctgdepth, opts->output_file, 
-                            opts->assembly_fna, opts->assembly_graph, "pt", &pt_mainseeds_num, &pt_mainseeds, 0, NULL, opts->taxo, filter_depth, opts->cutseq);
+                            opts->assembly_fna, ctgstore, opts->assembly_graph, "pt", &pt_mainseeds_num, &pt_mainseeds, 0, NULL, opts->taxo, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                     
                     free(pt_bfslinks); 
                 }
@@ -191,7 +209,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                 } else {
                     filter_depth = opts->depth;
                 }
-                HitSeeds(exe_path, "mt", opts->assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, &dynseeds, &ctg_threshold, filter_depth, opts->taxo, 1);
+                HitSeeds(exe_path, "mt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, &dynseeds, &ctg_threshold, filter_depth, opts->taxo, 1);
 
                 for (i = 0; i < ctg_threshold; i++) {
                     if (dynseeds[i] != 0) {
@@ -205,7 +223,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                     BFSseeds("mt", num_links, num_ctg, ctglinks, ctgdepth, &num_dynseeds, &dynseeds, seq_depth, filter_depth, &bfslinks, &num_BFSlinks);
                     int mt_mainseeds_num = 0;
                     int* mainseeds = (int*) malloc(sizeof(int) * num_BFSlinks);
-                    optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, pt_mainseeds_num, pt_mainseeds, opts->taxo, filter_depth, opts->cutseq);
+                    optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, ctgstore, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, pt_mainseeds_num, pt_mainseeds, opts->taxo, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                     
                     free(bfslinks);
                 }
@@ -221,7 +239,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
 
                 int ctg_threshold = 1;
                 dynseeds = calloc(ctg_threshold, sizeof(int));
-                PtHitseeds(exe_path, "pt", opts->assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, dynseeds, ctg_threshold, filter_depth, 1);
+                PtHitseeds(exe_path, "pt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, dynseeds, ctg_threshold, filter_depth, 1);
                 for (i = 0; i < ctg_threshold; i++) {
                     if (dynseeds[i] != 0) {
                         num_dynseeds++;
@@ -239,7 +257,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                     BFSseeds("pt", num_links, num_ctg, ctglinks, ctgdepth, &num_dynseeds, &dynseeds, seq_depth, filter_depth, &bfslinks, &num_BFSlinks);
                     int pt_mainseeds_num = 0;
                     int* mainseeds = (int*) malloc(sizeof(int) * num_BFSlinks);
-                    optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, opts->assembly_graph, "pt", &pt_mainseeds_num, &mainseeds, 0 ,NULL, opts->taxo, filter_depth, opts->cutseq);
+                    optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, ctgstore, opts->assembly_graph, "pt", &pt_mainseeds_num, &mainseeds, 0 ,NULL, opts->taxo, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                     
                     free(bfslinks);
                     free(mainseeds);
@@ -255,7 +273,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                 }
                 int ctg_threshold = 1;
                 dynseeds = calloc(ctg_threshold, sizeof(int));
-                HitSeeds(exe_path, "mt", opts->assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, &dynseeds, &ctg_threshold, filter_depth, opts->taxo, 1);
+                HitSeeds(exe_path, "mt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, &dynseeds, &ctg_threshold, filter_depth, opts->taxo, 1);
                 for (i = 0; i < ctg_threshold; i++) {
                     if (dynseeds[i] != 0) {
                         num_dynseeds++;
@@ -274,7 +292,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                     BFSseeds("mt", num_links, num_ctg, ctglinks, ctgdepth, &num_dynseeds, &dynseeds, seq_depth, filter_depth, &bfslinks, &num_BFSlinks);
                     int mt_mainseeds_num = 0;
                     int* mainseeds = (int*) malloc(sizeof(int) * num_BFSlinks);
-                    optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, 0, NULL, opts->taxo, filter_depth, opts->cutseq);
+                    optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, ctgstore, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, 0, NULL, opts->taxo, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                     
                     free(bfslinks);
                     free(mainseeds);
@@ -290,7 +308,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                 }                
                 int ctg_threshold = 1;
                 dynseeds = calloc(ctg_threshold, sizeof(int));
-                HitSeeds(exe_path, "mt", opts->assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, &dynseeds, &ctg_threshold, filter_depth, opts->taxo, 1);
+                HitSeeds(exe_path, "mt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, &dynseeds, &ctg_threshold, filter_depth, opts->taxo, 1);
                 for (i = 0; i < ctg_threshold; i++) {
                     if (dynseeds[i] != 0) {
                         num_dynseeds++;
@@ -309,7 +327,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                     BFSseeds("mt", num_links, num_ctg, ctglinks, ctgdepth, &num_dynseeds, &dynseeds, seq_depth, filter_depth, &bfslinks, &num_BFSlinks);
                     int mt_mainseeds_num = 0;
                     int* mainseeds = (int*) malloc(sizeof(int) * num_BFSlinks);
-                    optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, 0, NULL, opts->taxo, filter_depth, opts->cutseq);
+                    optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, ctgstore, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, 0, NULL, opts->taxo, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                     
                     free(bfslinks);
                     free(mainseeds);
@@ -336,7 +354,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                 int pt_ctg_threshold;
                 pt_ctg_threshold = 1;
                 pt_dynseeds = calloc(pt_ctg_threshold, sizeof(int));
-                PtHitseeds(exe_path, "pt", opts->assembly_fna, opts->output_file, opts->cpu, num_ctg, ctgdepth, pt_dynseeds, pt_ctg_threshold, 2*seq_depth, 1);
+                PtHitseeds(exe_path, "pt", ctgstore, opts->output_file, opts->cpu, num_ctg, ctgdepth, pt_dynseeds, pt_ctg_threshold, 2*seq_depth, 1);
                 for (i = 0; i < pt_ctg_threshold; i++) {
                     if (pt_dynseeds[i] != 0) {
                         pt_num_dynseeds++;
@@ -352,7 +370,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                     BFSseeds("pt", num_links, num_ctg, ctglinks, ctgdepth, &pt_num_dynseeds, &pt_dynseeds, seq_depth, filter_depth, &pt_bfslinks, &pt_num_BFSlinks);
                     pt_mainseeds = (int*) malloc(sizeof(int) * pt_num_BFSlinks * 2);
                     optgfa(exe_path, pt_num_dynseeds, &pt_dynseeds, &pt_bfslinks, &pt_num_BFSlinks, ctgdepth, opts->output_file, 
-                            opts->assembly_fna, opts->assembly_graph, "pt", &pt_mainseeds_num, &pt_mainseeds, 0, NULL, opts->taxo, filter_depth, opts->cutseq);
+                            opts->assembly_fna, ctgstore, opts->assembly_graph, "pt", &pt_mainseeds_num, &pt_mainseeds, 0, NULL, opts->taxo, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                     
                     free(pt_bfslinks); 
                 }
@@ -374,7 +392,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                 BFSseeds("mt", num_links, num_ctg, ctglinks, ctgdepth, &num_dynseeds, &dynseeds, seq_depth, filter_depth, &bfslinks, &num_BFSlinks);
                 int mt_mainseeds_num = 0;
                 int* mainseeds = (int*) malloc(sizeof(int) * num_BFSlinks);
-                optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, pt_mainseeds_num, pt_mainseeds, opts->taxo, filter_depth, opts->cutseq);
+                optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, ctgstore, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, pt_mainseeds_num, pt_mainseeds, opts->taxo, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                 
                 free(bfslinks);
                 free(mainseeds);
@@ -392,7 +410,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                 BFSseeds("pt", num_links, num_ctg, ctglinks, ctgdepth, &num_dynseeds, &dynseeds, seq_depth, filter_depth, &bfslinks, &num_BFSlinks);
                 int pt_mainseeds_num = 0;
                 int* mainseeds = (int*) malloc(sizeof(int) * num_BFSlinks);
-                optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, opts->assembly_graph, "pt", &pt_mainseeds_num, &mainseeds, 0 ,NULL, opts->taxo, filter_depth, opts->cutseq);
+                optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, ctgstore, opts->assembly_graph, "pt", &pt_mainseeds_num, &mainseeds, 0 ,NULL, opts->taxo, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                 
                 free(bfslinks);
                 free(mainseeds);
@@ -411,7 +429,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
                 BFSseeds("mt", num_links, num_ctg, ctglinks, ctgdepth, &num_dynseeds, &dynseeds, seq_depth, filter_depth, &bfslinks, &num_BFSlinks);
                 int mt_mainseeds_num = 0;
                 int* mainseeds = (int*) malloc(sizeof(int) * num_BFSlinks);
-                optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, 0, NULL, opts->taxo, filter_depth, opts->cutseq);
+                optgfa(exe_path, num_dynseeds, &dynseeds, &bfslinks, &num_BFSlinks, ctgdepth, opts->output_file, opts->assembly_fna, ctgstore, opts->assembly_graph, "mt", &mt_mainseeds_num, &mainseeds, 0, NULL, opts->taxo, filter_depth, reads_idx, opts->cpu, opts->path_time_limit, opts->path_max_expansions, opts->path_beam_width);
                 
                 free(bfslinks);
                 free(mainseeds);
@@ -432,4 +450,7 @@ void graphBuild(const char* exe_path, graphBuildArgs* opts) {
     }
     
     free(ctglinks);
+    ctgstore_free(ctgstore);
+    ntindex_free(reads_idx);
+    free(reads_idx_path);
 }
\ No newline at end of file
@@ -28,14 +28,18 @@ SOFTWARE.
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <inttypes.h>
 #include <pthread.h>
 
 #include "khash.h"
 #include "BFSseed.h"
 #include "hitseeds.h"
 #include "graphtools.h"
+#include "ctggraph.h"
 #include "misc.h"
 #include "log.h"
+#include "kthread.h"
 
 typedef struct {
     int* node;
@@ -47,58 +51,206 @@ typedef struct {
 } nodePath;
 
 typedef struct {
+    int node;
+    int depth;              /* depth of an mt contig, -1 for any other */
+    int pos;
+} NodePos;
+
+KHASH_MAP_INIT_INT(node_num, int)
+KHASH_SET_INIT_INT64(beam_seen)
+
+#define PATH_MT 1
+#define PATH_PT 2
+
+/* a path kept as a persistent list, so that tasks share the prefixes they have in common */
+typedef struct pathLink {
+    struct pathLink* parent;        /* every link holds a reference to its parent */
     int node;
     int utr;
-} NodeUtrPair;
+    uint32_t depth;                 /* contigs on the path up to and including this one */
+    volatile int ref;
+} pathLink;
 
+/* a subtree of the M-path search, given by the path that leads to it */
 typedef struct {
-    int* node3;
-    int* node3utr;
-    int* node5;
-    int* node5utr;
-    int node3num;
-    int node5num;
-} nodeLink;
+    pathLink* tail;
+    int type;
+} pathTask;
+
+/* 
+ * a search state: the end the path arrived through and the budgets left. As the budgets also fix which 
+ * contigs the path has visited, two paths in the same state score the same on every continuation but for 
+ * their own length, so only the shortest needs to be searched further
+ */
+#define TT_BITS 16
+#define TT_WAYS 4
+#define TT_LOCKS 64
+
+#define HALF_BITS 18            /* log2 of the states kept by each side of the bidirectional search */
+#define HALF_MIN_PASSES 8       /* circles of fewer mt passes are searched one way */
+
+#define PATH_CHECK 4096         /* states a thread expands between checks of the search budgets */
+#define PATH_FLUSH_SEC 60.0     /* seconds between flushes of the best path so far */
+#define PATH_BEAM_NODES 200     /* structures of more contigs are searched by a beam of the best paths */
+#define PATH_BEAM_WIDTH 64      /* paths the beam keeps when no width is given */
+#define PATH_SPLIT_NODES 50     /* circular structures of more contigs are split at their pendant blocks */
+#define PATH_BLOCK_NODES 3      /* contigs a pendant block needs to be searched on its own */
 
-KHASH_MAP_INIT_INT(node_num, int)
-KHASH_MAP_INIT_INT(Ha_nodelink, nodeLink)
-KHASH_MAP_INIT_INT(Ha_nodedepth, int)
-static khash_t(Ha_nodedepth) *g_sort_hash = NULL;
-pthread_mutex_t mutex;
-uint32_t max_node = 1;
-uint32_t mt_uniq = 0;
-uint64_t mt_uniq_len = 0;
-uint8_t taxo_index = 0;
+typedef struct {
+    uint64_t key;                   /* 0 if the slot is free */
+    uint64_t nodelen;               /* shortest path seen in the state */
+    uint64_t serial;                /* task that path was met in */
+    uint32_t depth;
+} ttEntry;
 
 typedef struct {
-    int* path;
-    int* utr;
-    khash_t(node_num) *h_mito;
-    khash_t(node_num) *h_chloro;
-    int type;
-    uint32_t nodenum;
-    uint64_t pathlen;
-} mpath;
+    ttEntry* entry;                 /* buckets of TT_WAYS entries */
+    pthread_mutex_t lock[TT_LOCKS];
+} transTable;
 
+/* a half-circle kept by the bidirectional search, by the end it leaves by and the mt passes it spent */
+typedef struct {
+    uint64_t key;           /* 0 for a free slot */
+    uint64_t len;           /* length of the contigs passed */
+    uint32_t link;          /* its last pass in the arena */
+    uint32_t count;         /* mt passes */
+    uint32_t depth;         /* passes */
+    int pt_num;             /* pt passes */
+    int end;
+} halfState;
+
+/* 
+ * one side of the bidirectional search: the forward side leaves the start by its exit end, the backward side 
+ * walks the circle in reverse from the end it closes through. Passes are kept in an arena of the ends they 
+ * enter by and their parents
+ */
 typedef struct {
-    int node1;
-    int utr1;
-    int node2;
-    int utr2;
-    int main_num;
-    BFSlinks* mainlinks;
+    uint16_t* used;         /* passes per graph node */
+    uint64_t zhash;         /* forward: hash of the mt passes left; backward: of the mt passes spent */
+    uint32_t count, goal;   /* mt passes and the number the side stops at */
+    uint32_t depth;
+    uint64_t len;
+    int pt_num;
+    int backward;
+    int* arena_end;
+    uint32_t* arena_parent;
+    uint32_t arena_num;
+    halfState* state;
+    uint32_t num_states;
+    int full;               /* the table or the arena ran out */
+} halfSide;
+
+/* tasks of one thread: the owner takes from the back, other threads steal from the front */
+typedef struct {
+    pthread_mutex_t lock;
+    pathTask* task;
+    int beg, end, cap;
+} taskDeque;
+
+/* the threads of a run of findMpaths, shared by the searches of all its structures */
+typedef struct {
+    pthread_mutex_t lock;           /* guards the counters below and those of the pools */
+    pthread_cond_t cond;
+    volatile int num_idle;          /* threads waiting for a task */
+    int num_queued;                 /* tasks in the deques of all pools */
+    int num_pending;                /* tasks queued or running in all pools */
+    struct pathRun* runs;
+    int num_runs;
+    volatile int front;             /* first structure whose search is not done; the only one that flushes */
+    pathScore* done;                /* done[run]: the path of a finished structure, empty if it found none */
+} taskShare;
+
+typedef struct {
+    int num_threads;
+    taskDeque* deque;
+    taskShare* share;
+    int index;                      /* run of the pool in share */
+    int num_pending;                /* tasks of this pool queued or running */
+    volatile int stop;
+    transTable tt;
+    uint64_t num_tasks;             /* serial of the last task started */
+
+    const CtgGraph* graph;
+    const CtgGraph* chain_graph;    /* graph with its chains of mt contigs collapsed; the search walks this one */
+    const CtgChains* chains;
+    int* copies;                    /* copies[chain]: full walks of the chain its members' budgets allow */
+    uint8_t* kind;                  /* kind[node]: PATH_MT, PATH_PT or 0 for the contig of graph node */
     CtgDepth* ctg_depth;
-    nodePath* current_path;
-    pathScore* path_score;
+    int s_utr;                      /* orientation of the start that closes circles */
+    int node_t;
+    int t_utr;
+    volatile uint64_t best_mtlen;   /* unique mt length of the best path found by any thread, set under best_lock */
+    pthread_mutex_t best_lock;      /* guards best; taken when a thread improves on its own best or takes up a newer one */
+    pathScore best;                 /* best path found by any thread, kept by findMpath after the join */
+    volatile uint64_t best_version; /* bumped whenever best changes */
+    volatile uint64_t inval_num;    /* paths found by all threads since best last improved */
     int* mt_contigs;
     int mt_num;
-    khash_t(node_num) *h_mito;
     int* pt_contigs;
     int pt_num;
-    khash_t(node_num) *h_chloro;
-    khash_t(Ha_nodelink) *h_links;
-    int stop_flag;
-} bfs_m_args;
+    uint16_t* budget;               /* budget[node]: visits left at the start node; mt by depth, pt once */
+    const pathLimits* limits;       /* budgets of the search, NULL for none */
+    uint32_t max_node;              /* passes a path may take */
+    uint64_t mt_uniq_len;           /* length of the mt contigs, the unit of the path ratios */
+    int taxo;
+    uint64_t num_expanded;          /* states expanded by all threads, added PATH_CHECK at a time */
+    const char* limit_hit;          /* budget that stopped the search, NULL if none did */
+    double last_flush;              /* realtime() of the last flush of best, taken under best_lock */
+    uint64_t flushed_version;       /* best_version last flushed */
+    logBuffer* log;                 /* where the threads keep the messages of the search, NULL to print them */
+} taskPool;
+
+/* 
+ * a frame of the path search: the end of the chain graph the path leaves by, the next link to take 
+ * there, and the members of the chain the last one entered, left again when the search returns 
+ */
+typedef struct {
+    int end;
+    uint32_t p;
+    uint32_t n;
+    bool path_stop;                 /* no link of the end could be taken */
+} searchFrame;
+
+typedef struct {
+    taskPool* pool;
+    int id;
+    nodePath path;
+    pathScore best;                 /* best path of this thread, copied to pool->best by path_up when it is better */
+    uint64_t seen_version;          /* version of the shared best last compared with best */
+    uint16_t* budget;               /* visits left per graph node */
+    uint64_t zhash;                 /* Zobrist hash of the budgets spent */
+    uint64_t serial;                /* task being searched */
+    pathLink** spine;               /* links of the first spine_num contigs of the path, the last one held */
+    uint32_t spine_num;
+    int* left;                      /* full walks left per chain */
+    uint32_t* visits;               /* visits[node]: times the path passes the mt or pt contig of graph node */
+    uint64_t uniq_mtlen;            /* running counts of the path, kept by path_push and path_pop */
+    int uniq_mtnum;
+    int mt_num;
+    int uniq_ptnum;
+    int pt_num;
+    uint32_t stamp;                 /* scratch marks for path_bound and reach_end, indexed by graph node */
+    uint32_t* reached;
+    int* queue;
+    searchFrame* frame;             /* stack of the depth-first search, one frame per chain on the path */
+    uint32_t expanded;              /* states expanded since the last check of the budgets */
+} pathWorker;
+
+/* the search of one structure in a run: its pool, a worker for each thread of the run, and what it owns */
+typedef struct pathRun {
+    pathJob* job;
+    taskPool pool;
+    pathWorker* workers;            /* workers[thread] */
+    CtgGraph* graph;
+    CtgGraph* chain_graph;
+    CtgChains chains;
+} pathRun;
+
+/* a thread of a run */
+typedef struct {
+    taskShare* share;
+    int id;
+} pathThread;
 
 
 void copy_BFSlinks(BFSlinks* dest, const BFSlinks* src) {
@@ -128,164 +280,202 @@ void copy_BFSlinks(BFSlinks* dest, const BFSlinks* src) {
 //     free(links);
 // }
 
-static void node_recursive(int node, bool* link_used, int* visited_nodes, int* visited_num, int link_num, BFSlinks* links, BFSlinks* tempBFSlinks, int* temp_link_num, int* temp_node, int* temp_node_num) {
-    visited_nodes[*visited_num] = node;
-    (*visited_num)++;
+/* 
+ * Depth-first walk of one structure with an explicit stack. A frame is a node 
+ * and its read positions in the 3' and 5' slices; links are taken in link order 
+ * and the walk re-enters visited nodes through unused links, as the recursive 
+ * walk did, so links and nodes come out in the same order.
+ */
+typedef struct {
+    int node;
+    uint32_t p3;
+    uint32_t p5;
+} structFrame;
+
+static void push_frame(structFrame* stack, int* top, const CtgGraph* graph, int node) {
+    stack[*top].node = node;
+    stack[*top].p3 = graph->off[CG_END(node, 3)];
+    stack[*top].p5 = graph->off[CG_END(node, 5)];
+    (*top)++;
+}
 
-    uint64_t i;
-    for (i = 0; i < link_num; i++) {
-        if (link_used[i]) continue;
+uint32_t bfs_structure(int node_num, int link_num, BFSlinks* links, int* node_arry, BFSstructures* structures) {
+    CtgGraph* graph = ctggraph_build(links, link_num, node_arry, node_num);
+    bool* visited = (bool*)calloc(graph->num_nodes + 1, sizeof(bool));
+    bool* link_used = (bool*)calloc(link_num + 1, sizeof(bool));
+    structFrame* stack = (structFrame*)malloc((link_num + 1) * sizeof(structFrame));
 
-        if (links[i].lctgsmp == node) {
-            copy_BFSlinks(&tempBFSlinks[*temp_link_num], &links[i]);
-            (*temp_link_num)++;
-            link_used[i] = true;
+    structures->num = 0;
+    structures->structure = (BFSstructure*)malloc((graph->num_nodes + 1) * sizeof(BFSstructure));
+    structures->links = (BFSlinks*)malloc((link_num + 1) * sizeof(BFSlinks));
+    structures->node = (int*)malloc((graph->num_nodes + 1) * sizeof(int));
+    int struct_link_num = 0;
+    int struct_node_num = 0;
 
-            if (findint(temp_node, *temp_node_num, links[i].rctgsmp) == 0) {
-                temp_node[*temp_node_num] = links[i].rctgsmp;
-                (*temp_node_num)++;
+    uint64_t i;
+    for (i = 0; i < node_num; i++) {
+        int start = graph->node[node_arry[i]];
+        if (visited[start]) continue;
+
+        BFSstructure* structure = &structures->structure[structures->num++];
+        structure->links = structures->links + struct_link_num;
+        structure->node = structures->node + struct_node_num;
+        structure->num_links = 0;
+        structure->num_nodes = 1;
+        structure->node[0] = node_arry[i];
+        visited[start] = true;
+
+        int top = 0;
+        push_frame(stack, &top, graph, start);
+        while (top > 0) {
+            structFrame* f = &stack[top - 1];
+            uint32_t e3 = graph->off[CG_END(f->node, 3) + 1];
+            uint32_t e5 = graph->off[CG_END(f->node, 5) + 1];
+            if (f->p3 >= e3 && f->p5 >= e5) {
+                top--;
+                continue;
             }
-            node_recursive(links[i].rctgsmp, link_used, visited_nodes, visited_num, link_num, links, tempBFSlinks, temp_link_num, temp_node, temp_node_num);
-        } else if (links[i].rctgsmp == node) {
-            copy_BFSlinks(&tempBFSlinks[*temp_link_num], &links[i]);
-            (*temp_link_num)++;
-            link_used[i] = true;
-
-            if (findint(temp_node, *temp_node_num, links[i].lctgsmp) == 0) {
-                temp_node[*temp_node_num] = links[i].lctgsmp;
-                (*temp_node_num)++;
+            uint32_t p = (f->p5 >= e5 || (f->p3 < e3 && graph->link[f->p3] < graph->link[f->p5])) ? f->p3++ : f->p5++;
+            int l = graph->link[p];
+            if (link_used[l]) continue;
+            link_used[l] = true;
+            copy_BFSlinks(&structure->links[structure->num_links], &links[l]);
+            structure->num_links++;
+
+            int next = CG_NODE(graph->nbr[p]);
+            if (!visited[next]) {
+                visited[next] = true;
+                structure->node[structure->num_nodes] = graph->ctg[next];
+                structure->num_nodes++;
             }
-            node_recursive(links[i].lctgsmp, link_used, visited_nodes, visited_num, link_num, links, tempBFSlinks, temp_link_num, temp_node, temp_node_num);
+            push_frame(stack, &top, graph, next);
         }
+        struct_link_num += structure->num_links;
+        struct_node_num += structure->num_nodes;
     }
+    free(stack);
+    free(visited);
+    free(link_used);
+    ctggraph_free(graph);
+    return structures->num;
 }
 
-uint32_t bfs_structure(int node_num, int link_num, BFSlinks* links, int* node_arry, khash_t(Ha_structures)* h_structures) {
-    int* visited_nodes = (int*)malloc(2 * (node_num + 1) * sizeof(int));
-    bool* link_used = (bool*)malloc((link_num + 1) * sizeof(bool));
-    memset(link_used, 0, (link_num + 1) * sizeof(bool));
-    int visited_num = 0;
-    uint32_t structure_num = 0;
+void free_structures(BFSstructures* structures) {
+    free(structures->structure);
+    free(structures->links);
+    free(structures->node);
+    structures->structure = NULL;
+    structures->links = NULL;
+    structures->node = NULL;
+    structures->num = 0;
+}
 
-    int ret;
-    khint_t k;
-    uint64_t i, j;
-    
-    for (i = 0; i < node_num; i++) {
-        int node = node_arry[i];
-
-        if (findint(visited_nodes, visited_num, node) == 0) {
-            BFSlinks* tempBFSlinks = (BFSlinks*)malloc((link_num + 1) * sizeof(BFSlinks));
-            int temp_link_num = 0;
-            int* temp_node = (int*)malloc(node_num * sizeof(int));
-            int temp_node_num = 1;
-            temp_node[0] = node;
-
-            k = kh_put(Ha_structures, h_structures, structure_num, &ret);
-            structure_num++;
-            if (ret) {
-                node_recursive(node, link_used, visited_nodes, &visited_num, link_num, links, tempBFSlinks, &temp_link_num, temp_node, &temp_node_num);
-                BFSstructure *structure = (BFSstructure*)malloc(sizeof(BFSstructure));
-                structure->num_links = temp_link_num;
-                structure->links = (BFSlinks*)malloc((temp_link_num + 1) * sizeof(BFSlinks));
-
-                for (j = 0; j < temp_link_num; j++) {
-                    copy_BFSlinks(&structure->links[j], &tempBFSlinks[j]);
-                }
-                structure->num_nodes = temp_node_num;
-                structure->node = (int*)malloc(temp_node_num * sizeof(int));
-                for (j = 0; j < temp_node_num; j++) {
-                    structure->node[j] = temp_node[j];
-                }
-                kh_value(h_structures, k) = structure;
-            }
-            free(tempBFSlinks);
-        }
-    }
-    free(visited_nodes);
-    free(link_used);
-    return structure_num;
+/* a frame of the shortest path search: the end the path leaves its last contig by and the next link to take there */
+typedef struct {
+    int end;
+    uint32_t p;
+} spathFrame;
+
+static void keep_path(const nodePath* current_path, nodePath** all_paths, int* path_count) {
+    *all_paths = (nodePath*)realloc(*all_paths, (*path_count + 1) * sizeof(nodePath));
+    nodePath* kept = &(*all_paths)[*path_count];
+    *kept = *current_path;
+    kept->node = (int*)malloc(current_path->nodenum * sizeof(int));
+    memcpy(kept->node, current_path->node, current_path->nodenum * sizeof(int));
+    kept->utr = (int*)malloc(current_path->nodenum * sizeof(int));
+    memcpy(kept->utr, current_path->utr, current_path->nodenum * sizeof(int));
+    kept->pathlen = current_path->nodelen;
+    kept->type = 0;
+    (*path_count)++;
 }
 
-static void bfs_algorithm(int node_s, int s_utr, int node_t, int t_utr, int main_num, BFSlinks* mainlinks, CtgDepth *ctg_depth, nodePath* current_path, nodePath** all_paths, int* path_count) 
+/* 
+ * all paths from node_s to node_t that pass no contig twice, found depth-first with an explicit stack 
+ * of frames; current_path holds room for a contig of the graph more than it has
+ */
+static void bfs_algorithm(int node_s, int s_utr, int node_t, int t_utr, const CtgGraph* graph, CtgDepth *ctg_depth, nodePath* current_path, nodePath** all_paths, int* path_count) 
 {
-    
     /* check if the current node is the target node */
     if (node_s == node_t && s_utr != t_utr) {
-        *all_paths = (nodePath*)realloc(*all_paths, (*path_count + 1) * sizeof(nodePath));
-        (*all_paths)[*path_count] = *current_path;
-        (*all_paths)[*path_count].pathlen = current_path->nodelen;
-        (*all_paths)[*path_count].type = 0;
-        (*path_count)++;
+        keep_path(current_path, all_paths, path_count);
         return;
     }
 
-    /* find all paths from node_s to node_t */
-    uint64_t i;
-    for (i = 0; i < main_num; i++) {
-        if (mainlinks[i].lctgsmp == node_s && s_utr != mainlinks[i].lutrsmp) {
-            current_path->nodenum++;
-            current_path->node = (int*)realloc(current_path->node, current_path->nodenum * sizeof(int));
-            current_path->node[current_path->nodenum - 1] = mainlinks[i].rctgsmp;
-            current_path->utr = (int*)realloc(current_path->utr, current_path->nodenum * sizeof(int));
-            current_path->utr[current_path->nodenum - 1] = mainlinks[i].rutrsmp;
-            current_path->nodelen += ctg_depth[mainlinks[i].rctgsmp - 1].len;
-
-            bfs_algorithm(mainlinks[i].rctgsmp, mainlinks[i].rutrsmp, node_t, t_utr, main_num, mainlinks, ctg_depth, current_path, all_paths, path_count);
-            
+    /* find all paths from node_s to node_t, leaving through the other end */
+    int node = ctggraph_node(graph, node_s);
+    if (node < 0) return;
+    spathFrame* stack = (spathFrame*)malloc(graph->num_nodes * sizeof(spathFrame));
+    bool* on_path = (bool*)calloc(graph->num_nodes, sizeof(bool));
+    int top = 0;
+    int end = CG_END(node, s_utr == 3 ? 5 : 3);
+    stack[top++] = (spathFrame){end, graph->off[end]};
+    on_path[node] = true;
+    while (top > 0) {
+        spathFrame* f = &stack[top - 1];
+        if (f->p == graph->off[f->end + 1]) {
             /* backtrack */
-            current_path->nodenum--;
-            current_path->nodelen -= ctg_depth[mainlinks[i].rctgsmp - 1].len;
+            on_path[CG_NODE(f->end)] = false;
+            if (--top > 0) {
+                current_path->nodenum--;
+                current_path->nodelen -= ctg_depth[graph->ctg[CG_NODE(f->end)] - 1].len;
+            }
+            continue;
         }
-        else if (mainlinks[i].rctgsmp == node_s && s_utr != mainlinks[i].rutrsmp) {
-            current_path->nodenum++;
-            current_path->node = (int*)realloc(current_path->node, current_path->nodenum * sizeof(int));
-            current_path->node[current_path->nodenum - 1] = mainlinks[i].lctgsmp;
-            current_path->utr = (int*)realloc(current_path->utr, current_path->nodenum * sizeof(int));
-            current_path->utr[current_path->nodenum - 1] = mainlinks[i].lutrsmp;
-            current_path->nodelen += ctg_depth[mainlinks[i].lctgsmp - 1].len;
-
-            bfs_algorithm(mainlinks[i].lctgsmp, mainlinks[i].lutrsmp, node_t, t_utr, main_num, mainlinks, ctg_depth, current_path, all_paths, path_count);
-
-            /* backtrack */
+        int next = graph->nbr[f->p++];
+        int next_node = graph->ctg[CG_NODE(next)];
+        int next_utr = CG_UTR(next);
+        if (!(next_node == node_t && next_utr != t_utr) && on_path[CG_NODE(next)]) continue;
+        current_path->node[current_path->nodenum] = next_node;
+        current_path->utr[current_path->nodenum] = next_utr;
+        current_path->nodenum++;
+        current_path->nodelen += ctg_depth[next_node - 1].len;
+        if (next_node == node_t && next_utr != t_utr) {
+            keep_path(current_path, all_paths, path_count);
             current_path->nodenum--;
-            current_path->nodelen -= ctg_depth[mainlinks[i].lctgsmp - 1].len;
+            current_path->nodelen -= ctg_depth[next_node - 1].len;
+            continue;
         }
+        on_path[CG_NODE(next)] = true;
+        stack[top++] = (spathFrame){CG_OTHER(next), graph->off[CG_OTHER(next)]};
     }
+    free(stack);
+    free(on_path);
 }
 
 
 
-void findSpath(int node1, int node1utr, int node2, int node2utr, int main_num, BFSlinks* mainlinks, CtgDepth *ctg_depth) 
+void findSpath(int node1, int node1utr, int node2, int node2utr, const CtgGraph* graph, CtgDepth *ctg_depth) 
 {
     nodePath* all_paths = NULL;
     int path_count = 0;
 
     nodePath current_path;
     current_path.nodenum = 1;
-    current_path.node = (int*)malloc(current_path.nodenum * sizeof(int));
+    current_path.node = (int*)malloc((graph->num_nodes + 1) * sizeof(int));
     current_path.node[0] = node1;
-    current_path.utr = (int*)malloc(current_path.nodenum * sizeof(int));
+    current_path.utr = (int*)malloc((graph->num_nodes + 1) * sizeof(int));
     current_path.utr[0] = node1utr;
     current_path.nodelen = ctg_depth[node1 - 1].len;
     current_path.pathlen = 0;
 
-    bfs_algorithm(node1, node1utr, node2, node2utr, main_num, mainlinks, ctg_depth, &current_path, &all_paths, &path_count);
+    bfs_algorithm(node1, node1utr, node2, node2utr, graph, ctg_depth, &current_path, &all_paths, &path_count);
 
-    nodePath* shortest_path = &all_paths[0];
     uint64_t i;
-    for (i = 1; i < path_count; i++) {
-        if (all_paths[i].pathlen < shortest_path->pathlen) {
-            shortest_path = &all_paths[i];
+    if (path_count > 0) {
+        nodePath* shortest_path = &all_paths[0];
+        for (i = 1; i < path_count; i++) {
+            if (all_paths[i].pathlen < shortest_path->pathlen) {
+                shortest_path = &all_paths[i];
+            }
         }
-    }
 
-    if (shortest_path->nodenum > 1) {
-        log_info("-- %d", shortest_path->pathlen);
-        for (i = 0; i < shortest_path->nodenum; i++) {
-            log_info("%d %d -> ", shortest_path->node[i], shortest_path->utr[i]);
+        if (shortest_path->nodenum > 1) {
+            log_info("-- %d", shortest_path->pathlen);
+            for (i = 0; i < shortest_path->nodenum; i++) {
+                log_info("%d %d -> ", shortest_path->node[i], shortest_path->utr[i]);
+            }
+            log_info("\n");
         }
-        log_info("\n");
     }
 
     for (i = 0; i < path_count; i++) {
@@ -298,427 +488,1549 @@ void findSpath(int node1, int node1utr, int node2, int node2utr, int main_num, B
 }
 
 
-static int path_up(pathScore* path_score, nodePath current_path, CtgDepth *ctg_depth, int mt_ctg, int* mt_ctgarr, int pt_ctg, int* pt_ctgarr)
+/* position of the link from (node, utr) to (next_node, next_utr) in the slice the search leaves node by */
+static uint32_t slice_pos(const CtgGraph* graph, int node, int utr, int next_node, int next_utr) {
+    int end = CG_END(ctggraph_node(graph, node), utr == 3 ? 5 : 3);
+    int next = CG_END(ctggraph_node(graph, next_node), next_utr);
+    uint32_t p;
+    for (p = graph->off[end]; p < graph->off[end + 1]; p++) {
+        if (graph->nbr[p] == next) return p;
+    }
+    return UINT32_MAX;
+}
+
+/* order in which a single-threaded depth-first search meets two paths from the same start: <0 if a comes first */
+static int path_dfs_cmp(const CtgGraph* graph, const int* a_node, const int* a_utr, uint32_t a_num, 
+                        const int* b_node, const int* b_utr, uint32_t b_num) {
+    uint32_t k = 0;
+    while (k < a_num && k < b_num && a_node[k] == b_node[k] && a_utr[k] == b_utr[k]) k++;
+    if (k == a_num || k == b_num) return (int)a_num - (int)b_num;
+    /* from one start, the search entering it through its 5' end comes first */
+    if (k == 0) return a_node[0] != b_node[0] ? a_node[0] - b_node[0] : b_utr[0] - a_utr[0];
+    uint32_t pa = slice_pos(graph, a_node[k - 1], a_utr[k - 1], a_node[k], a_utr[k]);
+    uint32_t pb = slice_pos(graph, b_node[k - 1], b_utr[k - 1], b_node[k], b_utr[k]);
+    return pa < pb ? -1 : pa > pb;
+}
+
+/* 1 if path a scores better than path b */
+/* <0 if the score of a is better than that of b, 0 if they are equal */
+static int path_keys_cmp(const pathScore* a, const pathScore* b, int pt_keys)
 {
-    int mt_num = 0;
-    int uniq_mtnum = 0;
-    uint64_t uniq_mtlen = 0;
-    uint64_t uniq_ptlen = 0;
-    int pt_num = 0;
-    int uniq_ptnum = 0;
-    uint32_t node_num = current_path.nodenum;
-    uint64_t path_len = current_path.nodelen;
-    int* pathutr = current_path.utr;
-    int* path_node = current_path.node;
-    int type = current_path.type;
-
-    int* temp_mtarr = (int*)malloc(current_path.nodenum * sizeof(int));
-    int* temp_ptarr = (int*)malloc(current_path.nodenum * sizeof(int));
+    if (a->uniq_mt_pathlen != b->uniq_mt_pathlen) return a->uniq_mt_pathlen > b->uniq_mt_pathlen ? -1 : 1;
+    if (a->uniq_mt_nodenum != b->uniq_mt_nodenum) return a->uniq_mt_nodenum > b->uniq_mt_nodenum ? -1 : 1;
+    if (a->type != b->type) return a->type < b->type ? -1 : 1;
+    if (a->mt_nodenum != b->mt_nodenum) return a->mt_nodenum > b->mt_nodenum ? -1 : 1;
+    if (a->path_len != b->path_len) return a->path_len < b->path_len ? -1 : 1;
+    if (pt_keys) {
+        if (a->uniq_pt_nodenum != b->uniq_pt_nodenum) return a->uniq_pt_nodenum < b->uniq_pt_nodenum ? -1 : 1;
+        if (a->pt_nodenum != b->pt_nodenum) return a->pt_nodenum < b->pt_nodenum ? -1 : 1;
+    }
+    return 0;
+}
 
-    uint64_t i;
-    for (i = 0; i < current_path.nodenum; i++) 
-    {
-        if (findint(pt_ctgarr, pt_ctg, path_node[i]) == 1 && findint(temp_ptarr, uniq_ptnum, path_node[i]) == 0) {
-            temp_ptarr[uniq_ptnum] = path_node[i];
-            uniq_ptlen += ctg_depth[path_node[i] - 1].len;
-            uniq_ptnum++;
-            pt_num++;
-        } else if (findint(pt_ctgarr, pt_ctg, path_node[i]) == 1 && findint(temp_ptarr, uniq_ptnum, path_node[i]) == 1) {
-            pt_num++;
-        } else if (findint(mt_ctgarr, mt_ctg, path_node[i]) == 1 && findint(temp_mtarr, uniq_mtnum, path_node[i]) == 0) {
-            temp_mtarr[uniq_mtnum] = path_node[i];
-            uniq_mtlen += ctg_depth[path_node[i] - 1].len;
-            uniq_mtnum++;
-            mt_num++;
-        } else if (findint(mt_ctgarr, mt_ctg, path_node[i]) == 1 && findint(temp_mtarr, uniq_mtnum, path_node[i]) == 1) {
-            mt_num++;
-        }
+static int path_better(const taskPool* pool, const pathScore* a, const pathScore* b)
+{
+    int c = path_keys_cmp(a, b, pool->taxo != 1);
+    if (c != 0) return c < 0;
+    /* equal scores: keep the path met first in depth-first order, whatever the thread count */
+    if (b->node_num == 0) return 0;
+    return path_dfs_cmp(pool->graph, a->path_node, a->path_utr, a->node_num, b->path_node, b->path_utr, b->node_num) < 0;
+}
+
+static void init_score(pathScore* path_score, int pt_num, uint32_t max_node)
+{
+    path_score->mt_nodenum = 0;
+    path_score->node_num = 0;
+    path_score->uniq_mt_nodenum = 0;
+    path_score->path_len = 0;
+    path_score->uniq_mt_pathlen = 0;
+    path_score->pt_nodenum = 10 * pt_num;
+    path_score->uniq_pt_nodenum = pt_num;
+    path_score->path_node = (int*)malloc((max_node) * sizeof(int));
+    path_score->path_utr = (int*)malloc((max_node) * sizeof(int));
+    path_score->type = 1;
+    path_score->inval_num = 0;
+}
+
+static void copy_score(pathScore* dst, const pathScore* src)
+{
+    int* path_node = dst->path_node;
+    int* path_utr = dst->path_utr;
+    *dst = *src;
+    dst->path_node = path_node;
+    dst->path_utr = path_utr;
+    memcpy(dst->path_node, src->path_node, src->node_num * sizeof(int));
+    memcpy(dst->path_utr, src->path_utr, src->node_num * sizeof(int));
+}
+
+static inline uint64_t zobrist(uint64_t v, uint64_t n)
+{
+    uint64_t x = (v << 16 | n) + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* append ctg to the worker's path and count it */
+static void path_push(pathWorker* w, int ctg, int utr)
+{
+    taskPool* pool = w->pool;
+    nodePath* path = &w->path;
+    path->node[path->nodenum] = ctg;
+    path->utr[path->nodenum] = utr;
+    path->nodelen += pool->ctg_depth[ctg - 1].len;
+    path->nodenum++;
+
+    int v = ctggraph_node(pool->graph, ctg);
+    if (v < 0 || pool->kind[v] == 0) return;
+    /* the start of the path does not use its budget */
+    if (path->nodenum > 1) {
+        w->zhash ^= zobrist(v, w->budget[v]);
+        w->budget[v]--;
+        w->zhash ^= zobrist(v, w->budget[v]);
     }
-    free(temp_mtarr);
-    free(temp_ptarr);
-
-    pthread_mutex_lock(&mutex);
-    path_score->inval_num++;
-    int update_flag = 0;
-    if (taxo_index == 1) {
-        if (uniq_mtlen > path_score->uniq_mt_pathlen) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum > path_score->uniq_mt_nodenum) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum == path_score->uniq_mt_nodenum && type < path_score->type) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum == path_score->uniq_mt_nodenum && type == path_score->type && mt_num > path_score->mt_nodenum) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum == path_score->uniq_mt_nodenum && type == path_score->type && mt_num == path_score->mt_nodenum && path_len < path_score->path_len) {
-            update_flag = 1;
+    if (pool->kind[v] == PATH_PT) {
+        if (w->visits[v]++ == 0) w->uniq_ptnum++;
+        w->pt_num++;
+    } else if (pool->kind[v] == PATH_MT) {
+        if (w->visits[v]++ == 0) {
+            w->uniq_mtnum++;
+            w->uniq_mtlen += pool->ctg_depth[ctg - 1].len;
         }
-    } else {
-        if (uniq_mtlen > path_score->uniq_mt_pathlen) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum > path_score->uniq_mt_nodenum) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum == path_score->uniq_mt_nodenum && type < path_score->type) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum == path_score->uniq_mt_nodenum && type == path_score->type && mt_num > path_score->mt_nodenum) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum == path_score->uniq_mt_nodenum && type == path_score->type && mt_num == path_score->mt_nodenum && path_len < path_score->path_len) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum == path_score->uniq_mt_nodenum && type == path_score->type && path_len == path_score->path_len && mt_num == path_score->mt_nodenum && uniq_ptnum < path_score->uniq_pt_nodenum) {
-            update_flag = 1;
-        } else if (uniq_mtlen == path_score->uniq_mt_pathlen && uniq_mtnum == path_score->uniq_mt_nodenum && type == path_score->type && path_len == path_score->path_len && mt_num == path_score->mt_nodenum && uniq_ptnum == path_score->uniq_pt_nodenum && pt_num < path_score->pt_nodenum) {
-            update_flag = 1;
+        w->mt_num++;
+    }
+}
+
+static void link_release(pathLink* l)
+{
+    while (l != NULL && __sync_sub_and_fetch(&l->ref, 1) == 0) {
+        pathLink* parent = l->parent;
+        free(l);
+        l = parent;
+    }
+}
+
+/* keep the links of the first n contigs of the path */
+static void spine_cut(pathWorker* w, uint32_t n)
+{
+    if (n >= w->spine_num) return;
+    if (n > 0) __sync_fetch_and_add(&w->spine[n - 1]->ref, 1);
+    link_release(w->spine[w->spine_num - 1]);
+    w->spine_num = n;
+}
+
+/* a task for the subtree below the worker's path; only the contigs added since the last one get new links */
+static pathTask spine_task(pathWorker* w)
+{
+    uint32_t i;
+    for (i = w->spine_num; i < w->path.nodenum; i++) {
+        /* the new link takes over the worker's reference to its parent */
+        pathLink* l = (pathLink*)malloc(sizeof(pathLink));
+        l->parent = i > 0 ? w->spine[i - 1] : NULL;
+        l->node = w->path.node[i];
+        l->utr = w->path.utr[i];
+        l->depth = i + 1;
+        l->ref = 1;
+        w->spine[i] = l;
+    }
+    w->spine_num = w->path.nodenum;
+
+    pathTask task;
+    task.tail = w->spine[w->spine_num - 1];
+    task.type = w->path.type;
+    __sync_fetch_and_add(&task.tail->ref, 1);
+    return task;
+}
+
+/* drop the last contig of the worker's path */
+static void path_pop(pathWorker* w)
+{
+    taskPool* pool = w->pool;
+    nodePath* path = &w->path;
+    int ctg = path->node[--path->nodenum];
+    path->nodelen -= pool->ctg_depth[ctg - 1].len;
+    if (path->nodenum < w->spine_num) spine_cut(w, path->nodenum);
+
+    int v = ctggraph_node(pool->graph, ctg);
+    if (v < 0 || pool->kind[v] == 0) return;
+    if (path->nodenum > 0) {
+        w->zhash ^= zobrist(v, w->budget[v]);
+        w->budget[v]++;
+        w->zhash ^= zobrist(v, w->budget[v]);
+    }
+    if (pool->kind[v] == PATH_PT) {
+        if (--w->visits[v] == 0) w->uniq_ptnum--;
+        w->pt_num--;
+    } else if (pool->kind[v] == PATH_MT) {
+        if (--w->visits[v] == 0) {
+            w->uniq_mtnum--;
+            w->uniq_mtlen -= pool->ctg_depth[ctg - 1].len;
         }
+        w->mt_num--;
     }
+}
+
+/* score the worker's current path */
+static void score_path(const pathWorker* w, pathScore* cand)
+{
+    cand->uniq_mt_pathlen = w->uniq_mtlen;
+    cand->uniq_mt_nodenum = w->uniq_mtnum;
+    cand->mt_nodenum = w->mt_num;
+    cand->pt_nodenum = w->pt_num;
+    cand->uniq_pt_nodenum = w->uniq_ptnum;
+    cand->node_num = w->path.nodenum;
+    cand->path_len = w->path.nodelen;
+    cand->type = w->path.type;
+    cand->path_node = w->path.node;
+    cand->path_utr = w->path.utr;
+}
 
-    if (update_flag) {
-        path_score->inval_num = 0;
-        path_score->uniq_mt_pathlen = uniq_mtlen;
-        path_score->uniq_mt_nodenum = uniq_mtnum;
-        path_score->mt_nodenum = mt_num;
-        path_score->pt_nodenum = pt_num;
-        path_score->uniq_pt_nodenum = uniq_ptnum;
-        path_score->node_num = node_num;
-        float rato = (float)path_score->uniq_mt_pathlen / mt_uniq_len;
-        path_score->path_len = path_len;
-        path_score->type = type;
-        // printf("The length of pt %ld\n", uniq_ptlen);
-        // printf("Graph path %s %.2f%% %ld bp:\n-- ", path_score->type == 0 ? "C" : "L", rato * 100, path_score->path_len);
-        // printf("Path upate: ");
-        for (i = 0; i < node_num; i++) {
-            path_score->path_node[i] = path_node[i];
-            path_score->path_utr[i] = pathutr[i];
-            // printf("%d %d -> ", path_node[i], pathutr[i]);
+/* score the worker's current path against the worker's own best; returns 1 when the search should stop */
+static int path_up(pathWorker* w)
+{
+    taskPool* pool = w->pool;
+    pathScore* best = &w->best;
+    pathScore cand;
+    score_path(w, &cand);
+    uint64_t uniq_mtlen = cand.uniq_mt_pathlen;
+
+    /* paths without improvement are counted over all threads; a better shared best restarts the count */
+    int improved = 0;
+    if (path_better(pool, &cand, best)) {
+        copy_score(best, &cand);
+        pthread_mutex_lock(&pool->best_lock);
+        if (path_better(pool, best, &pool->best)) {
+            copy_score(&pool->best, best);
+            if (uniq_mtlen > pool->best_mtlen) pool->best_mtlen = uniq_mtlen;
+            w->seen_version = ++pool->best_version;
+            pool->inval_num = 0;
+            improved = 1;
         }
-        // printf("\n");
+        pthread_mutex_unlock(&pool->best_lock);
     }
-    pthread_mutex_unlock(&mutex);
 
-    if (path_score->inval_num > 10000000) {
+    if (!improved && __sync_add_and_fetch(&pool->inval_num, 1) > 10000000) {
         return 1;
     }
     return 0;
 }
 
-static void bfs_m(int node_s, int s_utr, int node_t, int t_utr, int main_num, BFSlinks* mainlinks, CtgDepth *ctg_depth, nodePath* current_path, pathScore* path_score,
-    int* mt_contigs, int mt_num, khash_t(node_num) *h_mito, int* pt_contigs, int pt_num, khash_t(node_num) *h_chloro, khash_t(Ha_nodelink) *h_links, int* stop_flag) 
+/* 1 if the search may still enter graph node v */
+static inline int budget_open(const pathWorker* w, int v)
+{
+    return w->budget[v] > 0;
+}
+
+/* 
+ * 1 if arriving at ctg through utr closes a circle. Only paths leaving the start in the orientation of s_utr 
+ * close: the reverse of a circle found in the other orientation is one of theirs and scores the same
+ */
+static inline int path_closes(const pathWorker* w, int ctg, int utr)
+{
+    const taskPool* pool = w->pool;
+    return ctg == pool->node_t && utr != pool->t_utr && w->path.utr[0] == pool->s_utr;
+}
+
+/* queue the unreached neighbours of one end for path_bound and add what they may contribute to opt */
+static void reach_end(pathWorker* w, int end, int* n, pathScore* opt)
+{
+    taskPool* pool = w->pool;
+    const CtgGraph* graph = pool->graph;
+    uint32_t p;
+    khint_t k;
+    for (p = graph->off[end]; p < graph->off[end + 1]; p++) {
+        int v = CG_NODE(graph->nbr[p]);
+        int ctg = graph->ctg[v];
+        if (w->reached[v] == w->stamp || !budget_open(w, v)) continue;
+        w->reached[v] = w->stamp;
+        w->queue[(*n)++] = v;
+        if (ctg == pool->node_t && w->path.utr[0] == pool->s_utr) opt->type = 0;
+        if (pool->kind[v] != PATH_MT) continue;
+        opt->mt_nodenum += w->budget[v];
+        opt->path_len += (uint64_t)w->budget[v] * pool->ctg_depth[ctg - 1].len;
+        if (w->visits[v] == 0) {
+            opt->uniq_mt_pathlen += pool->ctg_depth[ctg - 1].len;
+            opt->uniq_mt_nodenum++;
+        }
+    }
+}
+
+/* 
+ * 1 if no path through the current one can beat the best path found so far. Every key of the score is bounded 
+ * by what the contigs reachable from the exit end of node_s, through contigs with budget left and ignoring 
+ * direction, could still add to cur. The length bound only matters to paths that tie on the mt visits, which 
+ * spend every budget left. On a full tie the current path stands in for all its extensions in the depth-first 
+ * order, as none of them can come before a best path that branched off earlier or is a prefix of it
+ */
+static int path_bound(pathWorker* w, int node_s, int s_utr, const pathScore* cur)
+{
+    taskPool* pool = w->pool;
+    const CtgGraph* graph = pool->graph;
+    if (w->seen_version != pool->best_version) {
+        /* a path cut by the transposition table may be the one another thread is extending; its best bounds ours */
+        pthread_mutex_lock(&pool->best_lock);
+        w->seen_version = pool->best_version;
+        if (path_better(pool, &pool->best, &w->best)) copy_score(&w->best, &pool->best);
+        pthread_mutex_unlock(&pool->best_lock);
+    }
+    if (w->best.node_num == 0 && pool->best_mtlen == 0) return 0;
+
+    pathScore opt = *cur;
+    opt.type = 1;
+    int n = 0, head = 0;
+
+    w->stamp++;
+    int node = ctggraph_node(graph, node_s);
+    if (node >= 0) {
+        reach_end(w, CG_END(node, s_utr == 3 ? 5 : 3), &n, &opt);
+        while (head < n) {
+            int v = w->queue[head++];
+            reach_end(w, CG_END(v, 3), &n, &opt);
+            reach_end(w, CG_END(v, 5), &n, &opt);
+        }
+    }
+    if (opt.type == 0 && pool->kind[ctggraph_node(graph, pool->node_t)] == PATH_MT) {
+        opt.path_len -= pool->ctg_depth[pool->node_t - 1].len;
+    }
+    if (opt.uniq_mt_pathlen < pool->best_mtlen) return 1;
+    return w->best.node_num > 0 && path_better(pool, &w->best, &opt);
+}
+
+/* 
+ * append the contigs of chain u, walked forward or backward, as far as their budgets allow; returns how many 
+ * were added. The members of a chain are only ever walked together, so while full walks are left none of 
+ * their budgets needs checking
+ */
+static uint32_t enter_chain(pathWorker* w, int u, bool forward)
+{
+    taskPool* pool = w->pool;
+    const CtgChains* chains = pool->chains;
+    nodePath* path = &w->path;
+    uint32_t beg = chains->off[u];
+    uint32_t k = chains->off[u + 1] - beg;
+    bool full = k > 1 && w->left[u] > 0;
+    uint32_t j;
+    for (j = 0; j < k; j++) {
+        uint32_t m = forward ? beg + j : beg + k - 1 - j;
+        int v = chains->member[m];
+        if (!full && !budget_open(w, v)) break;
+        path_push(w, pool->graph->ctg[v], forward ? chains->utr[m] : (chains->utr[m] == 3 ? 5 : 3));
+    }
+    if (k > 1 && j == k) w->left[u]--;
+    return j;
+}
+
+/* undo enter_chain of n contigs of chain u */
+static void leave_chain(pathWorker* w, int u, uint32_t n)
+{
+    const CtgChains* chains = w->pool->chains;
+    nodePath* path = &w->path;
+    uint32_t k = chains->off[u + 1] - chains->off[u];
+    if (k > 1 && n == k) w->left[u]++;
+    while (n-- > 0) path_pop(w);
+}
+
+/* the budgets spent, the end the path arrived by and the orientation it left the start in; never 0 */
+static inline uint64_t state_key(const pathWorker* w, int node, int s_utr)
 {
-    if (*stop_flag) return;
+    const taskPool* pool = w->pool;
+    uint64_t key = w->zhash ^ zobrist(pool->graph->num_nodes + CG_END(node, s_utr), w->path.utr[0] == pool->s_utr);
+    return key == 0 ? 1 : key;
+}
+
+/* 
+ * record that the worker's path arrived at node_s through s_utr; 1 if a path met before in the same state 
+ * was shorter, or as long and met earlier in this task and so first in depth-first order
+ */
+static int tt_visit(pathWorker* w, int node_s, int s_utr)
+{
+    taskPool* pool = w->pool;
+    transTable* tt = &pool->tt;
+    int node = ctggraph_node(pool->graph, node_s);
+    if (node < 0) return 0;
+    uint64_t key = state_key(w, node, s_utr);
+    uint64_t nodelen = w->path.nodelen;
+    uint64_t b = key & ((1ULL << TT_BITS) - 1);
+    ttEntry* e = &tt->entry[b * TT_WAYS];
+    int i, slot = 0, dominated = 0;
+
+    pthread_mutex_lock(&tt->lock[b % TT_LOCKS]);
+    for (i = 0; i < TT_WAYS; i++) {
+        if (e[i].key == key) break;
+        /* a new state takes a free slot, else the one deepest in the search */
+        if (e[slot].key != 0 && (e[i].key == 0 || e[i].depth > e[slot].depth)) slot = i;
+    }
+    if (i < TT_WAYS) {
+        if (e[i].nodelen < nodelen || (e[i].nodelen == nodelen && e[i].serial == w->serial)) {
+            dominated = 1;
+        } else if (nodelen < e[i].nodelen) {
+            e[i].nodelen = nodelen;
+            e[i].serial = w->serial;
+            e[i].depth = w->path.nodenum;
+        }
+    } else {
+        e[slot].key = key;
+        e[slot].nodelen = nodelen;
+        e[slot].serial = w->serial;
+        e[slot].depth = w->path.nodenum;
+    }
+    pthread_mutex_unlock(&tt->lock[b % TT_LOCKS]);
+    return dominated;
+}
+
+static void push_task(taskPool* pool, int id, pathTask task);
+
+/* stop the search at a budget; the first one reached is reported */
+static void path_limit(taskPool* pool, const char* limit)
+{
+    pthread_mutex_lock(&pool->share->lock);
+    if (pool->limit_hit == NULL) pool->limit_hit = limit;
+    pool->stop = 1;
+    pthread_mutex_unlock(&pool->share->lock);
+}
+
+/* write the paths of the structures before this search, all done, and its best path so far; call under best_lock */
+static void flush_best(taskPool* pool, double now)
+{
+    const pathLimits* limits = pool->limits;
+    const taskShare* share = pool->share;
+    pathScore* paths = (pathScore*)malloc((pool->index + 1) * sizeof(pathScore));
+    int i, num = 0;
+    for (i = 0; i < pool->index; i++) {
+        if (share->done[i].node_num > 0) paths[num++] = share->done[i];
+    }
+    if (pool->best.node_num > 0) paths[num++] = pool->best;
+    path2fa(paths, num, limits->pack, limits->output);
+    free(paths);
+    pool->flushed_version = pool->best_version;
+    pool->last_flush = now;
+    log_message(INFO, "Best M-path so far written to %s", limits->output);
+}
+
+/* count the states w expanded against the budgets of the search, and flush the best path when one is due */
+static void path_budget(pathWorker* w)
+{
+    taskPool* pool = w->pool;
+    const pathLimits* limits = pool->limits;
+    uint64_t expanded = __sync_add_and_fetch(&pool->num_expanded, w->expanded);
+    w->expanded = 0;
+    if (limits == NULL) return;
+
+    double now = realtime();
+    if (limits->max_expansions > 0 && expanded >= limits->max_expansions) path_limit(pool, "expansion");
+    if (limits->deadline > 0 && now >= limits->deadline) path_limit(pool, "time");
+    if (limits->pack == NULL || pool->share->front != pool->index || pool->best_version == pool->flushed_version || 
+        now - pool->last_flush < PATH_FLUSH_SEC) return;
+    pthread_mutex_lock(&pool->best_lock);
+    if (pool->best_version != pool->flushed_version && now - pool->last_flush >= PATH_FLUSH_SEC) flush_best(pool, now);
+    pthread_mutex_unlock(&pool->best_lock);
+}
+
+/* 1 if the path ends on arriving at node_s through s_utr: it closes a circle, which is kept, or the reverse of one */
+static int path_arrive(pathWorker* w, int node_s, int s_utr)
+{
+    taskPool* pool = w->pool;
+    CtgDepth* ctg_depth = pool->ctg_depth;
+    nodePath* current_path = &w->path;
+    int node_t = pool->node_t;
+
     /* check if the current node is the target node */
-    if (current_path->nodenum > 1 && node_s == node_t && s_utr != t_utr) {
+    if (current_path->nodenum > 1 && node_s == node_t && s_utr != pool->t_utr) {
+        /* the reverse of a circle the other orientation closes */
+        if (current_path->utr[0] != pool->s_utr) return 1;
         current_path->type = 0;
         current_path->nodelen -= ctg_depth[node_t - 1].len;
-        *stop_flag = path_up(path_score, *current_path, ctg_depth, mt_num, mt_contigs, pt_num, pt_contigs);
+        if (path_up(w)) pool->stop = 1;
         current_path->nodelen += ctg_depth[node_t - 1].len;
-        return;
+        return 1;
     }
+    return 0;
+}
 
-    int* temp_mtarr = (int*)malloc(current_path->nodenum * sizeof(int));
-    int uniq_mtnum = 0;
-    uint64_t uniq_mtlen = 0;
-    uint64_t i;
-    for (i = 0; i < current_path->nodenum; i++) 
-    {
-        if (findint(mt_contigs, mt_num, current_path->node[i]) == 1 
-            && findint(temp_mtarr, uniq_mtnum, current_path->node[i]) == 0
-            && findint(pt_contigs, pt_num, current_path->node[i]) == 0) {
-            temp_mtarr[uniq_mtnum] = current_path->node[i];
-            uniq_mtlen += ctg_depth[current_path->node[i] - 1].len;
-            uniq_mtnum++;
-        }
-    }
-    free(temp_mtarr);
-    float rato = (float)uniq_mtlen / mt_uniq_len;
+/* 
+ * Checks made on arriving at node_s through s_utr: a closed circle is kept, a state searched before 
+ * or one that cannot beat the best path is cut. Returns the end of the chain graph the path goes on 
+ * from, or -1 if the search does not go on from here
+ */
+static int path_enter(pathWorker* w, int node_s, int s_utr) 
+{
+    taskPool* pool = w->pool;
+
+    if (pool->stop) return -1;
+    if (path_arrive(w, node_s, s_utr)) return -1;
+
+    /* a path in the same state has been or is being searched */
+    if (tt_visit(w, node_s, s_utr)) return -1;
+
+    pathScore cur;
+    score_path(w, &cur);
+    /* nothing below can beat the best path found so far */
+    if (path_bound(w, node_s, s_utr, &cur)) return -1;
+    if (++w->expanded == PATH_CHECK) path_budget(w);
+
+    uint64_t uniq_mtlen = cur.uniq_mt_pathlen;
+    float rato = (float)uniq_mtlen / pool->mt_uniq_len;
     if (rato > 0.5) {
-        *stop_flag = path_up(path_score, *current_path, ctg_depth, mt_num, mt_contigs, pt_num, pt_contigs);
+        if (path_up(w)) pool->stop = 1;
     }
 
-    /* find all paths from node_s to node_t */
-    khint_t is_node_s = kh_get(Ha_nodelink, h_links, node_s);
-    if (is_node_s == kh_end(h_links)) return;
+    int node = ctggraph_node(pool->graph, node_s);
+    if (node < 0) return -1;
+    /* Direction checking logic: leave through the other end */
+    return pool->chains->end[CG_END(node, s_utr == 3 ? 5 : 3)];
+}
 
-    nodeLink* link_s = &kh_value(h_links, is_node_s);
+/* 
+ * find all paths from node_s to node_t, a whole chain of contigs at a time. The search keeps one 
+ * frame per chain on the path in w->frame and takes the links of a frame in slice order, so it 
+ * meets paths in the order a recursive search would, without using the call stack
+ */
+static void bfs_m(pathWorker* w, int node_s, int s_utr) 
+{
+    taskPool* pool = w->pool;
+    const CtgGraph* chain_graph = pool->chain_graph;
+    const CtgChains* chains = pool->chains;
+    nodePath* current_path = &w->path;
+    searchFrame* stack = w->frame;
+    int top = 0;
+
+    int end = path_enter(w, node_s, s_utr);
+    if (end < 0) return;
+    stack[top++] = (searchFrame){end, chain_graph->off[end], 0, true};
+    while (top > 0) {
+        searchFrame* f = &stack[top - 1];
+        if (f->n > 0) {
+            /* Backtrack */
+            current_path->type = 1;
+            leave_chain(w, CG_NODE(chain_graph->nbr[f->p - 1]), f->n);
+            f->n = 0;
+        }
+        if (f->p == chain_graph->off[f->end + 1]) {
+            current_path->type = 1;
+            /* End if no path is found */
+            if (f->path_stop) {
+                if (path_up(w)) pool->stop = 1;
+            }
+            top--;
+            continue;
+        }
 
-    /* Direction checking logic */
-    int* node_array = s_utr == 3 ? link_s->node5 : link_s->node3;
-    int* utr_array = s_utr == 3 ? link_s->node5utr : link_s->node3utr;
-    int node_num = s_utr == 3 ? link_s->node5num : link_s->node3num;
-    bool path_stop = true;
-    for (i = 0; i < node_num; i++) 
-    {
-        int next_node = node_array[i];
-        int next_utr = utr_array[i];
-        bool is_chloro = kh_get(node_num, h_chloro, next_node) != kh_end(h_chloro);
-        bool is_mito = kh_get(node_num, h_mito, next_node) != kh_end(h_mito);
+        uint32_t i = f->p++;
+        int u = CG_NODE(chain_graph->nbr[i]);
+        uint32_t n = enter_chain(w, u, chain_graph->nbr[i] == CG_END(u, chains->utr[chains->off[u]]));
+        if (n == 0) continue;
+        f->path_stop = false;
+        f->n = n;
+
+        if (n < chains->off[u + 1] - chains->off[u]) {
+            /* the budgets ran out inside the chain: the path ends at its last contig */
+            current_path->type = 1;
+            if (path_up(w)) pool->stop = 1;
+        } else if (pool->share->num_idle > 0 && i + 1 < chain_graph->off[f->end + 1]) {
+            /* a thread is idle: give it this branch unless it is the last one here */
+            push_task(pool, w->id, spine_task(w));
+        } else {
+            end = path_enter(w, current_path->node[current_path->nodenum - 1], current_path->utr[current_path->nodenum - 1]);
+            if (end >= 0) stack[top++] = (searchFrame){end, chain_graph->off[end], 0, true};
+        }
+    }
+}
 
-        if (is_chloro && kh_value(h_chloro, kh_get(node_num, h_chloro, next_node)) > 0) continue;
-        if (is_mito && kh_value(h_mito, kh_get(node_num, h_mito, next_node)) == 0) continue;
+static int compare_by_depth(const void* a, const void* b) {
+    const NodePos* pair_a = (const NodePos*)a;
+    const NodePos* pair_b = (const NodePos*)b;
 
-        /* Add node to path */
-        current_path->node[current_path->nodenum] = next_node;
-        current_path->utr[current_path->nodenum] = next_utr;
-        current_path->nodelen += ctg_depth[next_node - 1].len;
-        current_path->nodenum++;
+    if (pair_a->depth < 0 || pair_b->depth < 0) {
+        return 0;
+    }
+    return pair_b->depth - pair_a->depth;
+}
 
-        if (is_mito) kh_value(h_mito, kh_get(node_num, h_mito, next_node))--;
 
-        if (is_chloro) kh_value(h_chloro, kh_get(node_num, h_chloro, next_node))++;
+/* order every slice of graph: mt neighbours by decreasing depth, then pt neighbours in link order */
+static void sort_ends(CtgGraph* graph, int* mt_contigs, int mt_num, int* pt_contigs, int pt_num, CtgDepth* ctg_depth) {
+    uint32_t num_entries = graph->off[2 * graph->num_nodes];
+    NodePos* pairs = (NodePos*)malloc((num_entries + 1) * sizeof(NodePos));
+    int* nbr = (int*)malloc((num_entries + 1) * sizeof(int));
+    int* link = (int*)malloc((num_entries + 1) * sizeof(int));
+    float* depth = (float*)malloc((num_entries + 1) * sizeof(float));
+    uint32_t p;
+    int end;
+    for (end = 0; end < 2 * graph->num_nodes; end++) {
+        uint32_t beg = graph->off[end];
+        uint32_t mt_n = 0, pt_n = 0;
+        for (p = beg; p < graph->off[end + 1]; p++) {
+            if (findint(pt_contigs, pt_num, ctggraph_ctg(graph, graph->nbr[p])) == 0) {
+                int ctg = ctggraph_ctg(graph, graph->nbr[p]);
+                pairs[beg + mt_n].node = ctg;
+                pairs[beg + mt_n].depth = findint(mt_contigs, mt_num, ctg) ? (int)ctg_depth[ctg - 1].depth : -1;
+                pairs[beg + mt_n].pos = p;
+                mt_n++;
+            }
+        }
+        qsort(pairs + beg, mt_n, sizeof(NodePos), compare_by_depth);
+        for (p = beg; p < graph->off[end + 1]; p++) {
+            if (findint(pt_contigs, pt_num, ctggraph_ctg(graph, graph->nbr[p])) == 1) {
+                pairs[beg + mt_n + pt_n].pos = p;
+                pt_n++;
+            }
+        }
+    }
+    for (p = 0; p < num_entries; p++) {
+        nbr[p] = graph->nbr[pairs[p].pos];
+        link[p] = graph->link[pairs[p].pos];
+        depth[p] = graph->depth[pairs[p].pos];
+    }
+    free(graph->nbr);
+    free(graph->link);
+    free(graph->depth);
+    graph->nbr = nbr;
+    graph->link = link;
+    graph->depth = depth;
+    free(pairs);
+}
 
-        path_stop = false;
-        /* Recursively call bfs_m */
-        bfs_m(next_node, next_utr, node_t, t_utr, main_num, mainlinks, ctg_depth, current_path, path_score, mt_contigs, mt_num, h_mito, pt_contigs, pt_num, h_chloro, h_links, stop_flag);
 
-        /* Backtrack */
-        current_path->type = 1;
-        current_path->nodenum--;
-        current_path->nodelen -= ctg_depth[next_node - 1].len;
-        if (is_mito) kh_value(h_mito, kh_get(node_num, h_mito, next_node))++;
-        if (is_chloro) kh_value(h_chloro, kh_get(node_num, h_chloro, next_node))--;
+static void push_task(taskPool* pool, int id, pathTask task) {
+    taskDeque* dq = &pool->deque[id];
+    pthread_mutex_lock(&dq->lock);
+    if (dq->end == dq->cap) {
+        if (dq->beg > 0) {
+            memmove(dq->task, dq->task + dq->beg, (dq->end - dq->beg) * sizeof(pathTask));
+            dq->end -= dq->beg;
+            dq->beg = 0;
+        } else {
+            dq->cap = dq->cap ? 2 * dq->cap : 16;
+            dq->task = (pathTask*)realloc(dq->task, dq->cap * sizeof(pathTask));
+        }
+    }
+    dq->task[dq->end++] = task;
+    taskShare* share = pool->share;
+    pthread_mutex_lock(&share->lock);
+    share->num_queued++;
+    share->num_pending++;
+    pool->num_pending++;
+    if (share->num_idle > 0) pthread_cond_signal(&share->cond);
+    pthread_mutex_unlock(&share->lock);
+    pthread_mutex_unlock(&dq->lock);
+}
+
+/* own tasks newest first, then the oldest task of the next thread that has one */
+static int take_task(taskPool* pool, int id, pathTask* task) {
+    int i;
+    for (i = 0; i < pool->num_threads; i++) {
+        taskDeque* dq = &pool->deque[(id + i) % pool->num_threads];
+        pthread_mutex_lock(&dq->lock);
+        if (dq->end > dq->beg) {
+            *task = i == 0 ? dq->task[--dq->end] : dq->task[dq->beg++];
+            pthread_mutex_lock(&pool->share->lock);
+            pool->share->num_queued--;
+            pthread_mutex_unlock(&pool->share->lock);
+            pthread_mutex_unlock(&dq->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&dq->lock);
+    }
+    return 0;
+}
+
+/* set the worker's path, counts and budgets to those at the end of the task path */
+static void load_task(pathWorker* w, const pathTask* task) {
+    taskPool* pool = w->pool;
+    spine_cut(w, 0);
+    memcpy(w->budget, pool->budget, pool->graph->num_nodes * sizeof(uint16_t));
+    w->zhash = 0;
+    w->serial = __sync_add_and_fetch(&pool->num_tasks, 1);
+    memcpy(w->left, pool->copies, pool->chains->num * sizeof(int));
+    memset(w->visits, 0, pool->graph->num_nodes * sizeof(uint32_t));
+    w->uniq_mtlen = 0;
+    w->uniq_mtnum = w->mt_num = 0;
+    w->uniq_ptnum = w->pt_num = 0;
+
+    pathLink* l;
+    for (l = task->tail; l != NULL; l = l->parent) w->spine[l->depth - 1] = l;
+    w->spine_num = task->tail->depth;
+    __sync_fetch_and_add(&task->tail->ref, 1);
+
+    w->path.nodenum = 0;
+    w->path.nodelen = 0;
+    w->path.type = task->type;
+    uint32_t i;
+    for (i = 0; i < w->spine_num; i++) {
+        path_push(w, w->spine[i]->node, w->spine[i]->utr);
+        if (i == 0) continue;
+        /* every full walk of a chain passes its first member once */
+        int u = ctggraph_node(pool->chain_graph, w->spine[i]->node);
+        if (u >= 0) w->left[u]--;
     }
-    current_path->type = 1;
-    /* End if no path is found */
-    if (path_stop) *stop_flag = path_up(path_score, *current_path, ctg_depth, mt_num, mt_contigs, pt_num, pt_contigs);
 }
 
-static int compare_by_hash_value(const void* a, const void* b) {
-    const NodeUtrPair* pair_a = (const NodeUtrPair*)a;
-    const NodeUtrPair* pair_b = (const NodeUtrPair*)b;
+/* 
+ * circle from the start through the mt contigs alone by their Euler circuit. When the copies of the mt contigs 
+ * fix how often every link between them is taken, the circuit passes each as often as its budget allows and no 
+ * other contig, which no path beats on any key; returns 1 then. Otherwise a circle it finds is only a first best 
+ * path for the search
+ */
+static int euler_walk(pathWorker* w, const pathTask* root)
+{
+    taskPool* pool = w->pool;
+    const CtgGraph* graph = pool->graph;
+    int node_s = root->tail->node;
+    int s_utr = root->tail->utr;
+    int node = ctggraph_node(graph, node_s);
+    if (node < 0 || pool->kind[node] != PATH_MT || node_s != pool->node_t || s_utr == pool->t_utr) return 0;
+
+    int* copies = (int*)malloc(graph->num_nodes * sizeof(int));
+    uint32_t i, n, num_passes = 0;
+    for (i = 0; i < graph->num_nodes; i++) {
+        copies[i] = pool->kind[i] == PATH_MT ? pool->budget[i] : 0;
+        num_passes += copies[i];
+    }
+    int* mult = (int*)malloc((graph->num_links ? graph->num_links : 1) * sizeof(int));
+    int* walk = (int*)malloc((num_passes + 1) * sizeof(int));
+    int balanced = ctggraph_link_copies(graph, copies, mult);
+    n = ctggraph_euler(graph, copies, mult, CG_END(node, s_utr), walk);
+    if (n > 1) {
+        load_task(w, root);
+        for (i = 1; i < n; i++) {
+            path_push(w, graph->ctg[CG_NODE(walk[i])], CG_UTR(walk[i]));
+        }
+        w->path.type = 0;
+        w->path.nodelen -= pool->ctg_depth[node_s - 1].len;
+        path_up(w);
+    }
+    free(copies);
+    free(mult);
+    free(walk);
+    return balanced && n == num_passes + 1;
+}
+
+/* the forward side and the best circle joined so far, for the backward side */
+typedef struct {
+    const taskPool* pool;
+    halfSide fwd, bwd;
+    int found;
+    uint64_t len;
+    int pt_num;
+    uint32_t fwd_link, bwd_link;
+} halfSearch;
+
+/* a pass on the stack of half_walk: the end it leaves by, its arena link, the next neighbour slot */
+typedef struct {
+    int end;
+    uint32_t link;
+    uint32_t p;
+} halfFrame;
+
+static inline uint64_t half_key(const taskPool* pool, uint64_t zhash, int end)
+{
+    uint64_t key = zhash ^ zobrist(pool->graph->num_nodes + end, 1);
+    return key ? key : 1;
+}
 
-    int key_a = pair_a->node;
-    int key_b = pair_b->node;
+/* slot of the state of key and end, or the free slot it goes in */
+static halfState* half_slot(const halfSide* s, uint64_t key, int end)
+{
+    uint64_t mask = (1ULL << HALF_BITS) - 1;
+    uint64_t i = key & mask;
+    while (s->state[i].key != 0 && (s->state[i].key != key || s->state[i].end != end)) i = (i + 1) & mask;
+    return &s->state[i];
+}
 
-    khint_t ka = kh_get(Ha_nodedepth, g_sort_hash, key_a);
-    khint_t kb = kh_get(Ha_nodedepth, g_sort_hash, key_b);
+/* add (d = 1) or take back (d = -1) a pass of graph node v */
+static void half_pass(const taskPool* pool, halfSide* s, int v, int d)
+{
+    int ctg = pool->graph->ctg[v];
+    if (pool->kind[v] == PATH_MT) {
+        if (s->backward) {
+            s->zhash ^= zobrist(v, s->used[v]) ^ zobrist(v, s->used[v] + d);
+        } else {
+            s->zhash ^= zobrist(v, pool->budget[v] - s->used[v]) ^ zobrist(v, pool->budget[v] - s->used[v] - d);
+        }
+        s->count += d;
+    } else if (pool->kind[v] == PATH_PT) {
+        s->pt_num += d;
+    }
+    s->used[v] += d;
+    s->len += d * (int64_t)pool->ctg_depth[ctg - 1].len;
+    s->depth += d;
+}
 
-    if (ka == kh_end(g_sort_hash) || kb == kh_end(g_sort_hash)) {
+/* 
+ * record the state of a side that has arrived at leaving by end through link; 0 when it is no shorter than 
+ * the one kept, or too deep to go on. A backward half-circle that spent its share of mt passes is joined to 
+ * every forward one whose mt passes left are exactly the ones it spent and that leaves by an end linked to its own
+ */
+static int half_enter(halfSearch* hs, halfSide* s, int end, uint32_t link)
+{
+    const taskPool* pool = hs->pool;
+    const CtgGraph* graph = pool->graph;
+    uint32_t p;
+
+    uint64_t key = half_key(pool, s->zhash, end);
+    halfState* st = half_slot(s, key, end);
+    if (st->key != 0 && st->len <= s->len) return 0;
+    if (st->key == 0 && ++s->num_states > (3U << HALF_BITS) / 4) {
+        s->full = 1;
         return 0;
     }
+    st->key = key;
+    st->end = end;
+    st->len = s->len;
+    st->link = link;
+    st->count = s->count;
+    st->depth = s->depth;
+    st->pt_num = s->pt_num;
+
+    if (s->backward && s->count == s->goal) {
+        for (p = graph->off[end]; p < graph->off[end + 1]; p++) {
+            int e = graph->nbr[p];
+            uint64_t fkey = half_key(pool, s->zhash, e);
+            const halfState* f = half_slot(&hs->fwd, fkey, e);
+            if (f->key != fkey || f->count != hs->fwd.goal || f->depth + s->depth + 1 > pool->max_node) continue;
+            uint64_t len = f->len + s->len;
+            int pt_num = f->pt_num + s->pt_num;
+            if (hs->found && (len > hs->len || (len == hs->len && pt_num >= hs->pt_num))) continue;
+            hs->found = 1;
+            hs->len = len;
+            hs->pt_num = pt_num;
+            hs->fwd_link = f->link;
+            hs->bwd_link = link;
+        }
+    }
+    return s->depth + 1 < pool->max_node;
+}
 
-    int value_a = kh_value(g_sort_hash, ka);
-    int value_b = kh_value(g_sort_hash, kb);
+/* 
+ * half-circles of one side leaving by end, keeping each state once with its shortest path, depth first on 
+ * stack (max_node frames), one frame per pass; a frame is popped with its pass taken back
+ */
+static void half_walk(halfSearch* hs, halfSide* s, int end, halfFrame* stack)
+{
+    const taskPool* pool = hs->pool;
+    const CtgGraph* graph = pool->graph;
+    uint32_t top = 0;
+    if (s->full || !half_enter(hs, s, end, UINT32_MAX)) return;
+    stack[top++] = (halfFrame){end, UINT32_MAX, graph->off[end]};
+    while (top > 0) {
+        halfFrame* f = &stack[top - 1];
+        if (s->full || f->p == graph->off[f->end + 1]) {
+            if (f->link != UINT32_MAX) half_pass(pool, s, CG_NODE(s->arena_end[f->link]), -1);
+            top--;
+            continue;
+        }
+        int e = graph->nbr[f->p++];
+        int v = CG_NODE(e);
+        if (pool->kind[v] != 0 && s->used[v] >= pool->budget[v]) continue;
+        if (pool->kind[v] == PATH_MT && s->count == s->goal) continue;
+        if (s->arena_num == (4U << HALF_BITS)) {
+            s->full = 1;
+            continue;
+        }
+        uint32_t idx = s->arena_num++;
+        s->arena_end[idx] = e;
+        s->arena_parent[idx] = f->link;
+        half_pass(pool, s, v, 1);
+        if (half_enter(hs, s, CG_OTHER(e), idx)) {
+            stack[top++] = (halfFrame){CG_OTHER(e), idx, graph->off[CG_OTHER(e)]};
+        } else {
+            half_pass(pool, s, v, -1);
+        }
+    }
+}
 
-    return value_b - value_a;
+static void half_init(halfSide* s, int num_nodes, int backward)
+{
+    s->used = (uint16_t*)calloc(num_nodes, sizeof(uint16_t));
+    s->zhash = 0;
+    s->count = s->goal = s->depth = 0;
+    s->len = 0;
+    s->pt_num = 0;
+    s->backward = backward;
+    s->arena_end = (int*)malloc((4U << HALF_BITS) * sizeof(int));
+    s->arena_parent = (uint32_t*)malloc((4U << HALF_BITS) * sizeof(uint32_t));
+    s->arena_num = 0;
+    s->state = (halfState*)calloc(1U << HALF_BITS, sizeof(halfState));
+    s->num_states = 0;
+    s->full = 0;
 }
 
+static void half_free(halfSide* s)
+{
+    free(s->used);
+    free(s->arena_end);
+    free(s->arena_parent);
+    free(s->state);
+}
 
-int kh_copy(khash_t(node_num) *dst, khash_t(node_num) *src) {
-    khiter_t k;
-    int ret;
+/* 
+ * circle that spends every mt budget, met in the middle: the forward side spends half the mt passes from the 
+ * start, the backward side the rest from the end the circle closes through, each over half the depth of the 
+ * one-way search. The shortest one found is a first best path for the search
+ */
+static void half_search(pathWorker* w, const pathTask* root)
+{
+    taskPool* pool = w->pool;
+    const CtgGraph* graph = pool->graph;
+    int node_s = root->tail->node;
+    int s_utr = root->tail->utr;
+    int node = ctggraph_node(graph, node_s);
+    if (node < 0 || pool->kind[node] != PATH_MT || node_s != pool->node_t || s_utr == pool->t_utr) return;
+
+    uint32_t i, num_passes = 0;
+    for (i = 0; i < graph->num_nodes; i++) {
+        if (pool->kind[i] == PATH_MT) num_passes += pool->budget[i];
+    }
+    if (num_passes < HALF_MIN_PASSES) return;
+
+    halfSearch hs;
+    hs.pool = pool;
+    hs.found = 0;
+    half_init(&hs.fwd, graph->num_nodes, 0);
+    half_init(&hs.bwd, graph->num_nodes, 1);
+    hs.fwd.goal = (num_passes + 1) / 2;
+    hs.bwd.goal = num_passes - hs.fwd.goal;
+    for (i = 0; i < graph->num_nodes; i++) {
+        if (pool->kind[i] == PATH_MT) hs.fwd.zhash ^= zobrist(i, pool->budget[i]) ^ zobrist(i, 0);
+    }
+    half_pass(pool, &hs.fwd, node, 1);
+
+    halfFrame* stack = (halfFrame*)malloc((pool->max_node + 1) * sizeof(halfFrame));
+    half_walk(&hs, &hs.fwd, CG_END(node, s_utr == 3 ? 5 : 3), stack);
+    half_walk(&hs, &hs.bwd, CG_END(node, s_utr), stack);
+    free(stack);
+
+    if (hs.found) {
+        /* forward passes from the start, then the backward ones from the meeting point on */
+        int* ends = (int*)malloc(pool->max_node * sizeof(int));
+        uint32_t n = 0, l, m;
+        for (l = hs.fwd_link; l != UINT32_MAX; l = hs.fwd.arena_parent[l]) ends[n++] = hs.fwd.arena_end[l];
+        for (i = 0; i < n / 2; i++) {
+            int t = ends[i];
+            ends[i] = ends[n - 1 - i];
+            ends[n - 1 - i] = t;
+        }
+        for (l = hs.bwd_link; l != UINT32_MAX; l = hs.bwd.arena_parent[l]) ends[n++] = CG_OTHER(hs.bwd.arena_end[l]);
+
+        /* the sides only share the mt passes they were joined on; a pt contig may be on both */
+        uint16_t* used = hs.fwd.used;
+        memset(used, 0, graph->num_nodes * sizeof(uint16_t));
+        used[node] = 1;
+        int fits = 1;
+        for (m = 0; m < n && fits; m++) {
+            int v = CG_NODE(ends[m]);
+            if (pool->kind[v] != 0 && ++used[v] > pool->budget[v]) fits = 0;
+        }
+        if (fits) {
+            load_task(w, root);
+            for (m = 0; m < n; m++) path_push(w, graph->ctg[CG_NODE(ends[m])], CG_UTR(ends[m]));
+            path_push(w, node_s, s_utr);
+            w->path.type = 0;
+            w->path.nodelen -= pool->ctg_depth[node_s - 1].len;
+            path_up(w);
+        }
+        free(ends);
+    }
+    half_free(&hs.fwd);
+    half_free(&hs.bwd);
+}
 
-    for (k = kh_begin(src); k != kh_end(src); ++k) {
-        if (kh_exist(src, k)) {
-            int key = kh_key(src, k);
-            int value = kh_val(src, k);
-            khiter_t d = kh_put(node_num, dst, key, &ret);
-            if (ret != -1) {
-                kh_val(dst, d) = value;
+/* 
+ * walk from node_s taking the branch that adds the most unique mt length, the target when nothing is gained, 
+ * until the path closes or stops; the result is an incumbent for pruning
+ */
+static void greedy_walk(pathWorker* w, const pathTask* root)
+{
+    taskPool* pool = w->pool;
+    const CtgGraph* graph = pool->graph;
+    CtgDepth* ctg_depth = pool->ctg_depth;
+    nodePath* path = &w->path;
+    load_task(w, root);
+
+    int node_s = root->tail->node;
+    int s_utr = root->tail->utr;
+    int node = ctggraph_node(graph, node_s);
+    while (node >= 0 && path->nodenum < pool->max_node) {
+        int end = CG_END(node, s_utr == 3 ? 5 : 3);
+        uint32_t p, pick = UINT32_MAX;
+        uint64_t pick_gain = 0;
+        bool pick_close = false;
+        for (p = graph->off[end]; p < graph->off[end + 1]; p++) {
+            int v = CG_NODE(graph->nbr[p]);
+            int ctg = graph->ctg[v];
+            if (!budget_open(w, v)) continue;
+            uint64_t gain = 0;
+            if (pool->kind[v] == PATH_MT && w->visits[v] == 0) {
+                gain = ctg_depth[ctg - 1].len;
             }
+            bool close = path_closes(w, ctg, CG_UTR(graph->nbr[p]));
+            if (pick == UINT32_MAX || gain > pick_gain || (gain == pick_gain && close && !pick_close)) {
+                pick = p;
+                pick_gain = gain;
+                pick_close = close;
+            }
+        }
+        if (pick == UINT32_MAX) break;
+
+        node = CG_NODE(graph->nbr[pick]);
+        node_s = graph->ctg[node];
+        s_utr = CG_UTR(graph->nbr[pick]);
+        path_push(w, node_s, s_utr);
+        if (pick_close) {
+            path->type = 0;
+            path->nodelen -= ctg_depth[node_s - 1].len;
+            break;
         }
     }
+    path_up(w);
+}
 
-    return 0;
+/* a path the beam search may keep, with its score and the order it was met in */
+typedef struct {
+    pathTask task;                  /* tail NULL if the link could not be taken */
+    pathScore score;                /* keys only, no path arrays */
+    uint64_t key;                   /* state_key of the path */
+    uint32_t order;
+} beamCand;
+
+typedef struct {
+    pathWorker* workers;
+    pathTask* beam;
+    uint32_t* off;                  /* off[s]: first candidate of beam path s, one per link of its last end */
+    beamCand* cand;
+} beamStep;
+
+/* end of the chain graph a task path goes on from, -1 if it has none */
+static int beam_end(const taskPool* pool, const pathTask* task)
+{
+    int node = ctggraph_node(pool->graph, task->tail->node);
+    if (node < 0) return -1;
+    return pool->chains->end[CG_END(node, task->tail->utr == 3 ? 5 : 3)];
 }
 
-void bfsMap(int nodes, int utrs, int nodet, int utrt, CtgDepth *ctg_depth, mpath* current_path, khash_t(Ha_nodelink) *h_links, int max_paths, khash_t(node_num) *h_mito, khash_t(node_num) *h_chloro, int* path_t)
+/* the paths one chain longer than beam path s; the paths that end on the way are offered to path_up */
+static void beam_expand(void* data, long s, int tid)
 {
-    
-    typedef struct {
-        mpath mpath[2*max_paths];
-        int flag[2*max_paths];
-        int path_count;
-    } bfsPath;
-
-    bfsPath bfs_path;
-    bfs_path.path_count = 1;
-    bfs_path.mpath[0].nodenum = 1;
-    bfs_path.mpath[0].path = (int*)malloc(max_node * sizeof(int));
-    bfs_path.mpath[0].utr = (int*)malloc(max_node * sizeof(int));
-    bfs_path.mpath[0].type = 1;
-    bfs_path.mpath[0].pathlen = ctg_depth[nodes - 1].len;
-    bfs_path.mpath[0].path[0] = nodes;
-    bfs_path.mpath[0].utr[0] = utrs;
-
-    bfs_path.mpath[0].h_mito = kh_init(node_num);
-    bfs_path.mpath[0].h_chloro = kh_init(node_num);
-
-    kh_copy(bfs_path.mpath[0].h_mito, h_mito);
-    kh_copy(bfs_path.mpath[0].h_chloro, h_chloro);
+    beamStep* step = (beamStep*)data;
+    pathWorker* w = &step->workers[tid];
+    taskPool* pool = w->pool;
+    const CtgGraph* chain_graph = pool->chain_graph;
+    const CtgChains* chains = pool->chains;
+    nodePath* path = &w->path;
+    beamCand* cand = step->cand + step->off[s];
+    int end = beam_end(pool, &step->beam[s]);
+    load_task(w, &step->beam[s]);
+
+    uint32_t i, k = 0;
+    bool path_stop = true;
+    for (i = end < 0 ? 0 : chain_graph->off[end]; end >= 0 && i < chain_graph->off[end + 1]; i++, k++) {
+        cand[k].task.tail = NULL;
+        if (pool->stop) continue;
+        int u = CG_NODE(chain_graph->nbr[i]);
+        uint32_t n = enter_chain(w, u, chain_graph->nbr[i] == CG_END(u, chains->utr[chains->off[u]]));
+        if (n == 0) continue;
+        path_stop = false;
 
-    uint64_t i, j;
-    for (i = 0; i < 2*max_paths; i++) {
-        bfs_path.flag[i] = 1;
+        int node_s = path->node[path->nodenum - 1];
+        int s_utr = path->utr[path->nodenum - 1];
+        if (n < chains->off[u + 1] - chains->off[u]) {
+            /* the budgets ran out inside the chain: the path ends at its last contig */
+            path->type = 1;
+            path_up(w);
+        } else if (!path_arrive(w, node_s, s_utr)) {
+            if (++w->expanded == PATH_CHECK) path_budget(w);
+            score_path(w, &cand[k].score);
+            if ((float)cand[k].score.uniq_mt_pathlen / pool->mt_uniq_len > 0.5) path_up(w);
+            /* beam_cmp ranks by every key: the ones path_better leaves out for this taxon are cleared */
+            if (pool->taxo == 1) cand[k].score.uniq_pt_nodenum = cand[k].score.pt_nodenum = 0;
+            cand[k].score.path_node = NULL;
+            cand[k].score.path_utr = NULL;
+            cand[k].key = state_key(w, ctggraph_node(pool->graph, node_s), s_utr);
+            cand[k].task = spine_task(w);
+        }
+        path->type = 1;
+        leave_chain(w, u, n);
     }
+    if (path_stop) path_up(w);
+}
 
-    int dy_path_count = 1;
-    int dy_temp_end = 0;
-    while (1)
-    {
-        int temp_end = 0;
-        for (i = 0; i < dy_path_count; i++)
-        {
-            if (bfs_path.flag[i] == 0) continue;
-            temp_end = 1;
-            int endutr = bfs_path.mpath[i].utr[bfs_path.mpath[i].nodenum - 1];
-            int endnode = bfs_path.mpath[i].path[bfs_path.mpath[i].nodenum - 1];
-            khiter_t k = kh_get(Ha_nodelink, h_links, endnode);
-            if (k == kh_end(h_links)) {
-                continue;
+/* rank beam candidates as path_up ranks paths, equal scores in the order they were met */
+static int beam_cmp(const void* a, const void* b)
+{
+    const beamCand* x = (const beamCand*)a;
+    const beamCand* y = (const beamCand*)b;
+    int c = path_keys_cmp(&x->score, &y->score, 1);
+    if (c != 0) return c;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+/* 
+ * search a chain at a time from the roots, keeping after each step only the width paths path_up ranks first, 
+ * no two in the same state, for structures of too many contigs to search them all. The paths of a step are 
+ * extended in parallel and ranked after, so the paths kept do not depend on the thread count
+ */
+static void beam_search(pathWorker* workers, int num_workers, const pathTask* roots, int num_roots, int width)
+{
+    taskPool* pool = workers[0].pool;
+    uint32_t cap = width > num_roots ? width : num_roots;
+    beamStep step;
+    step.workers = workers;
+    step.beam = (pathTask*)malloc(cap * sizeof(pathTask));
+    step.off = (uint32_t*)malloc((cap + 1) * sizeof(uint32_t));
+    step.cand = NULL;
+    memcpy(step.beam, roots, num_roots * sizeof(pathTask));
+    khash_t(beam_seen)* seen = kh_init(beam_seen);
+
+    uint32_t s, i, num = num_roots, num_cand = 0, steps = 0;
+    while (num > 0 && !pool->stop) {
+        uint32_t total = 0;
+        for (s = 0; s < num; s++) {
+            int end = beam_end(pool, &step.beam[s]);
+            step.off[s] = total;
+            if (end >= 0) total += ctggraph_degree(pool->chain_graph, end);
+        }
+        step.off[num] = total;
+        if (total > num_cand) {
+            num_cand = total;
+            step.cand = (beamCand*)realloc(step.cand, num_cand * sizeof(beamCand));
+        }
+        kt_for(num_workers, beam_expand, &step, num);
+        for (s = 0; s < num; s++) link_release(step.beam[s].tail);
+
+        uint32_t n = 0;
+        for (i = 0; i < total; i++) {
+            if (step.cand[i].task.tail == NULL) continue;
+            step.cand[n] = step.cand[i];
+            step.cand[n++].order = i;
+        }
+        qsort(step.cand, n, sizeof(beamCand), beam_cmp);
+        kh_clear(beam_seen, seen);
+        num = 0;
+        for (i = 0; i < n; i++) {
+            int absent = 0;
+            if (num < width) kh_put(beam_seen, seen, step.cand[i].key, &absent);
+            if (absent) {
+                step.beam[num++] = step.cand[i].task;
+            } else {
+                link_release(step.cand[i].task.tail);
             }
-            nodeLink* node_links = &kh_val(h_links, k);
+        }
+        steps++;
+    }
+    for (s = 0; s < num; s++) link_release(step.beam[s].tail);
+    log_message(INFO, "Beam search of %d paths: %u steps", width, steps);
+    kh_destroy(beam_seen, seen);
+    free(step.beam);
+    free(step.off);
+    free(step.cand);
+}
 
-            int* tempmap = endutr == 3 ? node_links->node5 : node_links->node3;
-            int* temputr = endutr == 3 ? node_links->node5utr : node_links->node3utr;
-            int tempmapnum = endutr == 3 ? node_links->node5num : node_links->node3num;
+static void path_start(pathRun* run, int id);
 
-            if (tempmapnum == 1 && bfs_path.flag[i] == 1) {
+/* 
+ * run a task of the search of run on thread id; a task without a path starts the search. When the last task 
+ * of a structure ends, its path is kept for the flushes of the structures after it
+ */
+static void path_task(pathRun* run, int id, pathTask* task)
+{
+    taskPool* pool = &run->pool;
+    taskShare* share = pool->share;
+    pathWorker* w = &run->workers[id];
+    log_capture(pool->log);
+    if (task->tail == NULL) {
+        path_start(run, id);
+    } else {
+        if (!pool->stop) {
+            load_task(w, task);
+            bfs_m(w, task->tail->node, task->tail->utr);
+        }
+        link_release(task->tail);
+    }
+    log_capture(NULL);
 
-                if (tempmap[0] == nodet && temputr[0] == utrt) {
-                    bfs_path.flag[i] = 0;
-                    continue;
-                }
+    pthread_mutex_lock(&share->lock);
+    if (--pool->num_pending == 0) {
+        float ratio = (float)pool->best.uniq_mt_pathlen / pool->mt_uniq_len;
+        if (pool->best.node_num > 0 && ratio >= 0.1) share->done[pool->index] = pool->best;
+        while (share->front < share->num_runs && share->runs[share->front].pool.num_pending == 0) share->front++;
+    }
+    if (--share->num_pending == 0) pthread_cond_broadcast(&share->cond);
+    pthread_mutex_unlock(&share->lock);
+}
 
-                bool is_chloro = kh_get(node_num, bfs_path.mpath[i].h_chloro, tempmap[0]) != kh_end(bfs_path.mpath[i].h_chloro);
-                bool is_mito = kh_get(node_num, bfs_path.mpath[i].h_mito, tempmap[0]) != kh_end(bfs_path.mpath[i].h_mito);
+/* take tasks of the first structures first, so that they are done, and flushed, in order */
+static void* path_thread(void* args) {
+    pathThread* t = (pathThread*)args;
+    taskShare* share = t->share;
+    pathTask task;
+    int i;
+    while (1) {
+        for (i = share->front; i < share->num_runs; i++) {
+            if (share->runs[i].workers != NULL && take_task(&share->runs[i].pool, t->id, &task)) break;
+        }
+        if (i < share->num_runs) {
+            path_task(&share->runs[i], t->id, &task);
+            continue;
+        }
 
-                if (is_chloro && kh_value(bfs_path.mpath[i].h_chloro, kh_get(node_num, bfs_path.mpath[i].h_chloro, tempmap[0])) > 1) {bfs_path.flag[i] = 0; continue;}
-                if (is_mito && kh_value(bfs_path.mpath[i].h_mito, kh_get(node_num, bfs_path.mpath[i].h_mito, tempmap[0])) == 0) {bfs_path.flag[i] = 0; continue;}
-                if (is_mito) kh_value(bfs_path.mpath[i].h_mito, kh_get(node_num, bfs_path.mpath[i].h_mito, tempmap[0]))--;
-                if (is_chloro) kh_value(bfs_path.mpath[i].h_chloro, kh_get(node_num, bfs_path.mpath[i].h_chloro, tempmap[0]))++;
-                
-                bfs_path.mpath[i].nodenum++;
-                bfs_path.mpath[i].path = (int*)realloc(bfs_path.mpath[i].path, bfs_path.mpath[i].nodenum * sizeof(int));
-                bfs_path.mpath[i].utr = (int*)realloc(bfs_path.mpath[i].utr, bfs_path.mpath[i].nodenum * sizeof(int));
-                bfs_path.mpath[i].path[bfs_path.mpath[i].nodenum - 1] = tempmap[0];
-                bfs_path.mpath[i].pathlen += ctg_depth[tempmap[0] - 1].len;
-                bfs_path.mpath[i].utr[bfs_path.mpath[i].nodenum - 1] = temputr[0];
-
-                if (tempmap[0] == nodet) {
-                    bfs_path.flag[i] = 0;
-                    bfs_path.mpath[i].type = 0;
-                    continue;
-                }
+        pthread_mutex_lock(&share->lock);
+        if (share->num_pending == 0) {
+            pthread_mutex_unlock(&share->lock);
+            break;
+        }
+        if (share->num_queued == 0) {
+            share->num_idle++;
+            pthread_cond_wait(&share->cond, &share->lock);
+            share->num_idle--;
+        }
+        pthread_mutex_unlock(&share->lock);
+    }
+    return NULL;
+}
 
-                bfs_path.mpath[i].type = 1;
-
-            } else if (tempmapnum > 1 && bfs_path.flag[i] == 1) {
-                mpath temp_mpath = bfs_path.mpath[i];
-                int dy_path_index = i;
-                for (j = 0; j < tempmapnum; j++) 
-                {
-                    if (tempmap[0] == nodet && temputr[0] == utrt) {
-                        bfs_path.flag[i] = 0;
-                        break;
-                    }
-                
-                    bool is_chloro = kh_get(node_num, bfs_path.mpath[i].h_chloro, tempmap[j]) != kh_end(bfs_path.mpath[i].h_chloro);
-                    bool is_mito = kh_get(node_num, bfs_path.mpath[i].h_mito, tempmap[j]) != kh_end(bfs_path.mpath[i].h_mito);
-
-                    if (is_chloro && kh_value(bfs_path.mpath[i].h_chloro, kh_get(node_num, bfs_path.mpath[i].h_chloro, tempmap[j])) > 1) {bfs_path.flag[dy_path_index] = 0; continue;}
-                    if (is_mito && kh_value(bfs_path.mpath[i].h_mito, kh_get(node_num, bfs_path.mpath[i].h_mito, tempmap[j])) == 0) {bfs_path.flag[dy_path_index] = 0; continue;}
-
-                    bfs_path.mpath[dy_path_index].nodenum = temp_mpath.nodenum;
-                    bfs_path.mpath[dy_path_index].path = (int*)malloc(max_node * sizeof(int));
-                    memcpy(bfs_path.mpath[dy_path_index].path, temp_mpath.path, temp_mpath.nodenum * sizeof(int));
-                    bfs_path.mpath[dy_path_index].utr = (int*)malloc(max_node * sizeof(int));
-                    memcpy(bfs_path.mpath[dy_path_index].utr, temp_mpath.utr, temp_mpath.nodenum * sizeof(int));
-                    bfs_path.mpath[dy_path_index].pathlen = temp_mpath.pathlen;
-                    bfs_path.mpath[dy_path_index].type = 1;
-
-                    bfs_path.mpath[dy_path_index].h_mito = kh_init(node_num);
-                    bfs_path.mpath[dy_path_index].h_chloro = kh_init(node_num);
-                    kh_copy(bfs_path.mpath[dy_path_index].h_mito, temp_mpath.h_mito);
-                    kh_copy(bfs_path.mpath[dy_path_index].h_chloro, temp_mpath.h_chloro);
-
-                    if (is_mito) kh_value(bfs_path.mpath[dy_path_index].h_mito, kh_get(node_num, bfs_path.mpath[dy_path_index].h_mito, tempmap[j]))--;
-                    if (is_chloro) kh_value(bfs_path.mpath[dy_path_index].h_chloro, kh_get(node_num, bfs_path.mpath[dy_path_index].h_chloro, tempmap[j]))++;
-                    
-                    bfs_path.mpath[dy_path_index].nodenum++;
-                    bfs_path.mpath[dy_path_index].path[bfs_path.mpath[dy_path_index].nodenum - 1] = tempmap[j];
-                    bfs_path.mpath[dy_path_index].utr[bfs_path.mpath[dy_path_index].nodenum - 1] = temputr[j];
-                    bfs_path.mpath[dy_path_index].pathlen += ctg_depth[tempmap[j] - 1].len;
-
-                    if (tempmap[j] == nodet) {
-                        bfs_path.flag[dy_path_index] = 0;
-                        bfs_path.mpath[dy_path_index].type = 0;
-                    }
-                    
-                    dy_path_index = bfs_path.path_count;
-                    bfs_path.path_count++;
-                }
-                bfs_path.path_count--;
-            } else if (tempmapnum == 0 && bfs_path.flag[i] == 1) {
-                bfs_path.flag[i] = 0;
+/* 
+ * a pendant block of a circular structure: the side of a bridge away from the start. A circle enters it 
+ * through the bridge and comes back out the same way, which passes the contigs at both ends of the bridge twice
+ */
+typedef struct {
+    int link;
+    int x_end;          /* end of the bridge on the side of the start */
+    int y_end;          /* end of the bridge in the block */
+    int start;          /* longest single-copy mt contig of the block, which its search starts from */
+    int num_nodes;
+} pathBlock;
+
+static int block_cmp(const void* a, const void* b)
+{
+    const pathBlock* x = (const pathBlock*)a;
+    const pathBlock* y = (const pathBlock*)b;
+    if (x->num_nodes != y->num_nodes) return x->num_nodes > y->num_nodes ? -1 : 1;
+    return x->link - y->link;
+}
+
+/* stamp the nodes reached from node without taking link; returns their number */
+static int block_reach(const CtgGraph* graph, int node, int link, uint32_t* reach, uint32_t stamp, int* queue)
+{
+    int head = 0, num = 0;
+    uint32_t p;
+    reach[node] = stamp;
+    queue[num++] = node;
+    while (head < num) {
+        int v = queue[head++];
+        for (p = graph->off[v << 1]; p < graph->off[(v << 1) + 2]; p++) {
+            int u = CG_NODE(graph->nbr[p]);
+            if (graph->link[p] == link || reach[u] == stamp) continue;
+            reach[u] = stamp;
+            queue[num++] = u;
+        }
+    }
+    return num;
+}
+
+/* 
+ * the part of graph with side[node] == part, with a link from each end of turn back to itself that stands 
+ * for what lies beyond it. Link ends and depths are by link of graph
+ */
+static CtgGraph* block_graph(const CtgGraph* graph, const int* link_end, const float* link_depth, const int* side, int part, 
+                             const int* turn, const float* turn_depth, int num_turns)
+{
+    uint64_t i;
+    int num_ctgs = 0, num_links = 0;
+    int* ctgs = (int*)malloc((graph->num_nodes + 1) * sizeof(int));
+    BFSlinks* links = (BFSlinks*)calloc(graph->num_links + num_turns + 1, sizeof(BFSlinks));
+    for (i = 0; i < graph->num_nodes; i++) {
+        if (side[i] == part) ctgs[num_ctgs++] = graph->ctg[i];
+    }
+    for (i = 0; i < graph->num_links; i++) {
+        int a = link_end[2 * i], b = link_end[2 * i + 1];
+        if (a < 0 || side[CG_NODE(a)] != part || side[CG_NODE(b)] != part) continue;
+        links[num_links].lctgsmp = graph->ctg[CG_NODE(a)];
+        links[num_links].lutrsmp = CG_UTR(a);
+        links[num_links].rctgsmp = graph->ctg[CG_NODE(b)];
+        links[num_links].rutrsmp = CG_UTR(b);
+        links[num_links].linkdepth = link_depth[i];
+        num_links++;
+    }
+    for (i = 0; i < num_turns; i++) {
+        links[num_links].lctgsmp = links[num_links].rctgsmp = graph->ctg[CG_NODE(turn[i])];
+        links[num_links].lutrsmp = links[num_links].rutrsmp = CG_UTR(turn[i]);
+        links[num_links].linkdepth = turn_depth[i];
+        num_links++;
+    }
+    CtgGraph* sub = ctggraph_build(links, num_links, ctgs, num_ctgs);
+    free(ctgs);
+    free(links);
+    return sub;
+}
+
+static void path_run(pathJob* jobs, int num_jobs, CtgDepth* ctg_depth, int* pt_contigs, int pt_num, int taxo, int num_threads, 
+    const pathLimits* limits, const taskPool* parent);
+
+/* best circle through sub from start, found by a search of its own within the budgets of pool, which does not flush its paths */
+static int block_circle(const taskPool* pool, CtgGraph* sub, int start, int s_utr, int t_utr, pathScore* circle)
+{
+    uint64_t i;
+    int* mt = (int*)malloc((pool->mt_num + 1) * sizeof(int));
+    int* pt = (int*)malloc((pool->pt_num + 1) * sizeof(int));
+    int mt_num = 0, pt_num = 0;
+    for (i = 0; i < pool->mt_num; i++) {
+        if (ctggraph_node(sub, pool->mt_contigs[i]) >= 0) mt[mt_num++] = pool->mt_contigs[i];
+    }
+    for (i = 0; i < pool->pt_num; i++) {
+        if (ctggraph_node(sub, pool->pt_contigs[i]) >= 0) pt[pt_num++] = pool->pt_contigs[i];
+    }
+    pathLimits limits;
+    if (pool->limits != NULL) {
+        limits = *pool->limits;
+        limits.pack = NULL;
+    }
+
+    pathJob job;
+    memset(&job, 0, sizeof(pathJob));
+    job.search = 1;
+    job.graph = sub;
+    job.mt_contigs = mt;
+    job.mt_num = mt_num;
+    job.ctg_s = start;
+    job.utr_s = s_utr;
+    job.utr_e = t_utr;
+    path_run(&job, 1, pool->ctg_depth, pt, pt_num, pool->taxo, pool->num_threads, pool->limits != NULL ? &limits : NULL, pool);
+    *circle = job.path;
+    free(mt);
+    free(pt);
+    return job.flag_err == 0 && circle->node_num > 1 && circle->type == 0;
+}
+
+/* i of the only pair of passes i, i + 1 of s that turns back at end (ctg, utr), or -1 */
+static int64_t path_turn(const pathScore* s, int ctg, int utr)
+{
+    int64_t at = -1;
+    uint32_t i;
+    for (i = 0; i + 1 < s->node_num; i++) {
+        if (s->path_node[i] != ctg || s->path_utr[i] == utr || s->path_node[i + 1] != ctg || s->path_utr[i + 1] != utr) continue;
+        if (at >= 0) return -1;
+        at = i;
+    }
+    return at;
+}
+
+/* score a circle given by its passes the way the search counts them: the start closes it again */
+static void score_circle(const taskPool* pool, pathScore* s)
+{
+    const CtgGraph* graph = pool->graph;
+    uint32_t* visits = (uint32_t*)calloc(graph->num_nodes, sizeof(uint32_t));
+    uint32_t i;
+    s->uniq_mt_pathlen = s->path_len = 0;
+    s->uniq_mt_nodenum = s->mt_nodenum = 0;
+    s->uniq_pt_nodenum = s->pt_nodenum = 0;
+    for (i = 0; i < s->node_num; i++) {
+        int ctg = s->path_node[i];
+        if (i + 1 < s->node_num) s->path_len += pool->ctg_depth[ctg - 1].len;
+        int v = ctggraph_node(graph, ctg);
+        if (v < 0 || pool->kind[v] == 0) continue;
+        if (pool->kind[v] == PATH_PT) {
+            if (visits[v]++ == 0) s->uniq_pt_nodenum++;
+            s->pt_nodenum++;
+        } else {
+            if (visits[v]++ == 0) {
+                s->uniq_mt_nodenum++;
+                s->uniq_mt_pathlen += pool->ctg_depth[ctg - 1].len;
             }
+            s->mt_nodenum++;
         }
+    }
+    s->type = 0;
+    s->inval_num = 0;
+    free(visits);
+}
 
-        if (bfs_path.path_count >= max_paths || temp_end == 0) {
-            break;
+/* 1 if circle s passes no contig more often than its budget in pool allows; the start does not use one */
+static int circle_fits(const taskPool* pool, const pathScore* s)
+{
+    uint16_t* used = (uint16_t*)calloc(pool->graph->num_nodes, sizeof(uint16_t));
+    uint32_t i;
+    int fits = 1;
+    for (i = 1; i < s->node_num && fits; i++) {
+        int v = ctggraph_node(pool->graph, s->path_node[i]);
+        if (v >= 0 && pool->kind[v] != 0 && ++used[v] > pool->budget[v]) fits = 0;
+    }
+    free(used);
+    return fits;
+}
+
+/* 
+ * circle through a large structure by its pendant blocks. Every block is searched on its own, as a circle 
+ * that turns back at the end of its bridge, and the rest with the blocks replaced by turns at the other ends; 
+ * the circles of the blocks are spliced in where the circle of the rest turns. The search of each part may 
+ * split it further. Returns 1 with the circle in out, 0 if the structure has no such blocks or a part finds 
+ * no circle that turns back once
+ */
+static int split_search(const taskPool* pool, pathScore* out)
+{
+    const CtgGraph* graph = pool->graph;
+    int node_s = ctggraph_node(graph, pool->node_t);
+    if (graph->num_nodes <= PATH_SPLIT_NODES || graph->num_links == 0 || node_s < 0 || pool->s_utr == pool->t_utr) return 0;
+    uint8_t* bridge = (uint8_t*)malloc(graph->num_links);
+    if (ctggraph_bridges(graph, bridge) == 0) {
+        free(bridge);
+        return 0;
+    }
+
+    uint64_t i, j;
+    uint32_t p;
+    int* link_end = (int*)malloc(2 * graph->num_links * sizeof(int));
+    float* link_depth = (float*)malloc(graph->num_links * sizeof(float));
+    for (i = 0; i < 2 * graph->num_links; i++) link_end[i] = -1;
+    for (i = 0; i < 2 * graph->num_nodes; i++) {
+        for (p = graph->off[i]; p < graph->off[i + 1]; p++) {
+            int l = graph->link[p];
+            if (link_end[2 * l] >= 0) continue;
+            link_end[2 * l] = i;
+            link_end[2 * l + 1] = graph->nbr[p];
+            link_depth[l] = graph->depth[p];
         }
-        dy_path_count = bfs_path.path_count;
-    }
-
-    *path_t = 0;
-    for (i = 0; i < bfs_path.path_count; i++) {
-        // int sk = 0;
-
-        // for (int j = 0; j < bfs_path.mpath[i].nodenum; j++)
-        // {
-        //     bool is_chloro = kh_get(node_num, bfs_path.mpath[i].h_chloro, bfs_path.mpath[i].path[j]) != kh_end(bfs_path.mpath[i].h_chloro);
-        //     bool is_mito = kh_get(node_num, bfs_path.mpath[i].h_mito, bfs_path.mpath[i].path[j]) != kh_end(bfs_path.mpath[i].h_mito);
-
-        //     if (is_chloro && kh_value(bfs_path.mpath[i].h_chloro, kh_get(node_num, bfs_path.mpath[i].h_chloro, bfs_path.mpath[i].path[j])) > 1) {
-        //         sk = 1;
-        //         break;
-        //     }
-        //     if (is_mito && (kh_value(bfs_path.mpath[i].h_mito, kh_get(node_num, bfs_path.mpath[i].h_mito, bfs_path.mpath[i].path[j])) < 0)) {
-        //         sk = 1;
-        //         break;
-        //     }
-        // }
-        // if (sk == 1) continue;
-        current_path[*path_t].nodenum = bfs_path.mpath[i].nodenum;
-        current_path[*path_t].pathlen = bfs_path.mpath[i].pathlen;
-        current_path[*path_t].type = bfs_path.mpath[i].type;
-
-        current_path[*path_t].path = (int*)malloc(max_node * sizeof(int));
-        current_path[*path_t].utr = (int*)malloc(max_node * sizeof(int));
-        
-        memcpy(current_path[*path_t].path, bfs_path.mpath[i].path, bfs_path.mpath[i].nodenum * sizeof(int));
-        memcpy(current_path[*path_t].utr, bfs_path.mpath[i].utr, bfs_path.mpath[i].nodenum * sizeof(int));
+    }
 
-        current_path[*path_t].h_mito = kh_init(node_num);
-        current_path[*path_t].h_chloro = kh_init(node_num);
-        kh_copy(current_path[*path_t].h_mito, bfs_path.mpath[i].h_mito);
-        kh_copy(current_path[*path_t].h_chloro, bfs_path.mpath[i].h_chloro);
-        (*path_t)++;
+    /* bridges between contigs of two passes or more, with a block of enough contigs and a single-copy one beyond */
+    uint32_t* reach = (uint32_t*)calloc(graph->num_nodes, sizeof(uint32_t));
+    int* queue = (int*)malloc(graph->num_nodes * sizeof(int));
+    pathBlock* blocks = (pathBlock*)malloc(graph->num_links * sizeof(pathBlock));
+    int num_blocks = 0;
+    uint32_t stamp = 0;
+    for (i = 0; i < graph->num_links; i++) {
+        int a = link_end[2 * i], b = link_end[2 * i + 1];
+        if (!bridge[i] || a < 0) continue;
+        if (pool->kind[CG_NODE(a)] != PATH_MT || pool->kind[CG_NODE(b)] != PATH_MT || 
+            pool->budget[CG_NODE(a)] < 2 || pool->budget[CG_NODE(b)] < 2) continue;
+        int num = graph->num_nodes - block_reach(graph, node_s, i, reach, ++stamp, queue);
+        pathBlock* blk = &blocks[num_blocks];
+        blk->link = i;
+        blk->x_end = reach[CG_NODE(a)] == stamp ? a : b;
+        blk->y_end = blk->x_end == a ? b : a;
+        blk->num_nodes = num;
+        blk->start = -1;
+        if (CG_NODE(blk->x_end) == node_s || num < PATH_BLOCK_NODES) continue;
+        uint32_t len = 0;
+        for (j = 0; j < graph->num_nodes; j++) {
+            int ctg = graph->ctg[j];
+            if (reach[j] == stamp || pool->kind[j] != PATH_MT || pool->budget[j] != 1) continue;
+            if (pool->ctg_depth[ctg - 1].len > len) {
+                len = pool->ctg_depth[ctg - 1].len;
+                blk->start = ctg;
+            }
+        }
+        if (blk->start > 0) num_blocks++;
     }
 
-    for (i = 0; i < bfs_path.path_count; i++) {
-            free(bfs_path.mpath[i].path);
-            free(bfs_path.mpath[i].utr);
-            kh_destroy(node_num, bfs_path.mpath[i].h_mito);
-            kh_destroy(node_num, bfs_path.mpath[i].h_chloro);
+    /* the blocks of bridges further out lie inside those of the bridges nearer the start, which are searched */
+    qsort(blocks, num_blocks, sizeof(pathBlock), block_cmp);
+    int* side = (int*)calloc(graph->num_nodes, sizeof(int));
+    int num_kept = 0;
+    for (i = 0; i < num_blocks; i++) {
+        pathBlock* blk = &blocks[i];
+        int nested = side[CG_NODE(blk->x_end)] != 0;
+        for (j = 0; j < num_kept && !nested; j++) nested = blocks[j].x_end == blk->x_end;
+        if (nested) continue;
+        block_reach(graph, node_s, blk->link, reach, ++stamp, queue);
+        for (j = 0; j < graph->num_nodes; j++) {
+            if (reach[j] != stamp) side[j] = num_kept + 1;
+        }
+        blocks[num_kept++] = *blk;
     }
-}
 
-void* thread_bfs_m(void* args) {
-    bfs_m_args* bfs_args = (bfs_m_args*)args;
+    int ok = num_kept > 0;
+    pathScore* circles = (pathScore*)calloc(num_kept + 1, sizeof(pathScore));
+    int64_t* at = (int64_t*)malloc((num_kept + 1) * sizeof(int64_t));
+    int* turn = (int*)malloc((num_kept + 1) * sizeof(int));
+    float* turn_depth = (float*)malloc((num_kept + 1) * sizeof(float));
+    if (ok) log_message(INFO, "M-path search split at %d bridges", num_kept);
+    for (i = 0; i < num_kept && ok; i++) {
+        pathBlock* blk = &blocks[i];
+        CtgGraph* sub = block_graph(graph, link_end, link_depth, side, i + 1, &blk->y_end, &link_depth[blk->link], 1);
+        ok = block_circle(pool, sub, blk->start, 5, 3, &circles[i]);
+        ctggraph_free(sub);
+        if (ok) at[i] = path_turn(&circles[i], graph->ctg[CG_NODE(blk->y_end)], CG_UTR(blk->y_end));
+        ok = ok && at[i] >= 0;
+        turn[i] = blk->x_end;
+        turn_depth[i] = link_depth[blk->link];
+    }
+    pathScore* rest = &circles[num_kept];
+    if (ok) {
+        CtgGraph* sub = block_graph(graph, link_end, link_depth, side, 0, turn, turn_depth, num_kept);
+        ok = block_circle(pool, sub, pool->node_t, pool->s_utr, pool->t_utr, rest);
+        ctggraph_free(sub);
+    }
 
-    bfs_m(bfs_args->node1, bfs_args->utr1, bfs_args->node2, bfs_args->utr2,
-          bfs_args->main_num, bfs_args->mainlinks, bfs_args->ctg_depth,
-          bfs_args->current_path, bfs_args->path_score,
-          bfs_args->mt_contigs, bfs_args->mt_num, bfs_args->h_mito,
-          bfs_args->pt_contigs, bfs_args->pt_num, bfs_args->h_chloro,
-          bfs_args->h_links, &bfs_args->stop_flag);
-    return NULL;
+    if (ok) {
+        /* splice every block in, from the pass after its turn round to the turn */
+        int* block_at = (int*)malloc(rest->node_num * sizeof(int));
+        uint32_t num = rest->node_num;
+        for (i = 0; i < rest->node_num; i++) block_at[i] = -1;
+        for (i = 0; i < num_kept && ok; i++) {
+            int64_t k = path_turn(rest, graph->ctg[CG_NODE(turn[i])], CG_UTR(turn[i]));
+            ok = k >= 0;
+            if (ok) block_at[k] = i;
+            num += circles[i].node_num - 1;
+        }
+        if (ok) {
+            out->node_num = 0;
+            out->path_node = (int*)malloc(num * sizeof(int));
+            out->path_utr = (int*)malloc(num * sizeof(int));
+            for (i = 0; i < rest->node_num; i++) {
+                out->path_node[out->node_num] = rest->path_node[i];
+                out->path_utr[out->node_num++] = rest->path_utr[i];
+                if (block_at[i] < 0) continue;
+                pathScore* c = &circles[block_at[i]];
+                uint32_t n = c->node_num - 1;
+                for (j = 1; j <= n; j++) {
+                    out->path_node[out->node_num] = c->path_node[(at[block_at[i]] + j) % n];
+                    out->path_utr[out->node_num++] = c->path_utr[(at[block_at[i]] + j) % n];
+                }
+            }
+            score_circle(pool, out);
+            ok = circle_fits(pool, out);
+            if (!ok) {
+                free(out->path_node);
+                free(out->path_utr);
+                out->node_num = 0;
+            }
+        }
+        free(block_at);
+    }
+    if (num_kept > 0 && !ok) log_message(INFO, "No M-path by blocks, searching the structure whole");
+
+    for (i = 0; i <= num_kept; i++) {
+        free(circles[i].path_node);
+        free(circles[i].path_utr);
+    }
+    free(circles);
+    free(at);
+    free(turn);
+    free(turn_depth);
+    free(side);
+    free(blocks);
+    free(queue);
+    free(reach);
+    free(link_end);
+    free(link_depth);
+    free(bridge);
+    return ok;
 }
 
-void findMpath(int node1, int node1utr, int node2, int node2utr, int main_num, BFSlinks* mainlinks, CtgDepth *ctg_depth, 
-    int* mt_contigs, int mt_num, int* pt_contigs, int pt_num, int* flag_err, float* mt_ratio, int taxo, pathScore* struc_path)
+/* 
+ * set up the search of job as run index of share: budgets, chains, pool and workers. A block of a split search 
+ * passes the structure's pool as parent, whose budgets cap its own. Returns 0, with flag_err set, if the 
+ * structure cannot be searched
+ */
+static int path_init(pathRun* run, pathJob* job, taskShare* share, int index, CtgDepth *ctg_depth, int* pt_contigs, int pt_num, 
+    int taxo, int num_threads, const pathLimits* limits, const taskPool* parent)
 {
-    taxo_index = taxo;
-    max_node = 1;
-    mt_uniq = 0;
-    mt_uniq_len = 0;
+    int node1 = job->ctg_s, node1utr = job->utr_s, node2 = job->ctg_s, node2utr = job->utr_e;
+    const CtgGraph* main_graph = job->graph;
+    int* mt_contigs = job->mt_contigs;
+    int mt_num = job->mt_num;
+    uint32_t max_node = 1;
+    uint64_t mt_uniq_len = 0;
 
     int mt_depth = ctg_depth[node1 - 1].depth;
     float min_depth = mt_depth;
@@ -738,8 +2050,6 @@ void findMpath(int node1, int node1utr, int node2, int node2utr, int main_num, B
     /* Initialize hash tables for mitochondria and chloroplast contigs */
     khash_t(node_num) *h_mito = kh_init(node_num);
     khash_t(node_num) *h_chloro = kh_init(node_num);
-    khash_t(Ha_nodelink) *h_links = kh_init(Ha_nodelink);
-    khash_t(Ha_nodedepth) *h_depth = kh_init(Ha_nodedepth);
 
     /* Calculate max pass count for mitochondria contigs */
     int maxnum_mito = 0;
@@ -772,8 +2082,10 @@ void findMpath(int node1, int node1utr, int node2, int node2utr, int main_num, B
             float denom = (mt_depth + min_depth) / 2;
             if (denom <= 0) {
                 log_message(ERROR, "Invalid denominator for contig depth calculation.\n");
-                *flag_err = 1;
-                return;
+                job->flag_err = 1;
+                kh_destroy(node_num, h_mito);
+                kh_destroy(node_num, h_chloro);
+                return 0;
             }
 
             kh_value(h_mito, k) = (int)(ctg_depth[mt_contigs[i] - 1].depth / denom + 0.5);
@@ -788,7 +2100,6 @@ void findMpath(int node1, int node1utr, int node2, int node2utr, int main_num, B
 
             maxnum_mito += kh_value(h_mito, k);
             mt_uniq_len += ctg_depth[mt_contigs[i] - 1].len;
-            mt_uniq++;
         }
     }
     max_node = pt_num*5 + maxnum_mito + 1;
@@ -809,310 +2120,287 @@ void findMpath(int node1, int node1utr, int node2, int node2utr, int main_num, B
         kh_value(h_chloro, k) = 0;  // Initially, no chloroplast contig is passed
     }
 
-    for (i = 0; i < mt_num; i++) 
-    {
-        k = kh_put(Ha_nodedepth, h_depth, mt_contigs[i], &ret);
-        kh_value(h_depth, k) = ctg_depth[mt_contigs[i] - 1].depth;
-    }
-    g_sort_hash = h_depth;
-
-    /* Initialize h_links hash table */
-    if (mt_num == 1 && main_num == 1) {
-        nodeLink node_links;
-        node_links.node3num = 1;
-        node_links.node5num = 1;
-        node_links.node3 = (int*) malloc(1 * sizeof(int));
-        node_links.node3[0] = mt_contigs[0];
-        node_links.node3utr = (int*) malloc(1 * sizeof(int));
-        node_links.node3utr[0] = 5;
-        node_links.node5 = (int*) malloc(1 * sizeof(int));
-        node_links.node5[0] = mt_contigs[0];
-        node_links.node5utr = (int*) malloc(1 * sizeof(int));
-        node_links.node5utr[0] = 3;
-        k = kh_put(Ha_nodelink, h_links, mt_contigs[0], &ret);
-        kh_value(h_links, k) = node_links;
-    } else {
-        for (i = 0; i < mt_num; i++) 
-        {
-            nodeLink node_links;
-            node_links.node3num = 0;
-            node_links.node5num = 0;
-            node_links.node3 = (int*) malloc(10 * sizeof(int));
-            node_links.node3utr = (int*) malloc(10 * sizeof(int));
-            node_links.node5 = (int*) malloc(10 * sizeof(int));
-            node_links.node5utr = (int*) malloc(10 * sizeof(int));
-
-            k = kh_put(Ha_nodelink, h_links, mt_contigs[i], &ret);
-            for (j = 0; j < main_num; j++) 
-            {
-                if (mainlinks[j].lctgsmp == mt_contigs[i] || mainlinks[j].rctgsmp == mt_contigs[i]) {
-                    if (mainlinks[j].lctgsmp == mt_contigs[i] && mainlinks[j].lutrsmp == 3) {
-                        node_links.node3[node_links.node3num] = mainlinks[j].rctgsmp;
-                        node_links.node3utr[node_links.node3num] = mainlinks[j].rutrsmp;
-                        node_links.node3num++;
-                        if (node_links.node3num >= 10) {
-                            *flag_err = 1;
-                            return;
-                        }
-                    } else if (mainlinks[j].rctgsmp == mt_contigs[i] && mainlinks[j].rutrsmp == 3) {
-                        node_links.node3[node_links.node3num] = mainlinks[j].lctgsmp;
-                        node_links.node3utr[node_links.node3num] = mainlinks[j].lutrsmp;
-                        node_links.node3num++;
-                        if (node_links.node3num >= 10) {
-                            *flag_err = 1;
-                            return;
-                        }
-                    } else if (mainlinks[j].lctgsmp == mt_contigs[i] && mainlinks[j].lutrsmp == 5) {
-                        node_links.node5[node_links.node5num] = mainlinks[j].rctgsmp;
-                        node_links.node5utr[node_links.node5num] = mainlinks[j].rutrsmp; 
-                        node_links.node5num++;
-                        if (node_links.node5num >= 10) {
-                            *flag_err = 1;
-                            return;
-                        }
-                    } else {
-                        node_links.node5[node_links.node5num] = mainlinks[j].lctgsmp;
-                        node_links.node5utr[node_links.node5num] = mainlinks[j].lutrsmp;
-                        node_links.node5num++;
-                        if (node_links.node5num >= 10) {
-                            *flag_err = 1;
-                            return;
-                        }
-                    }
-                }
-            }
-            
-            int* mttempnode5 = (int*)malloc(node_links.node5num * sizeof(int));
-            int* mttempnode5utr = (int*)malloc(node_links.node5num * sizeof(int));
-            int mtnode5num = 0;
-            int* pttempnode5 = (int*)malloc(node_links.node5num * sizeof(int));
-            int* pttempnode5utr = (int*)malloc(node_links.node5num * sizeof(int));
-            int ptnode5num = 0;
-
-            int* mttempnode3 = (int*)malloc(node_links.node3num * sizeof(int));
-            int* mttempnode3utr = (int*)malloc(node_links.node3num * sizeof(int));
-            int mtnode3num = 0;
-            int* pttempnode3 = (int*)malloc(node_links.node3num * sizeof(int));
-            int* pttempnode3utr = (int*)malloc(node_links.node3num * sizeof(int));
-            int ptnode3num = 0;
-
-            for (j = 0; j < node_links.node3num; j++) {
-                if (findint(pt_contigs, pt_num, node_links.node3[j]) == 0) {
-                    mttempnode3[mtnode3num] = node_links.node3[j];
-                    mttempnode3utr[mtnode3num] = node_links.node3utr[j];
-                    mtnode3num++;
-                } else {
-                    pttempnode3[ptnode3num] = node_links.node3[j];
-                    pttempnode3utr[ptnode3num] = node_links.node3utr[j];
-                    ptnode3num++;
-                }
-            }
-
 
-            for (j = 0; j < node_links.node5num; j++) {
-                if (findint(pt_contigs, pt_num, node_links.node5[j]) == 0) {
-                    mttempnode5[mtnode5num] = node_links.node5[j];
-                    mttempnode5utr[mtnode5num] = node_links.node5utr[j];
-                    mtnode5num++;
-                } else {
-                    pttempnode5[ptnode5num] = node_links.node5[j];
-                    pttempnode5utr[ptnode5num] = node_links.node5utr[j];
-                    ptnode5num++;
-                }
-            }
-            if (mtnode3num > 0) {
-                NodeUtrPair* mttempnode3pairs = (NodeUtrPair*)malloc(mtnode3num * sizeof(NodeUtrPair));
-                for (j = 0; j < mtnode3num; j++) {
-                    mttempnode3pairs[j].node = mttempnode3[j];
-                    mttempnode3pairs[j].utr = mttempnode3utr[j];
-                }
-
-                qsort(mttempnode3pairs, mtnode3num, sizeof(NodeUtrPair), compare_by_hash_value);
-
-                for (j = 0; j < mtnode3num; j++) {
-                    mttempnode3[j] = mttempnode3pairs[j].node;
-                    mttempnode3utr[j] = mttempnode3pairs[j].utr;
-                }
-                free(mttempnode3pairs);
-            }
-            if (mtnode5num > 0) {
-                NodeUtrPair* mttempnode5pairs = (NodeUtrPair*)malloc(mtnode5num * sizeof(NodeUtrPair));
-                for (j = 0; j < mtnode5num; j++) {
-                    mttempnode5pairs[j].node = mttempnode5[j];
-                    mttempnode5pairs[j].utr = mttempnode5utr[j];
-                }
-
-                qsort(mttempnode5pairs, mtnode5num, sizeof(NodeUtrPair), compare_by_hash_value);
-
-                for (j = 0; j < mtnode5num; j++) {
-                    mttempnode5[j] = mttempnode5pairs[j].node;
-                    mttempnode5utr[j] = mttempnode5pairs[j].utr;
-                }
-                free(mttempnode5pairs);
-            }
+    /* Adjacency of the structure: every end lists its mt neighbours by depth, then its pt neighbours */
+    CtgGraph* graph;
+    if (mt_num == 1 && main_graph->num_links == 1) {
+        BFSlinks self_link = {0};
+        self_link.lctgsmp = mt_contigs[0];
+        self_link.lutrsmp = 5;
+        self_link.rctgsmp = mt_contigs[0];
+        self_link.rutrsmp = 3;
+        graph = ctggraph_build(&self_link, 1, mt_contigs, 1);
+    } else {
+        graph = ctggraph_dup(main_graph);
+        sort_ends(graph, mt_contigs, mt_num, pt_contigs, pt_num, ctg_depth);
+    }
 
-            for (j = 0; j < node_links.node3num; j++) {
-                if (j < mtnode3num) {
-                    node_links.node3[j] = mttempnode3[j];
-                    node_links.node3utr[j] = mttempnode3utr[j];
-                } else {
-                    node_links.node3[j] = pttempnode3[j - mtnode3num];
-                    node_links.node3utr[j] = pttempnode3utr[j - mtnode3num];
-                }
-            }
-            for (j = 0; j < node_links.node5num; j++) {
-                if (j < mtnode5num) {
-                    node_links.node5[j] = mttempnode5[j];
-                    node_links.node5utr[j] = mttempnode5utr[j];
-                } else {
-                    node_links.node5[j] = pttempnode5[j - mtnode5num];
-                    node_links.node5utr[j] = pttempnode5utr[j - mtnode5num];
-                }
-            }
-            kh_value(h_links, k) = node_links;
+    /* visit budgets by graph node; contigs that are neither mt nor pt are not limited */
+    uint8_t* kind = (uint8_t*)calloc(graph->num_nodes, sizeof(uint8_t));
+    uint16_t* budget = (uint16_t*)malloc(graph->num_nodes * sizeof(uint16_t));
+    for (i = 0; i < graph->num_nodes; i++) {
+        budget[i] = UINT16_MAX;
+        if (findint(pt_contigs, pt_num, graph->ctg[i])) {
+            kind[i] = PATH_PT;
+            budget[i] = 1;
+        } else if (findint(mt_contigs, mt_num, graph->ctg[i])) {
+            kind[i] = PATH_MT;
+            k = kh_get(node_num, h_mito, graph->ctg[i]);
+            budget[i] = kh_value(h_mito, k) < UINT16_MAX ? kh_value(h_mito, k) : UINT16_MAX;
         }
     }
 
-    pathScore path_score;
-    path_score.mt_nodenum = 0;
-    path_score.node_num = 0;
-    path_score.uniq_mt_nodenum = 0;
-    path_score.path_len = 0;
-    path_score.uniq_mt_pathlen = 0;
-    path_score.pt_nodenum = 10 * pt_num;
-    path_score.uniq_pt_nodenum = pt_num;
-    path_score.path_node = (int*)malloc((max_node) * sizeof(int));
-    path_score.path_utr = (int*)malloc((max_node) * sizeof(int));
-    path_score.type = 1;
-    path_score.inval_num = 0;
-
-    // nodePath current_path;
-    // current_path.nodenum = 1;
-    // current_path.node = (int*)malloc((max_node) * sizeof(int));
-    // current_path.node[0] = node1;
-    // current_path.utr = (int*)malloc((max_node) * sizeof(int));
-    // current_path.utr[0] = node1utr;
-    // current_path.nodelen = ctg_depth[node1 - 1].len;
-    // current_path.pathlen = 0;
-    // current_path.type = 1;
-
-    int cpu = 8;
-    mpath* bfs_path = (mpath*)malloc(2*cpu * sizeof(mpath));
-    int path_t = 0;
-    bfsMap(node1, node1utr, node2, node2utr, ctg_depth, bfs_path, h_links, cpu, h_mito, h_chloro, &path_t);
-    
-    // printf("Path threads: %d\n", path_t);
-    // for (int i = 0; i < path_t; i++) 
-    // {
-    //     printf("Path threads %d: ", i);
-    //     for (int j = 0; j < bfs_path[i].nodenum; j++)
-    //     {
-    //         printf("%d %d ", bfs_path[i].path[j], bfs_path[i].utr[j]);
-    //     }
-    //     printf("\n");
+    /* 
+     * depths rounded one by one often disagree with the links: the budgets of the mt contigs become the copies 
+     * of the circulation through the structure closest to their depths, by contig length, and link depths
+     */
+    double* target = (double*)calloc(graph->num_nodes, sizeof(double));
+    double* weight = (double*)calloc(graph->num_nodes, sizeof(double));
+    float denom = (mt_depth + min_depth) / 2;
+    for (i = 0; i < graph->num_nodes; i++) {
+        if (kind[i] != PATH_MT) continue;
+        target[i] = ctg_depth[graph->ctg[i] - 1].depth / denom;
+        weight[i] = ctg_depth[graph->ctg[i] - 1].len;
+    }
+    int* flow_copies = (int*)malloc(graph->num_nodes * sizeof(int));
+    int* flow_mult = (int*)malloc((graph->num_links ? graph->num_links : 1) * sizeof(int));
+    /* a structure no circulation covers, such as a linear one, keeps the rounded depths */
+    int flow_fit = ctggraph_copy_flow(graph, target, weight, denom, 1000.0, limits ? limits->deadline : 0, flow_copies, flow_mult);
+    for (i = 0; i < graph->num_nodes; i++) {
+        if (kind[i] == PATH_MT && flow_copies[i] == 0) flow_fit = 0;
+    }
+    for (i = 0; i < graph->num_nodes && flow_fit; i++) {
+        if (kind[i] != PATH_MT) continue;
+        k = kh_get(node_num, h_mito, graph->ctg[i]);
+        maxnum_mito += flow_copies[i] - kh_value(h_mito, k);
+        kh_value(h_mito, k) = flow_copies[i];
+        budget[i] = flow_copies[i] < UINT16_MAX ? flow_copies[i] : UINT16_MAX;
+    }
+    /* a block's circle is spliced into the structure's, so no contig may be passed more often than there */
+    for (i = 0; i < graph->num_nodes && parent != NULL; i++) {
+        int u = ctggraph_node(parent->graph, graph->ctg[i]);
+        if (kind[i] != 0 && u >= 0 && parent->budget[u] < budget[i]) budget[i] = parent->budget[u];
+    }
+    max_node = pt_num*5 + maxnum_mito + 1;
+    free(target);
+    free(weight);
+    free(flow_copies);
+    free(flow_mult);
+
+    /* chains of mt contigs, other than the ends of the path, are walked as one step */
+    uint8_t* mergeable = (uint8_t*)calloc(graph->num_nodes, sizeof(uint8_t));
+    for (i = 0; i < graph->num_nodes; i++) {
+        mergeable[i] = kind[i] == PATH_MT && graph->ctg[i] != node1 && graph->ctg[i] != node2;
+    }
+    CtgChains chains;
+    CtgGraph* chain_graph = ctggraph_compact(graph, mergeable, &chains);
+    free(mergeable);
+    int* copies = (int*)calloc(chains.num, sizeof(int));
+    for (i = 0; i < chains.num; i++) {
+        if (chains.off[i + 1] - chains.off[i] < 2) continue;
+        copies[i] = INT_MAX;
+        for (j = chains.off[i]; j < chains.off[i + 1]; j++) {
+            if (budget[chains.member[j]] < copies[i]) copies[i] = budget[chains.member[j]];
+        }
+    }
 
-    //     // for (k = kh_begin(bfs_path[i].h_mito); k != kh_end(bfs_path[i].h_mito); k++) 
-    //     // {
-    //     //     if (kh_exist(bfs_path[i].h_mito, k)) {
-    //     //         log_info("%d: %d; ", kh_key(bfs_path[i].h_mito, k), kh_value(bfs_path[i].h_mito, k));
-    //     //     }
-    //     // }
-    //     // log_info("\n");
+    /* the search starts as one task; idle threads are handed unexplored branches as it runs */
+    int num_workers = num_threads > 0 ? num_threads : 1;
+
+    run->job = job;
+    run->graph = graph;
+    run->chain_graph = chain_graph;
+    run->chains = chains;
+    taskPool* pool = &run->pool;
+    pool->num_threads = num_workers;
+    pool->deque = (taskDeque*)calloc(num_workers, sizeof(taskDeque));
+    pool->share = share;
+    pool->index = index;
+    pool->num_pending = 0;
+    pool->stop = 0;
+    pool->num_tasks = 0;
+    pool->tt.entry = (ttEntry*)calloc((size_t)TT_WAYS << TT_BITS, sizeof(ttEntry));
+    for (i = 0; i < TT_LOCKS; i++) pthread_mutex_init(&pool->tt.lock[i], NULL);
+    pool->graph = graph;
+    pool->chain_graph = chain_graph;
+    pool->chains = &run->chains;
+    pool->copies = copies;
+    pool->kind = kind;
+    pool->ctg_depth = ctg_depth;
+    pool->s_utr = node1utr;
+    pool->node_t = node2;
+    pool->t_utr = node2utr;
+    pool->best_mtlen = 0;
+    pthread_mutex_init(&pool->best_lock, NULL);
+    init_score(&pool->best, pt_num, max_node);
+    pool->best_version = 0;
+    pool->inval_num = 0;
+    pool->mt_contigs = mt_contigs;
+    pool->mt_num = mt_num;
+    pool->pt_contigs = pt_contigs;
+    pool->pt_num = pt_num;
+    pool->budget = budget;
+    pool->limits = limits;
+    pool->max_node = max_node;
+    pool->mt_uniq_len = mt_uniq_len;
+    pool->taxo = taxo;
+    pool->num_expanded = 0;
+    pool->limit_hit = NULL;
+    pool->last_flush = realtime();
+    pool->flushed_version = 0;
+    pool->log = NULL;
+
+    pathWorker* workers = (pathWorker*)malloc(num_workers * sizeof(pathWorker));
+    for (i = 0; i < num_workers; i++) {
+        pthread_mutex_init(&pool->deque[i].lock, NULL);
+        workers[i].pool = pool;
+        workers[i].id = i;
+        workers[i].path.node = (int*)malloc((max_node) * sizeof(int));
+        workers[i].path.utr = (int*)malloc((max_node) * sizeof(int));
+        init_score(&workers[i].best, pt_num, max_node);
+        workers[i].seen_version = 0;
+        workers[i].budget = (uint16_t*)malloc(graph->num_nodes * sizeof(uint16_t));
+        workers[i].spine = (pathLink**)malloc((max_node) * sizeof(pathLink*));
+        workers[i].spine_num = 0;
+        workers[i].left = (int*)malloc(chains.num * sizeof(int));
+        workers[i].stamp = 0;
+        workers[i].visits = (uint32_t*)calloc(graph->num_nodes, sizeof(uint32_t));
+        workers[i].reached = (uint32_t*)calloc(graph->num_nodes, sizeof(uint32_t));
+        workers[i].queue = (int*)malloc(graph->num_nodes * sizeof(int));
+        workers[i].frame = (searchFrame*)malloc((max_node + 1) * sizeof(searchFrame));
+        workers[i].expanded = 0;
+    }
+    run->workers = workers;
+    kh_destroy(node_num, h_mito);
+    kh_destroy(node_num, h_chloro);
 
-    // }
+    /* a task without a path starts the search on the thread that takes it */
+    pathTask start;
+    start.tail = NULL;
+    start.type = 1;
+    push_task(pool, index % num_workers, start);
+    return 1;
+}
 
-    pthread_t threads[path_t];
-    bfs_m_args thread_args[path_t];
+/* 
+ * the first task of the search of run, on thread id: a circuit or the circles of the blocks may solve the 
+ * structure at once. Otherwise the bidirectional and greedy searches set a first best path, and the roots are 
+ * searched by a beam for a large structure, else handed to the threads of the run
+ */
+static void path_start(pathRun* run, int id)
+{
+    taskPool* pool = &run->pool;
+    pathJob* job = run->job;
+    pathWorker* w = &run->workers[id];
+    int node1 = job->ctg_s, node1utr = job->utr_s, node2 = job->ctg_s, node2utr = job->utr_e;
+    int i;
+
+    pathTask root;
+    root.tail = (pathLink*)malloc(sizeof(pathLink));
+    root.tail->parent = NULL;
+    root.tail->node = node1;
+    root.tail->utr = node1utr;
+    root.tail->depth = 1;
+    root.tail->ref = 1;
+    root.type = 1;
+    pathTask roots[2];
+    int num_roots = 0;
+    pathScore split;
+    split.node_num = 0;
+    if (euler_walk(w, &root)) {
+        /* solved: nothing is left to search */
+        link_release(root.tail);
+    } else if (split_search(pool, &split)) {
+        /* the spliced circle is the path of the structure */
+        link_release(root.tail);
+        free(pool->best.path_node);
+        free(pool->best.path_utr);
+        pool->best = split;
+    } else {
+        half_search(w, &root);
+        greedy_walk(w, &root);
+        roots[num_roots++] = root;
+    }
+    /* 
+     * a circular search also leaves the start the other way, for the linear paths on that side; 
+     * it was a second pass of the caller
+     */
+    if (num_roots > 0 && node1 == node2 && node1utr != node2utr && 
+        ctggraph_degree(run->graph, CG_END(ctggraph_node(run->graph, node1), node1utr)) > 0) {
+        pathTask back;
+        back.tail = (pathLink*)malloc(sizeof(pathLink));
+        back.tail->parent = NULL;
+        back.tail->node = node1;
+        back.tail->utr = node1utr == 3 ? 5 : 3;
+        back.tail->depth = 1;
+        back.tail->ref = 1;
+        back.type = 1;
+        roots[num_roots++] = back;
+    }
 
-    nodePath current_path[path_t];
-    
-    if (pthread_mutex_init(&mutex, NULL) != 0) {
-        log_message(ERROR, "Error: mutex init failed\n");
-        *flag_err = 1;
-        return;
+    if (run->graph->num_nodes > PATH_BEAM_NODES && num_roots > 0) {
+        beam_search(run->workers, pool->num_threads, roots, num_roots, pool->limits != NULL ? pool->limits->beam_width : PATH_BEAM_WIDTH);
+    } else {
+        for (i = 0; i < num_roots; i++) push_task(pool, id, roots[i]);
     }
+}
 
-    for (i = 0; i < path_t; i++) {
-        int node_s = bfs_path[i].path[bfs_path[i].nodenum - 1];
-        int utr_s = bfs_path[i].utr[bfs_path[i].nodenum - 1];
-        current_path[i].nodenum = bfs_path[i].nodenum;
-        current_path[i].node = (int*)malloc((max_node) * sizeof(int));
-        current_path[i].utr = (int*)malloc((max_node) * sizeof(int));
-        for (j = 0; j < bfs_path[i].nodenum; j++) {
-            current_path[i].node[j] = bfs_path[i].path[j];
-            current_path[i].utr[j] = bfs_path[i].utr[j];
-        }
-        current_path[i].nodelen = bfs_path[i].pathlen;
-        current_path[i].type = bfs_path[i].type;
-
-        thread_args[i].node1 = node_s;
-        thread_args[i].utr1 = utr_s;
-        thread_args[i].node2 = node2;
-        thread_args[i].utr2 = node2utr;
-        thread_args[i].main_num = main_num;
-        thread_args[i].mainlinks = mainlinks;
-        thread_args[i].ctg_depth = ctg_depth;
-        thread_args[i].current_path = &(current_path[i]);
-        thread_args[i].path_score = &path_score;
-        thread_args[i].mt_contigs = mt_contigs;
-        thread_args[i].mt_num = mt_num;
-        thread_args[i].h_mito = bfs_path[i].h_mito;
-        thread_args[i].pt_contigs = pt_contigs;
-        thread_args[i].pt_num = pt_num;
-        thread_args[i].h_chloro = bfs_path[i].h_chloro;
-        thread_args[i].h_links = h_links;
-        thread_args[i].stop_flag = 0;
-
-        pthread_create(&threads[i], NULL, thread_bfs_m, (void*)&thread_args[i]);
-
-    }
-    for (i = 0; i < path_t; i++) {
-        pthread_join(threads[i], NULL);
+/* set the path, ratio and error of the job of run from its search, and free the search */
+static void path_finish(pathRun* run)
+{
+    taskPool* pool = &run->pool;
+    pathJob* job = run->job;
+    pathWorker* workers = run->workers;
+    int node1 = job->ctg_s;
+    uint64_t i;
+
+    if (pool->limit_hit != NULL) {
+        log_message(WARNING, "M-path search stopped at the %s limit after %" PRIu64 " states, keeping the best path found", 
+                    pool->limit_hit, pool->num_expanded);
+    }
+    pathScore path_score = pool->best;
+    pthread_mutex_destroy(&pool->best_lock);
+    for (i = 0; i < pool->num_threads; i++) {
+        free(workers[i].best.path_node);
+        free(workers[i].best.path_utr);
+        free(workers[i].path.node);
+        free(workers[i].path.utr);
+        spine_cut(&workers[i], 0);
+        free(workers[i].spine);
+        free(workers[i].budget);
+        free(workers[i].visits);
+        free(workers[i].reached);
+        free(workers[i].queue);
+        free(workers[i].frame);
+        free(workers[i].left);
+        free(pool->deque[i].task);
+        pthread_mutex_destroy(&pool->deque[i].lock);
     }
-    free(bfs_path);
+    free(workers);
+    free(pool->deque);
+    for (i = 0; i < TT_LOCKS; i++) pthread_mutex_destroy(&pool->tt.lock[i]);
+    free(pool->tt.entry);
+    ctggraph_free(run->chain_graph);
+    ctggraph_free_chains(&run->chains);
+    free(pool->copies);
+    free(pool->kind);
+    free(pool->budget);
+    ctggraph_free(run->graph);
 
-    pthread_mutex_destroy(&mutex);
     // bfs_m(node1, node1utr, node2, node2utr, main_num, mainlinks, ctg_depth, &current_path, &path_score, mt_contigs, mt_num, h_mito, pt_contigs, pt_num, h_chloro, h_links);
     
     if (path_score.node_num == 0) {
-        *flag_err = 1;
-        // free(current_path.node);
-        // free(current_path.utr);
+        job->flag_err = 1;
         free(path_score.path_node);
         free(path_score.path_utr);
-        kh_destroy(node_num, h_mito);
-        kh_destroy(node_num, h_chloro);
-        for (i = 0; i < path_t; i++)
-        {
-            free(current_path[i].node);
-            free(current_path[i].utr);
-        }
         return;
     }
 
-    for (i = 0; i < path_t; i++)
-    {
-        free(current_path[i].node);
-        free(current_path[i].utr);
-    }
-
     /* print the paths */
-    float ratio = (float)path_score.uniq_mt_pathlen / mt_uniq_len;
-    *mt_ratio = ratio;
+    float ratio = (float)path_score.uniq_mt_pathlen / pool->mt_uniq_len;
+    job->mt_ratio = ratio;
     if (ratio >= 0.1) {
-        // log_info("————————————————————————————\n");
-        // log_info(" M-path  Length (bp)  Score\n");
-        // log_info("----------------------------\n");
-        // log_info(" %-7s %-12ld %-5.2f\n", path_score.type == 0 ? "C" : "L", path_score.path_len, ratio * 100);
-        // // printf("Graph path %s %.2f%% %ld bp:\n", path_score.type == 0 ? "C" : "L", ratio * 100, path_score.path_len);
-        // log_info("\n");
-        // log_info("** %d %d -> ", path_score.path_node[0], node1utr == 3 ? 5 : 3);
-        // for (int i = 1; i < (path_score.node_num - 1); i++) {
-        //     log_info("%d %d -> ", path_score.path_node[i], path_score.path_utr[i]);
-        // }
-        // log_info("%d %d\n", path_score.path_node[path_score.node_num - 1], path_score.path_utr[path_score.node_num - 1]);
-        // log_info("————————————————————————————\n");
-
+        pathScore* struc_path = &job->path;
         struc_path->type = path_score.type;
         struc_path->path_len = path_score.path_len;
         struc_path->node_num = path_score.node_num;
@@ -1127,30 +2415,86 @@ void findMpath(int node1, int node1utr, int node2, int node2utr, int main_num, B
         for (i = 0; i < path_score.node_num; i++) {
             if (i == 0) {
                 struc_path->path_node[i] = node1;
-                struc_path->path_utr[i] = node1utr;
+                struc_path->path_utr[i] = path_score.path_utr[0];
             } else {
                 struc_path->path_node[i] = path_score.path_node[i];
                 struc_path->path_utr[i] = path_score.path_utr[i];
             }
         }
-
-        // for (int i = 0; i < mt_num; i++) {
-        //     if (findint(path_score.path_node, path_score.node_num, mt_contigs[i]) == 0 && 
-        //         findint(pt_contigs, pt_num, mt_contigs[i]) == 0) {
-        //         printf("%d ", mt_contigs[i]);
-        //     }
-        // }
-        // printf("\n");
     }
 
     /* Free memory */
-    // free(current_path.node);
-    // free(current_path.utr);
     free(path_score.path_node);
     free(path_score.path_utr);
-    kh_destroy(node_num, h_mito);
-    kh_destroy(node_num, h_chloro);
-    kh_destroy(Ha_nodelink, h_links);
-    kh_destroy(Ha_nodedepth, h_depth);
 }
 
+/* 
+ * search the structures of jobs on one pool of num_threads threads, which take the tasks of the first 
+ * structures first. The messages of each search are held back in its job when there are others to report, 
+ * and kept with those of the parent in a block search
+ */
+static void path_run(pathJob* jobs, int num_jobs, CtgDepth* ctg_depth, int* pt_contigs, int pt_num, int taxo, int num_threads, 
+    const pathLimits* limits, const taskPool* parent)
+{
+    int i, num_workers = num_threads > 0 ? num_threads : 1;
+    taskShare share;
+    pthread_mutex_init(&share.lock, NULL);
+    pthread_cond_init(&share.cond, NULL);
+    share.num_idle = 0;
+    share.num_queued = 0;
+    share.num_pending = 0;
+    share.runs = (pathRun*)calloc(num_jobs > 0 ? num_jobs : 1, sizeof(pathRun));
+    share.num_runs = num_jobs;
+    share.done = (pathScore*)calloc(num_jobs > 0 ? num_jobs : 1, sizeof(pathScore));
+
+    logBuffer* parent_log = parent != NULL ? parent->log : NULL;
+    for (i = 0; i < num_jobs; i++) {
+        pathRun* run = &share.runs[i];
+        run->job = &jobs[i];
+        if (!jobs[i].search) {
+            share.done[i] = jobs[i].path;
+            continue;
+        }
+        jobs[i].flag_err = 0;
+        jobs[i].mt_ratio = 0.0;
+        jobs[i].path.node_num = 0;
+        jobs[i].path.path_node = NULL;
+        jobs[i].path.path_utr = NULL;
+        logBuffer* log = parent != NULL ? parent_log : num_jobs > 1 ? &jobs[i].log : NULL;
+        log_capture(log);
+        if (path_init(run, &jobs[i], &share, i, ctg_depth, pt_contigs, pt_num, taxo, num_workers, limits, parent)) run->pool.log = log;
+    }
+    log_capture(parent_log);
+    share.front = 0;
+    while (share.front < num_jobs && share.runs[share.front].pool.num_pending == 0) share.front++;
+
+    pthread_t* threads = (pthread_t*)malloc(num_workers * sizeof(pthread_t));
+    pathThread* thread_args = (pathThread*)malloc(num_workers * sizeof(pathThread));
+    for (i = 0; i < num_workers; i++) {
+        thread_args[i].share = &share;
+        thread_args[i].id = i;
+        pthread_create(&threads[i], NULL, path_thread, (void*)&thread_args[i]);
+    }
+    for (i = 0; i < num_workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (i = 0; i < num_jobs; i++) {
+        if (share.runs[i].workers == NULL) continue;
+        log_capture(share.runs[i].pool.log);
+        path_finish(&share.runs[i]);
+    }
+    log_capture(parent_log);
+    free(threads);
+    free(thread_args);
+    free(share.runs);
+    free(share.done);
+    pthread_cond_destroy(&share.cond);
+    pthread_mutex_destroy(&share.lock);
+}
+
+void findMpaths(pathJob* jobs, int num_jobs, CtgDepth* ctg_depth, int* pt_contigs, int pt_num, int taxo, int num_threads, 
+    const pathLimits* limits)
+{
+    path_run(jobs, num_jobs, ctg_depth, pt_contigs, pt_num, taxo, num_threads, limits, NULL);
+}
@@ -38,45 +38,27 @@ SOFTWARE.
 #include "BFSseed.h"
 #include "hitseeds.h"
 #include "orgAss.h"
+#include "ctgstore.h"
+#include "ntsearch.h"
+#include "ctggraph.h"
+#include "kthread.h"
 
-typedef struct {
-    int* node;
-    int num;
-} nodeNum;
-
-typedef struct {
-    char seq[1001];
-    int type;
-} nodeKmer;
 
-KHASH_MAP_INIT_INT(Ha_nodelink, nodeNum)
-KHASH_MAP_INIT_INT(Ha_nodekmer, int)
-KHASH_MAP_INIT_INT(Ha_direct, int)
 
 
-
-void addseq(const char* allgraph, const char* all_fna, CtgDepth* ctgdepth) {
+void addseq(const char* allgraph, const char* all_fna, CtgDepth* ctgdepth, int num_ctg) {
     
     char* line = NULL;
     size_t len = 0;
 
     FILE* temp_fpall = fopen(all_fna, "r");
-    int fnactg_num = 0;
-    while (getline(&line, &len, temp_fpall) != -1) {
-        if (line[0] == '>') {
-            fnactg_num++;
-        }
-    }
-    rewind(temp_fpall);
-    int* fnactg = malloc(fnactg_num * sizeof(int));
-    int fnactg_idx = 0;
+    uint8_t* fnactg = calloc(num_ctg + 1, sizeof(uint8_t));
     while (getline(&line, &len, temp_fpall) != -1) {
         if (line[0] == '>') {
             char *token = strtok(line, " ");
             char *tempctg = token + 1;
             int intctg = rm_contig(tempctg);
-            fnactg[fnactg_idx] = intctg;
-            fnactg_idx++;
+            if (intctg > 0 && intctg <= num_ctg) fnactg[intctg] = 1;
         }
     }
     fclose(temp_fpall);
@@ -92,7 +74,8 @@ void addseq(const char* allgraph, const char* all_fna, CtgDepth* ctgdepth) {
             int tempctg = atoi(token);
             token = strtok(NULL, "\t");
             char *tempseq = strdup(token);
-            if (findint(fnactg, fnactg_num, tempctg) == 0) {
+            if (tempctg > 0 && tempctg <= num_ctg && fnactg[tempctg] == 0) {
+                fnactg[tempctg] = 1;
                 fprintf(fpout, ">%s length=%d numreads=%g\n", ctgdepth[tempctg - 1].ctg, ctgdepth[tempctg - 1].len, ctgdepth[tempctg - 1].depth);
                 char* seq = strdup(tempseq);
                 to_upper(seq);
@@ -118,356 +101,191 @@ void addseq(const char* allgraph, const char* all_fna, CtgDepth* ctgdepth) {
 }
 
 
+/* a node stays in the main graph while it is linked on both ends or to itself */
+#define main_supported(deg, self, v) (((deg)[CG_END(v, 3)] > 0 && (deg)[CG_END(v, 5)] > 0) || (self)[v])
+
 static void maingraph(BFSlinks* bfslinks, BFSlinks* mainlinks, CtgDepth* ctg_depth, int num_dynseeds, int num_bfslinks, int* mainseeds, 
                      int* main_num, int* mainseeds_num, int* rm_ctg, int rm_num, float filter_depth) {
 
     uint64_t i;
-    BFSlinks* templinks = malloc(num_bfslinks * sizeof(BFSlinks));
-    for (i = 0; i < num_bfslinks; i++) {
-        copy_BFSlinks(&templinks[i], &bfslinks[i]);
+    uint32_t p;
+    *main_num = 0;
+    *mainseeds_num = 0;
+    if (num_bfslinks == 0) return;
+
+    CtgGraph* graph = ctggraph_build(bfslinks, num_bfslinks, NULL, 0);
+    int num_nodes = graph->num_nodes;
+    uint32_t* deg = malloc(2 * num_nodes * sizeof(uint32_t));
+    uint8_t* self = calloc(num_nodes, sizeof(uint8_t));
+    uint8_t* removed = calloc(num_nodes, sizeof(uint8_t));
+    uint8_t* link_alive = malloc(num_bfslinks * sizeof(uint8_t));
+    int* queue = malloc(num_nodes * sizeof(int));
+    int queue_beg = 0, queue_end = 0;
+    memset(link_alive, 1, num_bfslinks * sizeof(uint8_t));
+
+    for (i = 0; i < num_nodes; i++) {
+        deg[CG_END(i, 3)] = ctggraph_degree(graph, CG_END(i, 3));
+        deg[CG_END(i, 5)] = ctggraph_degree(graph, CG_END(i, 5));
+        self[i] = ctggraph_has(graph, CG_END(i, 3), i) || ctggraph_has(graph, CG_END(i, 5), i);
     }
-    *main_num = num_bfslinks;
-    int flag_num = 0;
-
-    while(1) {
-        *mainseeds_num = 0;
-        khash_t(Ha_direct) *map_direct = kh_init(Ha_direct);
-        for (i = 0; i < *main_num; i++) {
-            khint_t k;
-            int ret;
-            int temp_lctgsmp = templinks[i].lctgsmp;
-            int temp_rctgsmp = templinks[i].rctgsmp;
-            if (temp_lctgsmp != temp_rctgsmp) {
-                k = kh_get(Ha_direct, map_direct, temp_lctgsmp);
-                int lutr_value = templinks[i].lutrsmp;
-                if (k != kh_end(map_direct) && kh_val(map_direct, k) != lutr_value) {
-                    mainseeds[*mainseeds_num] = temp_lctgsmp;
-                    (*mainseeds_num)++;
-                    kh_val(map_direct, k) = 0;
-                } else if (k == kh_end(map_direct)) {
-                    mainseeds[*mainseeds_num] = temp_lctgsmp;
-                    (*mainseeds_num)++;
-                    k = kh_put(Ha_direct, map_direct, temp_lctgsmp, &ret);
-                    kh_val(map_direct, k) = templinks[i].lutrsmp;              
-                }
-
-                k = kh_get(Ha_direct, map_direct, temp_rctgsmp);
-                int rutr_value = templinks[i].rutrsmp;
-                if (k != kh_end(map_direct) && kh_val(map_direct, k) != rutr_value) {
-                    mainseeds[*mainseeds_num] = temp_rctgsmp;
-                    (*mainseeds_num)++;
-                    kh_val(map_direct, k) = 0;
-                } else if (k == kh_end(map_direct)) {
-                    mainseeds[*mainseeds_num] = temp_rctgsmp;
-                    (*mainseeds_num)++;
-                    k = kh_put(Ha_direct, map_direct, temp_rctgsmp, &ret);
-                    kh_val(map_direct, k) = templinks[i].rutrsmp;                    
-                }
-
-            } else {
-                mainseeds[*mainseeds_num] = temp_lctgsmp;
-                (*mainseeds_num)++;
-                mainseeds[*mainseeds_num] = temp_rctgsmp;
-                (*mainseeds_num)++;
-                k = kh_get(Ha_direct, map_direct, temp_lctgsmp);
-                if (k == kh_end(map_direct)) {
-                    k = kh_put(Ha_direct, map_direct, temp_lctgsmp, &ret);
-                    kh_val(map_direct, k) = 0;
-                }
-                // k = kh_get(Ha_direct, map_direct, temp_rctgsmp);
-                // if (k == kh_end(map_direct)) {
-                //     mainseeds[*mainseeds_num] = temp_rctgsmp;
-                //     (*mainseeds_num)++;
-                //     k = kh_put(Ha_direct, map_direct, temp_lctgsmp, &ret);
-                //     kh_val(map_direct, k) = 0;
-                // }
-            }       
-
+    for (i = 0; i < rm_num; i++) {
+        int node = ctggraph_node(graph, rm_ctg[i]);
+        if (node >= 0 && !removed[node]) {
+            removed[node] = 1;
+            queue[queue_end++] = node;
         }
-
-        kh_destroy(Ha_direct, map_direct);
-
-        if (*mainseeds_num == 0) {
-            break;
+    }
+    for (i = 0; i < num_nodes; i++) {
+        if (!removed[i] && (ctg_depth[graph->ctg[i] - 1].depth < filter_depth || !main_supported(deg, self, i))) {
+            removed[i] = 1;
+            queue[queue_end++] = i;
         }
+    }
 
-        removeUnique(mainseeds, mainseeds_num);
-
-        flag_num = 0;
-        for (i = 0; i < *main_num; i++) {
-            if (findint(mainseeds, *mainseeds_num, templinks[i].lctgsmp) == 1 &&
-                findint(mainseeds, *mainseeds_num, templinks[i].rctgsmp) == 1 &&
-                findint(rm_ctg, rm_num, templinks[i].lctgsmp) == 0 &&
-                findint(rm_ctg, rm_num, templinks[i].rctgsmp) == 0 &&
-                ctg_depth[templinks[i].lctgsmp - 1].depth >= filter_depth &&
-                ctg_depth[templinks[i].rctgsmp - 1].depth >= filter_depth) {
-
-                // mainlinks[flag_num] = templinks[i];
-                copy_BFSlinks(&mainlinks[flag_num], &templinks[i]);
-                flag_num++;
+    /* peel: drop the links of removed nodes and queue the neighbours that lose support */
+    while (queue_beg < queue_end) {
+        int node = queue[queue_beg++];
+        for (p = graph->off[CG_END(node, 3)]; p < graph->off[CG_END(node, 5) + 1]; p++) {
+            if (!link_alive[graph->link[p]]) continue;
+            link_alive[graph->link[p]] = 0;
+            int next = CG_NODE(graph->nbr[p]);
+            if (next == node) continue;
+            deg[graph->nbr[p]]--;
+            if (!removed[next] && !main_supported(deg, self, next)) {
+                removed[next] = 1;
+                queue[queue_end++] = next;
             }
         }
+    }
 
-        if (flag_num == *main_num) {
-            break;
+    /* surviving links in input order, their contigs in order of first appearance */
+    uint8_t* seen = calloc(num_nodes, sizeof(uint8_t));
+    for (i = 0; i < num_bfslinks; i++) {
+        if (!link_alive[i]) continue;
+        copy_BFSlinks(&mainlinks[*main_num], &bfslinks[i]);
+        (*main_num)++;
+        int lnode = graph->node[bfslinks[i].lctgsmp];
+        int rnode = graph->node[bfslinks[i].rctgsmp];
+        if (!seen[lnode]) {
+            seen[lnode] = 1;
+            mainseeds[(*mainseeds_num)++] = bfslinks[i].lctgsmp;
         }
-        *main_num = flag_num;
-        for (i = 0; i < *main_num; i++) {
-            copy_BFSlinks(&templinks[i], &mainlinks[i]);
+        if (!seen[rnode]) {
+            seen[rnode] = 1;
+            mainseeds[(*mainseeds_num)++] = bfslinks[i].rctgsmp;
         }
-        
     }
-    // free
-    free(templinks);
-    removeDup(mainseeds, mainseeds_num);
-}
-
-static void run_db(const char *cutseq) {
-
-    log_message(INFO, "Building database...");
-    size_t dbcomond_len = snprintf(NULL, 0, "makeblastdb -in %s -dbtype nucl -out %s.db", 
-                                    cutseq, cutseq) + 1;
-    char* dbcommand = malloc(dbcomond_len);
-    snprintf(dbcommand, dbcomond_len, "makeblastdb -in %s -dbtype nucl -out %s.db", 
-                                    cutseq, cutseq);
 
-    execute_command(dbcommand, 0, 0);
+    free(seen);
+    free(queue);
+    free(link_alive);
+    free(removed);
+    free(self);
+    free(deg);
+    ctggraph_free(graph);
 }
 
-static void run_blastn(const char *cutseq, const char *ctgseq, char *blastn_out, int num_threads, int *num_hits) {
-
-    size_t comond_len = snprintf(NULL, 0, "blastn -query %s -db %s.db -outfmt 6 -num_threads %d > %s", 
-                                    ctgseq, cutseq, num_threads, blastn_out) + 1;
-    char* command = malloc(comond_len);
-    snprintf(command, comond_len, "blastn -query %s -db %s.db -outfmt 6 -num_threads %d > %s", 
-                                    ctgseq, cutseq, num_threads, blastn_out);
-
-    execute_command(command, 0, 1);
-
-    if (access(blastn_out, F_OK) != 0) {
-        log_message(ERROR, "Failed to run blastn");
-        free(command);
-        return;
-    }
-
-    free(command);
+typedef struct {
+    const CtgStore* store;
+    const CtgDepth* ctgdepth;
+    uint32_t* ovl;
+} trimJob;
+
+static void trim_worker(void* data, long i, int tid) {
+    trimJob* job = (trimJob*)data;
+    uint32_t seq_len;
+    const char* seq = ctgstore_seq(job->store, i + 1, &seq_len);
+    if (seq == NULL || job->ctgdepth[i].len <= 1000 || seq_len < 1000) return;
+    job->ovl[i] = ntsearch_self_overlap(seq, seq_len, 0.98);
+}
 
-    size_t line_len;
-    char *line = NULL;
-    FILE *blastn_file = fopen(blastn_out, "r");
-    if (!blastn_file) {
-        log_message(ERROR, "Failed to open file %s", blastn_out);
-        return;
+void trim_circular(CtgStore* store, CtgDepth* ctgdepth, int num_ctg, int num_threads) {
+    /* 
+     * Assemblers often write a circular contig with its junction repeated at both ends. 
+     * The repeat is cut once here, so that paths, the GFA, the gene search and both 
+     * optgfa passes see the same sequence; optgfa self-links the trimmed contigs.
+     */
+    int i, n = num_ctg < store->ctg_num ? num_ctg : store->ctg_num, num_trim = 0;
+    trimJob job;
+    job.store = store;
+    job.ctgdepth = ctgdepth;
+    job.ovl = calloc(n > 0 ? n : 1, sizeof(uint32_t));
+    kt_for(num_threads, trim_worker, &job, n);
+    for (i = 0; i < n; i++) {
+        if (job.ovl[i] == 0) continue;
+        ctgstore_trim(store, i + 1, job.ovl[i]);
+        ctgdepth[i].len = store->len[i];
+        num_trim++;
     }
+    if (num_trim > 0) log_message(INFO, "Trimmed the repeated junction of %d circular contig(s)", num_trim);
+    free(job.ovl);
+}
 
-    while ((line_len = getline(&line, &line_len, blastn_file)) != -1) {
-        if (line[0] == '#') {
-            continue;
-        } else {
-            (*num_hits) += 1;
+/* link the end of a circular contig to its start, unless it is linked already */
+static void add_selflink(BFSlinks** bfslinks, int* num_bfslinks, CtgDepth* ctgdepth, int tempctg) {
+    uint64_t i;
+    for (i = 0; i < *num_bfslinks; i++) {
+        if ((*bfslinks)[i].lctgsmp == tempctg && (*bfslinks)[i].rctgsmp == tempctg) {
+            return;
         }
     }
-
-    fclose(blastn_file);
-    free(line);
+    (*bfslinks) = realloc(*bfslinks, (*num_bfslinks + 1)*sizeof(BFSlinks));
+    if (*bfslinks == NULL) {
+        log_message(ERROR, "Failed to allocate memory for BFSlinks");
+        exit(EXIT_FAILURE);
+    }
+    // (*bfslinks)[*num_bfslinks].lctg = strdup(ctgdepth[tempctg - 1].ctg);
+    (*bfslinks)[*num_bfslinks].lutrsmp = 5;
+    (*bfslinks)[*num_bfslinks].lctgsmp = tempctg;
+    (*bfslinks)[*num_bfslinks].lctglen = ctgdepth[tempctg - 1].len;
+    
+    // (*bfslinks)[*num_bfslinks].rctg = strdup(ctgdepth[tempctg - 1].ctg);
+    (*bfslinks)[*num_bfslinks].rutrsmp = 3;
+    (*bfslinks)[*num_bfslinks].rctgsmp = tempctg;
+    (*bfslinks)[*num_bfslinks].rctglen = ctgdepth[tempctg - 1].len;
+    
+    (*bfslinks)[*num_bfslinks].linkdepth = ctgdepth[tempctg - 1].depth;
+    (*num_bfslinks)++;
 }
 
 
 void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** bfslinks, int* num_bfslinks, 
-            CtgDepth* ctgdepth, const char* output, const char* all_fna, const char* allgraph, 
+            CtgDepth* ctgdepth, const char* output, const char* all_fna, const CtgStore* store, const char* allgraph, 
             const char* organelles_type, int* mainseeds_num, int** mainseeds, int interfering_ctg_num, 
-            int* interfering_ctg, int taxo, float filter_depth, char* cutseq) 
+            int* interfering_ctg, int taxo, float filter_depth, const NtIndex* reads_idx, int num_threads, 
+            double path_time_limit, uint64_t path_max_expansions, int path_beam_width) 
 {
-    // addseq(allgraph, all_fna, ctgdepth);
-
-    FILE* fpall = fopen(all_fna, "r");
-    if (fpall == NULL) {
-        log_message(ERROR, "Failed to open %s", all_fna);
-        exit(EXIT_FAILURE);
-    }
-
-    fnainfo* fnainfos = (fnainfo*) calloc(num_dynseeds, sizeof(fnainfo));
-    
-    char* line = NULL;
+    uint64_t i, j, n, p, v;
+    uint32_t seq_len;
     size_t len = 0;
-    int tmp_num_dynseeds = 0;
-    int flag_seq = 0;
-    char* tempseq = NULL;
-    size_t tempseq_len = 0;
-    int flag_end = 0;
-    int* temp_dynseed = calloc(num_dynseeds, sizeof(int));
-    khash_t(Ha_nodekmer) *nodeKmer_hash = kh_init(Ha_nodekmer);
-    size_t kmer1000_len = snprintf(NULL, 0, "%s/Kmer1000.fa", output) + 1;
-    char kmer1000[kmer1000_len];
-    snprintf(kmer1000, kmer1000_len, "%s/Kmer1000.fa", output);
-    FILE* kout = fopen(kmer1000, "w");
-    while (getline(&line, &len, fpall) != -1) 
-    {
-        if (line[0] == '>') 
-        {
-            char *token = strtok(line, " ");
-            char *tempctg = token + 1;
-
-            int intctg = rm_contig(tempctg);
-            if (findint(*dynseeds, num_dynseeds, intctg) == 1) {
-                fnainfos[tmp_num_dynseeds].ctg = intctg;
-                
-                if (tmp_num_dynseeds > 0) {
-                    fnainfos[tmp_num_dynseeds - 1].seq = strdup(tempseq);
-                    to_upper(fnainfos[tmp_num_dynseeds - 1].seq);
-
-                    if (ctgdepth[fnainfos[tmp_num_dynseeds - 1].ctg - 1].len > 1000) {
-                        char seqKmer[1001];
-
-                        char* tempseq_end = tempseq + strlen(tempseq) - 500;
-                        char* tempseq_start = tempseq;
-                        strncpy(seqKmer, tempseq_end, 500);
-                        seqKmer[500] = '\0';
-                        strncat(seqKmer, tempseq_start, 500);
-                        int ret;
-                        khint_t k = kh_put(Ha_nodekmer, nodeKmer_hash, fnainfos[tmp_num_dynseeds - 1].ctg, &ret);
-                        kh_value(nodeKmer_hash, k) = 1;
-                        fprintf(kout, ">%d\n%s\n", fnainfos[tmp_num_dynseeds - 1].ctg, seqKmer);
-                    }
-
-                    free(tempseq);
-                    flag_end = 0;
-                }
-                tempseq = malloc(1);
-                tempseq[0] = '\0';
-                flag_seq = 1;
-                if (findint(temp_dynseed, num_dynseeds, intctg) == 1) {
-                    log_message(ERROR, "%s is not a valid contig in %s", ctgdepth[intctg - 1].ctg, all_fna);
-                    exit(EXIT_FAILURE);
-                }
-                temp_dynseed[tmp_num_dynseeds] = intctg;
-                tmp_num_dynseeds++;
-                tempseq_len = 0;
-            } else {
-                flag_seq = 0;
-            }
-
-        } else if (flag_seq) 
-        {
-            flag_end = 1;
-            line[strcspn(line, "\n")] = 0;
-            size_t seqlen = strlen(line);
-
-            tempseq = realloc(tempseq, tempseq_len + seqlen + 1);
-            if (tempseq == NULL) {
-                log_message(ERROR, "Failed to allocate memory for tempseq");
-                exit(EXIT_FAILURE);
-            }
-            strcat(tempseq, line);
-            tempseq_len += seqlen;
+    const char* seq;
+
+    /* circular contigs trimmed by trim_circular, otherwise the junction of the end and start */
+    int num_kmer = 0;
+    int* kmer_ctg = malloc((num_dynseeds > 0 ? num_dynseeds : 1) * sizeof(int));
+    char** kmer_seq = malloc((num_dynseeds > 0 ? num_dynseeds : 1) * sizeof(char*));
+    for (i = 0; i < num_dynseeds; i++) {
+        int seed = (*dynseeds)[i];
+        seq = ctgstore_seq(store, seed, &seq_len);
+        if (seq == NULL) continue;
+        if (store->trim[seed - 1] > 0) {
+            add_selflink(bfslinks, num_bfslinks, ctgdepth, seed);
+            continue;
         }
-    }
-
-    if (flag_end) {
-        fnainfos[tmp_num_dynseeds - 1].seq = strdup(tempseq);
-        to_upper(fnainfos[tmp_num_dynseeds - 1].seq);
-
-        if (ctgdepth[fnainfos[tmp_num_dynseeds - 1].ctg - 1].len > 1000) {
-            char seqKmer[1001];
-
-            char* tempseq_end = tempseq + strlen(tempseq) - 500;
-            char* tempseq_start = tempseq;
-            strncpy(seqKmer, tempseq_end, 500);
-            seqKmer[500] = '\0';
-            strncat(seqKmer, tempseq_start, 500);
-            int ret;
-            khint_t k = kh_put(Ha_nodekmer, nodeKmer_hash, fnainfos[tmp_num_dynseeds - 1].ctg, &ret);
-            kh_value(nodeKmer_hash, k) = 1;
-            fprintf(kout, ">%d\n%s\n", fnainfos[tmp_num_dynseeds - 1].ctg, seqKmer);
+        if (ctgdepth[seed - 1].len > 1000 && seq_len >= 1000) {
+            kmer_seq[num_kmer] = malloc(1001);
+            snprintf(kmer_seq[num_kmer], 1001, "%.*s%.*s", 500, seq + seq_len - 500, 500, seq);
+            kmer_ctg[num_kmer++] = seed;
         }
-
-        free(tempseq);
     }
-    free(line);
-    fclose(kout);
-    fclose(fpall);
-
-    /* circular / linear */
-    int num_hits = 0;
-    // char* cutseq = malloc(strlen(output) + strlen("/subsample/PMAT_cut_seq.fa") + 1);
-    // if (cutseq == NULL) {
-    //     fprintf(stderr, "Memory allocation failed!\n");
-    //     exit(EXIT_FAILURE);
-    // }
-    // snprintf(cutseq, strlen(output) + strlen("/subsample/PMAT_cut_seq.fa") + 1, 
-    //     "%s/subsample/PMAT_cut_seq.fa", output);
-    char* cutdb = malloc(sizeof(*cutdb) * (snprintf(NULL, 0, "%s.db.ndb", cutseq) + 1));
-    snprintf(cutdb, sizeof(*cutdb) * (snprintf(NULL, 0, "%s.db.ndb", cutseq) + 1), 
-        "%s.db.ndb", cutseq);
-
-    char* blast_out = (char*) malloc(sizeof(*blast_out) * (snprintf(NULL, 0, "%s/PMAT_kmer1000.txt", output) + 1));
-    snprintf(blast_out, sizeof(*blast_out) * (snprintf(NULL, 0, "%s/PMAT_kmer1000.txt", output) + 1), 
-        "%s/PMAT_kmer1000.txt", output);
-    
-    if (is_file(cutdb) == 0) run_db(cutseq);
-    run_blastn(cutseq, kmer1000, blast_out, 8, &num_hits);
-    remove_file(kmer1000);
-    /* the type of contig structure */
-    uint64_t i, j, n;
-    if (num_hits > 0) {
-        FILE* fpblast = fopen(blast_out, "r");
-        if (fpblast == NULL) {
-            log_message(ERROR, "Failed to open blast_out file %s", blast_out);
-            exit(EXIT_FAILURE);
-        }
-        
-        size_t blt_len;
-        char *blt_line = NULL;
-        while ((blt_len = getline(&blt_line, &len, fpblast)) != -1) {
-            int tempctg;
-            float tempiden;
-            int temps;
-            int tempe;
-
-            if (blt_line[0] == '#') {
-                continue;
-            } else {
-                sscanf(blt_line, "%d\t%*d\t%f\t%*d\t%*d\t%*d\t%d\t%d\t%*f\t%*d", &tempctg, &tempiden, &temps, &tempe);
-            }
-            if (kh_value(nodeKmer_hash, kh_get(Ha_nodekmer, nodeKmer_hash, tempctg)) != 0){
-                if (tempiden > 0.99 && temps <= 450 && tempe >= 550) {
-                    int add_flag = 1;
-                    for (i = 0; i < *num_bfslinks; i++) {
-                        if ((*bfslinks)[i].lctgsmp == tempctg && (*bfslinks)[i].rctgsmp == tempctg) {
-                            add_flag = 0;
-                            kh_value(nodeKmer_hash, kh_get(Ha_nodekmer, nodeKmer_hash, tempctg)) = 0;
-                            break;
-                        }
-                    }
-                    kh_value(nodeKmer_hash, kh_get(Ha_nodekmer, nodeKmer_hash, tempctg)) += 1;
 
-                    if (add_flag && kh_value(nodeKmer_hash, kh_get(Ha_nodekmer, nodeKmer_hash, tempctg)) >= 4) {
-                        (*bfslinks) = realloc(*bfslinks, (*num_bfslinks + 1)*sizeof(BFSlinks));
-                        if (*bfslinks == NULL) {
-                            log_message(ERROR, "Failed to allocate memory for BFSlinks");
-                            exit(EXIT_FAILURE);
-                        }
-                        // (*bfslinks)[*num_bfslinks].lctg = strdup(ctgdepth[tempctg - 1].ctg);
-                        (*bfslinks)[*num_bfslinks].lutrsmp = 5;
-                        (*bfslinks)[*num_bfslinks].lctgsmp = tempctg;
-                        (*bfslinks)[*num_bfslinks].lctglen = ctgdepth[tempctg - 1].len;
-                        
-                        // (*bfslinks)[*num_bfslinks].rctg = strdup(ctgdepth[tempctg - 1].ctg);
-                        (*bfslinks)[*num_bfslinks].rutrsmp = 3;
-                        (*bfslinks)[*num_bfslinks].rctgsmp = tempctg;
-                        (*bfslinks)[*num_bfslinks].rctglen = ctgdepth[tempctg - 1].len;
-                        
-                        (*bfslinks)[*num_bfslinks].linkdepth = ctgdepth[tempctg - 1].depth;
-                        (*num_bfslinks)++;
-                        
-                        kh_value(nodeKmer_hash, kh_get(Ha_nodekmer, nodeKmer_hash, tempctg)) = 0;
-                    }
-                }
-            }
-        }
+    /* circular / linear: at least 4 reads across the junction */
+    int* num_span = ntsearch_spanning(reads_idx, kmer_seq, num_kmer, 450, 550, 0.8, 4, num_threads);
+    for (j = 0; j < num_kmer; j++) {
+        if (num_span[j] >= 4) add_selflink(bfslinks, num_bfslinks, ctgdepth, kmer_ctg[j]);
+        free(kmer_seq[j]);
     }
-    remove_file(blast_out);
-    free(cutdb); free(blast_out);
+    free(num_span); free(kmer_ctg); free(kmer_seq);
 
     // create output/gfa_result directory
     char* gfa_output = (char*) malloc(sizeof(*gfa_output) * (snprintf(NULL, 0, "%s/gfa_result", output) + 1));
@@ -486,6 +304,10 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
     char rawfa[rawfa_len];
     snprintf(rawfa, rawfa_len, "%s/gfa_%s.fa", gfa_output, organelles_type);
 
+    size_t pathfa_out_len = snprintf(NULL, 0, "%s/PMAT_%s.fa", gfa_output, organelles_type) + 1;
+    char pathfa[pathfa_out_len];
+    snprintf(pathfa, pathfa_out_len, "%s/PMAT_%s.fa", gfa_output, organelles_type);
+
 
     /* raw graph */
     FILE* fprawgfa = fopen(rawgfa, "w");
@@ -504,11 +326,10 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
             int seed = (*dynseeds)[i];
             int ctg_RC = ctgdepth[seed - 1].len * ctgdepth[seed - 1].depth;
 
-            for (j = 0; j < num_dynseeds; j++) {
-                if (seed == fnainfos[j].ctg) {
-                    fprintf(fprawgfa, "S\t%d\t%s\tLN:i:%d\tRC:i:%d\n", seed, fnainfos[j].seq, ctgdepth[seed - 1].len, ctg_RC);
-                    fprintf(fprawfa, ">%d Len:%d Dep:%.2f\n%s\n", seed, ctgdepth[seed - 1].len, ctgdepth[seed - 1].depth, fnainfos[j].seq);
-                }
+            seq = ctgstore_seq(store, seed, &seq_len);
+            if (seq != NULL) {
+                fprintf(fprawgfa, "S\t%d\t%.*s\tLN:i:%d\tRC:i:%d\n", seed, (int)seq_len, seq, ctgdepth[seed - 1].len, ctg_RC);
+                fprintf(fprawfa, ">%d Len:%d Dep:%.2f\n%.*s\n", seed, ctgdepth[seed - 1].len, ctgdepth[seed - 1].depth, (int)seq_len, seq);
             }
         }
 
@@ -610,9 +431,22 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
     int rm_flag = 0;
     if (1) {
         /* Capturing all mitochondrial structures */
-        khash_t(Ha_structures)* h_structures = kh_init(Ha_structures);
-        uint32_t structure_num = bfs_structure(num_dynseeds, *num_bfslinks, *bfslinks, *dynseeds, h_structures);
+        BFSstructures structures;
+        uint32_t structure_num = bfs_structure(num_dynseeds, *num_bfslinks, *bfslinks, *dynseeds, &structures);
+        /* the searches flush their best path so far to pathfa, from the contigs of all structures */
+        uint32_t struct_node_num = 0;
+        for (i = 0; i < structure_num; i++) struct_node_num += structures.structure[i].num_nodes;
+        CtgPack* flush_pack = ctgpack_build(store, structures.node, struct_node_num);
+        pathLimits limits;
+        limits.deadline = path_time_limit > 0 ? realtime() + path_time_limit : 0;
+        limits.max_expansions = path_max_expansions;
+        limits.beam_width = path_beam_width;
+        limits.pack = flush_pack;
+        limits.output = pathfa;
         int struc = 0;
+        pathJob* jobs = (pathJob*)malloc((structure_num + 1) * sizeof(pathJob));
+        int* job_struc = (int*)malloc((structure_num + 1) * sizeof(int));
+        uint32_t num_jobs = 0;
         int main_seeds = 0;
         uint64_t max_structure_num = 1;
         
@@ -621,15 +455,12 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
         
         for (i = 0; i < structure_num; i++) 
         {
-            k = kh_get(Ha_structures, h_structures, i);
-            if (k != kh_end(h_structures)) {
-                BFSstructure* temp_struct = kh_value(h_structures, k);
-                for (j = 0; j < temp_struct->num_nodes; j++) {
-                    if (maxscore < ctgdepth[(temp_struct->node[j]) - 1].len &&
-                        findint(interfering_ctg, interfering_ctg_num, temp_struct->node[j]) == 0) {
-                        temp_filter_depth = ctgdepth[(temp_struct->node[j]) - 1].depth;
-                        maxscore = ctgdepth[(temp_struct->node[j]) - 1].len;
-                    }
+            BFSstructure* temp_struct = &structures.structure[i];
+            for (j = 0; j < temp_struct->num_nodes; j++) {
+                if (maxscore < ctgdepth[(temp_struct->node[j]) - 1].len &&
+                    findint(interfering_ctg, interfering_ctg_num, temp_struct->node[j]) == 0) {
+                    temp_filter_depth = ctgdepth[(temp_struct->node[j]) - 1].depth;
+                    maxscore = ctgdepth[(temp_struct->node[j]) - 1].len;
                 }
             }
         }
@@ -642,357 +473,325 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
             max_structure_num = 1;
             linear_f = 0;
             struc++;
-            k = kh_get(Ha_structures, h_structures, i);
-            if (k != kh_end(h_structures)) {
-                BFSstructure* temp_struct = kh_value(h_structures, k);
-
-                /* links > 0 and nodes > 0 */
-                BFSlinks* temp_mainlinks = (BFSlinks*) malloc((*num_bfslinks) * sizeof(BFSlinks));
-                int* temp_mainseeds = (int*) malloc(2 * temp_struct->num_links * sizeof(int));
-                int temp_main_num = 0;
-                int temp_mainseeds_num = 0;
-
-                BFSlinks* temp_structlinks = (BFSlinks*) malloc((temp_struct->num_links) * sizeof(BFSlinks));
-                for (j = 0; j < temp_struct->num_links; j++) {
-                    copy_BFSlinks(&temp_structlinks[j], &temp_struct->links[j]);
+            BFSstructure* temp_struct = &structures.structure[i];
+
+            /* links > 0 and nodes > 0 */
+            BFSlinks* temp_mainlinks = (BFSlinks*) malloc((temp_struct->num_links + 1) * sizeof(BFSlinks));
+            int* temp_mainseeds = (int*) malloc((2 * temp_struct->num_links + temp_struct->num_nodes) * sizeof(int));
+            int temp_main_num = 0;
+            int temp_mainseeds_num = 0;
+
+            maingraph(temp_struct->links, temp_mainlinks, ctgdepth, temp_struct->num_nodes, temp_struct->num_links, temp_mainseeds, 
+                        &temp_main_num, &temp_mainseeds_num, NULL, 0, 0.3*temp_filter_depth);
+            if (temp_mainseeds_num == 0) {
+                linear_f = 1;
+                for (j = 0; j < temp_struct->num_nodes; j++) {
+                    if (ctgdepth[(temp_struct->node[j]) - 1].depth > 0.3*temp_filter_depth) {
+                        temp_mainseeds_num++;
+                    }
                 }
-                maingraph(temp_structlinks, temp_mainlinks, ctgdepth, temp_struct->num_nodes, temp_struct->num_links, temp_mainseeds, 
-                            &temp_main_num, &temp_mainseeds_num, NULL, 0, 0.3*temp_filter_depth);
-                if (temp_mainseeds_num == 0) {
-                    linear_f = 1;
+
+                if (temp_mainseeds_num > 0) {
+                    temp_mainseeds_num = 0;
                     for (j = 0; j < temp_struct->num_nodes; j++) {
-                        if (ctgdepth[(temp_struct->node[j]) - 1].depth > 0.3*temp_filter_depth) {
-                            temp_mainseeds_num++;
-                        }
+                        temp_mainseeds[j] = temp_struct->node[j];
+                        temp_mainseeds_num++;
                     }
-
-                    if (temp_mainseeds_num > 0) {
-                        temp_mainseeds_num = 0;
-                        for (j = 0; j < temp_struct->num_nodes; j++) {
-                            temp_mainseeds[j] = temp_struct->node[j];
-                            temp_mainseeds_num++;
-                        }
-                        for (j = 0; j < temp_struct->num_links; j++) {
-                            copy_BFSlinks(&temp_mainlinks[j], &temp_struct->links[j]);
-                            temp_main_num++;
-                        }
+                    for (j = 0; j < temp_struct->num_links; j++) {
+                        copy_BFSlinks(&temp_mainlinks[j], &temp_struct->links[j]);
+                        temp_main_num++;
                     }
+                }
 
-                } else if (strcmp(organelles_type, "pt") == 0 || taxo == 1 || taxo == 2) {
-                    float flag_depth = ctgdepth[(*dynseeds)[0] - 1].depth;
-                    for (j = 0; j < temp_struct->num_nodes; j++) {
-                        float temp_depth = ctgdepth[(temp_struct->node[j]) - 1].depth;
-                        int temp_len = ctgdepth[(temp_struct->node[j]) - 1].len;
-                        if (temp_depth > 0.4 * flag_depth &&
-                            temp_depth < 2 * flag_depth &&
-                            temp_len > 100 &&
-                            findint(temp_mainseeds, temp_mainseeds_num, temp_struct->node[j]) == 0 &&
-                            findint(temp_struct->node, temp_struct->num_nodes, temp_struct->node[j]) == 1) {
-
-                            linear_f = 1;
-                            temp_mainseeds_num = temp_struct->num_nodes;
-                            temp_main_num = temp_struct->num_links;
-                            for (n = 0; n < temp_struct->num_links; n++) {
-                                copy_BFSlinks(&temp_mainlinks[n], &temp_struct->links[n]);
-                            }
-                            for (n = 0; n < temp_struct->num_nodes; n++) {
-                                temp_mainseeds[n] = temp_struct->node[n];
-                            }
-                            break;
+            } else if (strcmp(organelles_type, "pt") == 0 || taxo == 1 || taxo == 2) {
+                float flag_depth = ctgdepth[(*dynseeds)[0] - 1].depth;
+                for (j = 0; j < temp_struct->num_nodes; j++) {
+                    float temp_depth = ctgdepth[(temp_struct->node[j]) - 1].depth;
+                    int temp_len = ctgdepth[(temp_struct->node[j]) - 1].len;
+                    if (temp_depth > 0.4 * flag_depth &&
+                        temp_depth < 2 * flag_depth &&
+                        temp_len > 100 &&
+                        findint(temp_mainseeds, temp_mainseeds_num, temp_struct->node[j]) == 0 &&
+                        findint(temp_struct->node, temp_struct->num_nodes, temp_struct->node[j]) == 1) {
+
+                        linear_f = 1;
+                        temp_mainseeds_num = temp_struct->num_nodes;
+                        temp_main_num = temp_struct->num_links;
+                        for (n = 0; n < temp_struct->num_links; n++) {
+                            copy_BFSlinks(&temp_mainlinks[n], &temp_struct->links[n]);
+                        }
+                        for (n = 0; n < temp_struct->num_nodes; n++) {
+                            temp_mainseeds[n] = temp_struct->node[n];
                         }
+                        break;
                     }
-                    // if (findint(temp_mainseeds, temp_mainseeds_num, (*dynseeds)[0]) == 0 &&
-                    //     findint(temp_struct->node, temp_struct->num_nodes, (*dynseeds)[0]) == 1) {
-                    //     linear_f = 1;
-                    //     temp_mainseeds_num = temp_struct->num_nodes;
-                    //     temp_main_num = temp_struct->num_links;
-                    //     for (int j = 0; j < temp_struct->num_links; j++) {
-                    //         copy_BFSlinks(&temp_mainlinks[j], &temp_struct->links[j]);
-                    //     }
-                    //     for (int j = 0; j < temp_struct->num_nodes; j++) {
-                    //         temp_mainseeds[j] = temp_struct->node[j];
-                    //     }
-                    // }
-                }
-                
-                /* skip complex structures (node > 500) */
-                if (temp_mainseeds_num > 200) {
-                    struc--;
-                    continue;
                 }
+                // if (findint(temp_mainseeds, temp_mainseeds_num, (*dynseeds)[0]) == 0 &&
+                //     findint(temp_struct->node, temp_struct->num_nodes, (*dynseeds)[0]) == 1) {
+                //     linear_f = 1;
+                //     temp_mainseeds_num = temp_struct->num_nodes;
+                //     temp_main_num = temp_struct->num_links;
+                //     for (int j = 0; j < temp_struct->num_links; j++) {
+                //         copy_BFSlinks(&temp_mainlinks[j], &temp_struct->links[j]);
+                //     }
+                //     for (int j = 0; j < temp_struct->num_nodes; j++) {
+                //         temp_mainseeds[j] = temp_struct->node[j];
+                //     }
+                // }
+            }
+            
 
-                for (j = 0; j < temp_mainseeds_num; j++) 
-                {
-                    if (findint(*mainseeds, *mainseeds_num, temp_mainseeds[j]) == 0) {
-                        (*mainseeds)[(*mainseeds_num)] = temp_mainseeds[j];
-                        (*mainseeds_num)++;
-                    }
+            for (j = 0; j < temp_mainseeds_num; j++) 
+            {
+                if (findint(*mainseeds, *mainseeds_num, temp_mainseeds[j]) == 0) {
+                    (*mainseeds)[(*mainseeds_num)] = temp_mainseeds[j];
+                    (*mainseeds_num)++;
                 }
+            }
 
 
-                /* h_links 1:{2,3,4;3}；2:{1,5,6;3}；3:{1,4;2}... */
-                khash_t(Ha_nodelink)* h_links = kh_init(Ha_nodelink);
+            CtgGraph* graph = ctggraph_build(temp_mainlinks, temp_main_num, temp_mainseeds, temp_mainseeds_num);
+            for (j = 0; j < graph->num_nodes; j++) 
+            {
+                uint32_t degree = ctggraph_degree(graph, CG_END(j, 3)) + ctggraph_degree(graph, CG_END(j, 5));
+                if (degree > 1) max_structure_num = max_structure_num * (degree - 1);
+            }
 
-                for (j = 0; j < temp_mainseeds_num; j++) 
+            int transfer_num = 0;
+            int non_transfer_num = 0;
+            
+            if (interfering_ctg_num > 0) {
+                int* transfer_ctg = (int*) malloc(interfering_ctg_num * sizeof(int));
+                for (v = 0; v < graph->num_nodes; v++) 
                 {
-                    nodeNum tempNodeNum;
-                    tempNodeNum.num = 0;
-                    tempNodeNum.node = (int*) malloc((temp_mainseeds_num + 1) * sizeof(int));
-                    int ret;
-
-                    ka = kh_put(Ha_nodelink, h_links, temp_mainseeds[j], &ret);
-                    for (n = 0; n < temp_main_num; n++) 
-                    {
-                        if (temp_mainlinks[n].lctgsmp == temp_mainseeds[j]) {
-                            tempNodeNum.node[tempNodeNum.num] = temp_mainlinks[n].rctgsmp;
-                            tempNodeNum.num++;
-                        } else if (temp_mainlinks[n].rctgsmp == temp_mainseeds[j])
+                    int key = graph->ctg[v];
+                    /* the neighbours of key are the slices of both of its ends */
+                    uint32_t nbr_beg = graph->off[CG_END(v, 3)];
+                    uint32_t nbr_end = graph->off[CG_END(v, 5) + 1];
+                    int flag_transfer = 0;
+
+                    if (findint(interfering_ctg, interfering_ctg_num, key) == 0 && ctgdepth[key - 1].len > 30) {
+                        for (p = nbr_beg; p < nbr_end; p++) 
                         {
-                            tempNodeNum.node[tempNodeNum.num] = temp_mainlinks[n].lctgsmp;
-                            tempNodeNum.num++;
+                            if (findint(interfering_ctg, interfering_ctg_num, graph->ctg[CG_NODE(graph->nbr[p])]) == 0)
+                                flag_transfer++;
                         }
-                        
                     }
 
-                    kh_value(h_links, ka) = tempNodeNum;
-                    if (tempNodeNum.num > 1) max_structure_num = max_structure_num * (tempNodeNum.num - 1);
-                }
-
-                int transfer_num = 0;
-                int non_transfer_num = 0;
-                
-                if (interfering_ctg_num > 0) {
-                    int* transfer_ctg = (int*) malloc(interfering_ctg_num * sizeof(int));
-                    for (ka = kh_begin(h_links); ka != kh_end(h_links); ++ka) 
+                    for (p = nbr_beg; p < nbr_end; p++) 
                     {
-                        if (kh_exist(h_links, ka)) {
-                            int key = kh_key(h_links, ka);
-                            
-                            int flag_transfer = 0;
-
-                            nodeNum tempNodeNum = kh_value(h_links, kh_get(Ha_nodelink, h_links, key));
-
-                            if (findint(interfering_ctg, interfering_ctg_num, key) == 0 && ctgdepth[key - 1].len > 30) {
-                                for (j = 0; j < tempNodeNum.num; j++) 
+                        int nbr_node = CG_NODE(graph->nbr[p]);
+                        int nbr = graph->ctg[nbr_node];
+                        if (findint(interfering_ctg, interfering_ctg_num, nbr) == 1 &&
+                            findint(interfering_ctg, interfering_ctg_num, key) == 1) {
+                                non_transfer_num++;
+                        } else if (findint(interfering_ctg, interfering_ctg_num, nbr) == 1 &&
+                            findint(interfering_ctg, interfering_ctg_num, key) == 0 &&
+                            findint(transfer_ctg, transfer_num, nbr) == 0 &&
+                            ctgdepth[nbr - 1].len > 30) {
+                                if (flag_transfer > 0) {
+                                    transfer_ctg[transfer_num] = nbr;
+                                    transfer_num++;
+                                } else if (ctgdepth[key - 1].len > 2000) {
+                                    transfer_ctg[transfer_num] = nbr;
+                                    transfer_num++;
+                                }
+                        } else if (findint(interfering_ctg, interfering_ctg_num, nbr) == 0 &&
+                            findint(interfering_ctg, interfering_ctg_num, key) == 1 &&
+                            findint(transfer_ctg, transfer_num, key) == 0) {
+                                int temp_flag = 0;
+                                for (n = graph->off[CG_END(nbr_node, 3)]; n < graph->off[CG_END(nbr_node, 5) + 1]; n++) 
                                 {
-                                    if (findint(interfering_ctg, interfering_ctg_num, tempNodeNum.node[j]) == 0)
-                                        flag_transfer++;
+                                    if (findint(interfering_ctg, interfering_ctg_num, graph->ctg[CG_NODE(graph->nbr[n])]) == 0)
+                                        temp_flag ++;
                                 }
-                            }
-
-                            for (j = 0; j < tempNodeNum.num; j++) 
-                            {
-                                if (findint(interfering_ctg, interfering_ctg_num, tempNodeNum.node[j]) == 1 &&
-                                    findint(interfering_ctg, interfering_ctg_num, key) == 1) {
-                                        non_transfer_num++;
-                                } else if (findint(interfering_ctg, interfering_ctg_num, tempNodeNum.node[j]) == 1 &&
-                                    findint(interfering_ctg, interfering_ctg_num, key) == 0 &&
-                                    findint(transfer_ctg, transfer_num, tempNodeNum.node[j]) == 0 &&
-                                    ctgdepth[tempNodeNum.node[j] - 1].len > 30) {
-                                        if (flag_transfer > 0) {
-                                            transfer_ctg[transfer_num] = tempNodeNum.node[j];
-                                            transfer_num++;
-                                        } else if (ctgdepth[key - 1].len > 2000) {
-                                            transfer_ctg[transfer_num] = tempNodeNum.node[j];
-                                            transfer_num++;
-                                        }
-                                } else if (findint(interfering_ctg, interfering_ctg_num, tempNodeNum.node[j]) == 0 &&
-                                    findint(interfering_ctg, interfering_ctg_num, key) == 1 &&
-                                    findint(transfer_ctg, transfer_num, key) == 0) {
-                                        int temp_flag = 0;
-                                        nodeNum tempNodeNum2 = kh_value(h_links, kh_get(Ha_nodelink, h_links, tempNodeNum.node[j]));
-                                        for (n = 0; n < tempNodeNum2.num; n++) 
-                                        {
-                                            if (findint(interfering_ctg, interfering_ctg_num, tempNodeNum2.node[n]) == 0)
-                                                temp_flag ++;
-                                        }
-                                        if (temp_flag > 0) {
-                                            transfer_ctg[transfer_num] = key;
-                                            transfer_num++;
-                                        } else if (ctgdepth[tempNodeNum.node[j] - 1].len > 2000) {
-                                            transfer_ctg[transfer_num] = key;
-                                            transfer_num++;
-                                        }
+                                if (temp_flag > 0) {
+                                    transfer_ctg[transfer_num] = key;
+                                    transfer_num++;
+                                } else if (ctgdepth[nbr - 1].len > 2000) {
+                                    transfer_ctg[transfer_num] = key;
+                                    transfer_num++;
                                 }
-                            }
                         }
                     }
                 }
+                free(transfer_ctg);
+            }
+
+            if (transfer_num == 0 && non_transfer_num > 0) {
+                struc--;
+                rm_flag = 1;
+                ctggraph_free(graph);
+                continue;
+            } else if (temp_main_num > 0 || temp_mainseeds_num == 1) {
+                /* reported after the loop, in this order, and searched there unless it is a single contig */
+                int ctg_s = 0;
+                int ctg_len = 0;
+                int utr_s = 5;
+                int utr_e = 3;
 
-                for (ka = kh_begin(h_links); ka != kh_end(h_links); ++ka) 
+                for (j = 0; j < temp_mainseeds_num; j++) 
                 {
-                    if (kh_exist(h_links, ka)) {
-                        nodeNum tempNodeNum = kh_value(h_links, ka);
-                        free(tempNodeNum.node);
+                    if (ctg_len < ctgdepth[(temp_mainseeds[j]) - 1].len &&
+                        findint(interfering_ctg, interfering_ctg_num, temp_mainseeds[j]) == 0) {
+                        ctg_s = temp_mainseeds[j];
+                        ctg_len = ctgdepth[temp_mainseeds[j] - 1].len;
                     }
                 }
-                kh_destroy(Ha_nodelink, h_links);
-                if (transfer_num == 0 && non_transfer_num > 0) {
-                    struc--;
-                    rm_flag = 1;
-                    continue;
-                } else if (temp_main_num > 0) {
-                    log_info("Structure %d: \n", struc);
-                    // if (max_structure_num > 10000000000) {
-                    //     log_message(WARNING, "Too many ctg-pairs, Failed to find M-path."); 
-                    //     continue;
-                    // }
-                    int ctg_s = 0;
-                    int ctg_len = 0;
-                    int utr_s = 5;
-                    int utr_e = 3;
-                    int temp_linear = 0;
-
+                if (linear_f == 1) {
+                    int temp_len = 0;
+                    int temp_ctg = 0;
+                    int temp_utr = 0;
                     for (j = 0; j < temp_mainseeds_num; j++) 
                     {
-                        if (ctg_len < ctgdepth[(temp_mainseeds[j]) - 1].len &&
-                            findint(interfering_ctg, interfering_ctg_num, temp_mainseeds[j]) == 0) {
-                            ctg_s = temp_mainseeds[j];
-                            ctg_len = ctgdepth[temp_mainseeds[j] - 1].len;
+                        /* an end of the linear structure is linked on one side only */
+                        int node = graph->node[temp_mainseeds[j]];
+                        int num3 = ctggraph_degree(graph, CG_END(node, 3)) > 0;
+                        int num5 = ctggraph_degree(graph, CG_END(node, 5)) > 0;
+                        if (num3 + num5 == 1 && ctgdepth[temp_mainseeds[j] - 1].len > temp_len) {
+                            temp_len = ctgdepth[temp_mainseeds[j] - 1].len;
+                            temp_ctg = temp_mainseeds[j];
+                            temp_utr = num3 ? 3 : 5;
                         }
                     }
-                    if (linear_f == 1) {
-                        int temp_len = 0;
-                        int temp_ctg = 0;
-                        int temp_utr = 0;
-                        for (j = 0; j < temp_mainseeds_num; j++) 
-                        {
-                            int num = 0;
-                            int dy_utr = 0;
-                            for (n = 0; n < temp_main_num; n++) 
-                            {
-                                int temp_lutr = temp_mainlinks[n].lutrsmp;
-                                int temp_rutr = temp_mainlinks[n].rutrsmp;
-
-                                if (temp_mainlinks[n].lctgsmp == temp_mainseeds[j] && temp_lutr != dy_utr) {
-                                    num++;
-                                    dy_utr = temp_lutr;
-                                } else if (temp_mainlinks[n].rctgsmp == temp_mainseeds[j] && temp_rutr != dy_utr)
-                                {
-                                    num++;
-                                    dy_utr = temp_rutr;
-                                }
-                                if (num == 2) break;
-                            }
-                            if (num == 1 && ctgdepth[temp_mainseeds[j] - 1].len > temp_len) {
-                                temp_len = ctgdepth[temp_mainseeds[j] - 1].len;
-                                temp_ctg = temp_mainseeds[j];
-                                temp_utr = dy_utr;
-                            }
-                        }
-                        if (temp_ctg != 0) {ctg_s = temp_ctg; utr_s = (temp_utr == 3) ? 5 : 3; utr_e = (temp_utr == 3) ? 3 : 5; temp_linear = 1;}
-                    }
-                    int flag_err = 0;
-                    float mt_ratio = 0.0;
-                    float ctg_s_depth = ctgdepth[ctg_s - 1].depth;
-                    /* Filter based on longest mitochondrial contig depth */
-
-                    // maingraph(*bfslinks, mainlinks, ctgdepth, num_dynseeds, *num_bfslinks, *mainseeds, &main_num, mainseeds_num, NULL, 0, 0.5*ctg_s_depth);
-                    pathScore struct_path;
-                    findMpath(ctg_s, utr_s, ctg_s, utr_e, temp_main_num, temp_mainlinks, ctgdepth, temp_mainseeds, temp_mainseeds_num, interfering_ctg, interfering_ctg_num, &flag_err, &mt_ratio, taxo, &struct_path);
-                    if (mt_ratio < 0.7 && temp_linear == 0) {
-                        mt_ratio = 0.0;
-                        flag_err = 0;
-                        findMpath(ctg_s, utr_e, ctg_s, utr_s, temp_main_num, temp_mainlinks, ctgdepth, temp_mainseeds, temp_mainseeds_num, interfering_ctg, interfering_ctg_num, &flag_err, &mt_ratio, taxo, &struct_path);
-                    }
+                    if (temp_ctg != 0) {ctg_s = temp_ctg; utr_s = (temp_utr == 3) ? 5 : 3; utr_e = (temp_utr == 3) ? 3 : 5;}
+                }
+                job_struc[num_jobs] = struc;
+                pathJob* job = &jobs[num_jobs++];
+                job->search = temp_main_num > 0;
+                job->graph = graph;
+                job->mt_contigs = temp_mainseeds;
+                job->mt_num = temp_mainseeds_num;
+                job->ctg_s = ctg_s;
+                job->utr_s = utr_s;
+                job->utr_e = utr_e;
+                job->flag_err = 0;
+                job->mt_ratio = 0.0;
+                job->path.node_num = 0;
+                job->log.s = NULL;
+                job->log.len = job->log.cap = 0;
+                if (!job->search) {
+                    /* a single contig is its own path, which the flushes of the structures after it write */
+                    job->path.type = 1;
+                    job->path.path_len = ctgdepth[temp_mainseeds[0] - 1].len;
+                    job->path.node_num = 1;
+                    job->path.path_node = (int*) malloc(1 * sizeof(int));
+                    job->path.path_node[0] = temp_mainseeds[0];
+                    job->path.path_utr = (int*) malloc(1 * sizeof(int));
+                    job->path.path_utr[0] = 5;
+                }
+                free(temp_mainlinks);
+                continue;
+            } else if (temp_main_num == 0 && temp_mainseeds_num == 0) {
+                struc--;
+            }
 
-                    if (mt_ratio < 0.1 || flag_err == 1) {
-                        log_message(WARNING, "Failed to find M-path");
-                    } else {
-                        float struc_depth = 0.0;
-                        for (j = 0; j < struct_path.node_num; j++) {
-                            struc_depth += ctgdepth[struct_path.path_node[j] - 1].depth;
-                        }
-                        struc_depth /= struct_path.node_num;
-                        log_info("———————————————————————————————————————\n");
-                        log_info(" M-path  Length (bp)  Depth (x)  Score\n");
-                        log_info("-------  -----------  ---------  ------\n");
-                        log_info(" %-7s %-12ld %-10.2f %-5.2f\n", struct_path.type == 0 ? "C" : "L", struct_path.path_len, struc_depth, mt_ratio * 100);
-                        // printf("Graph path %s %.2f%% %ld bp:\n", path_score.type == 0 ? "C" : "L", ratio * 100, path_score.path_len);
-                        log_info("\n");
-                        log_info("** ");
-                        for (j = 0; j < (struct_path.node_num - 1); j++) {
-                            // log_info("%d (%c) -> ", struct_path.path_node[j], (struct_path.path_utr[j] == 3 ? '-' : '+'));
-                            log_info("%d -> ", struct_path.path_node[j]);
-                            if (ass_ctg_num > ass_ctg_mall) {
-                                ass_ctg_mall += 100;
-                                ass_ctg_arr = realloc(ass_ctg_arr, ass_ctg_mall * sizeof(int));
-                            }
-
-                            ass_ctg_arr[ass_ctg_num] = struct_path.path_node[j];
-                            ass_ctg_num++;
-                        }
-                        if (struct_path.type == 0) {
-                            log_info("%d\n", struct_path.path_node[struct_path.node_num - 1]);
-                        } else {
-                            // log_info("%d (%c)\n", struct_path.path_node[struct_path.node_num - 1], (struct_path.path_utr[struct_path.node_num - 1] == 3 ? '-' : '+'));
-                            log_info("%d\n", struct_path.path_node[struct_path.node_num - 1]);
-                            if (ass_ctg_num > ass_ctg_mall) {
-                                ass_ctg_mall += 100;
-                                ass_ctg_arr = realloc(ass_ctg_arr, ass_ctg_mall * sizeof(int));
-                            }
-                            ass_ctg_arr[ass_ctg_num] = struct_path.path_node[j];
-                            ass_ctg_num++;
-                        }
-                        log_info("———————————————————————————————————————\n");
+            // for (int j = 0; j < temp_main_num; j++) 
+            // {
+            //     free(temp_mainlinks[j].lutr);
+            //     free(temp_mainlinks[j].rutr);
+            //     free(temp_mainlinks[j].lctg);
+            //     free(temp_mainlinks[j].rctg);
+            // }
+            ctggraph_free(graph);
+            free(temp_mainlinks);
+            free(temp_mainseeds);
+        }
 
-                        ps_num++;
-                        if (ps_num > 100) {
-                            ps_struct = realloc(ps_struct, (ps_num + 1) * sizeof(pathScore));
-                        }
-                        ps_struct[ps_num - 1] = struct_path;
+        /* 
+         * the structures are searched at once on one pool of the threads, which take the tasks of the first 
+         * structures first; the first one not done flushes its best path after the paths before it. They are 
+         * reported in structure order, each with the messages of its search
+         */
+        findMpaths(jobs, num_jobs, ctgdepth, interfering_ctg, interfering_ctg_num, taxo, num_threads, &limits);
+        for (i = 0; i < num_jobs; i++)
+        {
+            pathJob* job = &jobs[i];
+            int* temp_mainseeds = job->mt_contigs;
+            log_info("Structure %d: \n", job_struc[i]);
+            log_release(&job->log);
+            if (job->search) {
+                pathScore struct_path = job->path;
+                float mt_ratio = job->mt_ratio;
+                int flag_err = job->flag_err;
+                if (mt_ratio < 0.1 || flag_err == 1) {
+                    log_message(WARNING, "Failed to find M-path");
+                } else {
+                    float struc_depth = 0.0;
+                    for (j = 0; j < struct_path.node_num; j++) {
+                        struc_depth += ctgdepth[struct_path.path_node[j] - 1].depth;
                     }
-
-
-                } else if (temp_main_num == 0 && temp_mainseeds_num == 1) {
-                    log_info("Structure %d: \n", struc);
+                    struc_depth /= struct_path.node_num;
                     log_info("———————————————————————————————————————\n");
                     log_info(" M-path  Length (bp)  Depth (x)  Score\n");
                     log_info("-------  -----------  ---------  ------\n");
-                    log_info(" %-7s %-12ld %-10.2f %-5.2f\n", "L", ctgdepth[temp_mainseeds[0] - 1].len, ctgdepth[temp_mainseeds[0] - 1].depth, 100.00);
+                    log_info(" %-7s %-12ld %-10.2f %-5.2f\n", struct_path.type == 0 ? "C" : "L", struct_path.path_len, struc_depth, mt_ratio * 100);
+                    // printf("Graph path %s %.2f%% %ld bp:\n", path_score.type == 0 ? "C" : "L", ratio * 100, path_score.path_len);
                     log_info("\n");
-                    log_info("** %d (+)\n", temp_mainseeds[0]);
-                    log_info("———————————————————————————————————————\n");
-                    if (ass_ctg_num > ass_ctg_mall) {
-                        ass_ctg_mall += 100;
-                        ass_ctg_arr = realloc(ass_ctg_arr, ass_ctg_mall * sizeof(int));
+                    log_info("** ");
+                    for (j = 0; j < (struct_path.node_num - 1); j++) {
+                        // log_info("%d (%c) -> ", struct_path.path_node[j], (struct_path.path_utr[j] == 3 ? '-' : '+'));
+                        log_info("%d -> ", struct_path.path_node[j]);
+                        if (ass_ctg_num >= ass_ctg_mall) {
+                            ass_ctg_mall += 100;
+                            ass_ctg_arr = realloc(ass_ctg_arr, ass_ctg_mall * sizeof(int));
+                        }
+
+                        ass_ctg_arr[ass_ctg_num] = struct_path.path_node[j];
+                        ass_ctg_num++;
+                    }
+                    if (struct_path.type == 0) {
+                        log_info("%d\n", struct_path.path_node[struct_path.node_num - 1]);
+                    } else {
+                        // log_info("%d (%c)\n", struct_path.path_node[struct_path.node_num - 1], (struct_path.path_utr[struct_path.node_num - 1] == 3 ? '-' : '+'));
+                        log_info("%d\n", struct_path.path_node[struct_path.node_num - 1]);
+                        if (ass_ctg_num >= ass_ctg_mall) {
+                            ass_ctg_mall += 100;
+                            ass_ctg_arr = realloc(ass_ctg_arr, ass_ctg_mall * sizeof(int));
+                        }
+                        ass_ctg_arr[ass_ctg_num] = struct_path.path_node[j];
+                        ass_ctg_num++;
                     }
-                    ass_ctg_arr[ass_ctg_num] = temp_mainseeds[0];
-                            ass_ctg_num++;
-
-                    pathScore struct_path;
-                    struct_path.type = 1;
-                    struct_path.path_len = ctgdepth[temp_mainseeds[0] - 1].len;
-                    struct_path.node_num = 1;
-                    struct_path.path_node = (int*) malloc(1 * sizeof(int));
-                    struct_path.path_node[0] = temp_mainseeds[0];
-                    struct_path.path_utr = (int*) malloc(1 * sizeof(int));
-                    struct_path.path_utr[0] = 5;
+                    log_info("———————————————————————————————————————\n");
+
                     ps_num++;
                     if (ps_num > 100) {
                         ps_struct = realloc(ps_struct, (ps_num + 1) * sizeof(pathScore));
                     }
                     ps_struct[ps_num - 1] = struct_path;
-
-                } else if (temp_main_num == 0 && temp_mainseeds_num == 0) {
-                    struc--;
                 }
 
-                // for (int j = 0; j < temp_main_num; j++) 
-                // {
-                //     free(temp_mainlinks[j].lutr);
-                //     free(temp_mainlinks[j].rutr);
-                //     free(temp_mainlinks[j].lctg);
-                //     free(temp_mainlinks[j].rctg);
-                // }
-                free(temp_mainlinks);
-                free(temp_mainseeds);
 
             } else {
-                log_message(ERROR, "Failed to find structure %d", i);
-                exit(EXIT_FAILURE);
+                log_info("———————————————————————————————————————\n");
+                log_info(" M-path  Length (bp)  Depth (x)  Score\n");
+                log_info("-------  -----------  ---------  ------\n");
+                log_info(" %-7s %-12ld %-10.2f %-5.2f\n", "L", ctgdepth[temp_mainseeds[0] - 1].len, ctgdepth[temp_mainseeds[0] - 1].depth, 100.00);
+                log_info("\n");
+                log_info("** %d (+)\n", temp_mainseeds[0]);
+                log_info("———————————————————————————————————————\n");
+                if (ass_ctg_num >= ass_ctg_mall) {
+                    ass_ctg_mall += 100;
+                    ass_ctg_arr = realloc(ass_ctg_arr, ass_ctg_mall * sizeof(int));
+                }
+                ass_ctg_arr[ass_ctg_num] = temp_mainseeds[0];
+                        ass_ctg_num++;
+
+                pathScore struct_path = job->path;
+                ps_num++;
+                if (ps_num > 100) {
+                    ps_struct = realloc(ps_struct, (ps_num + 1) * sizeof(pathScore));
+                }
+                ps_struct[ps_num - 1] = struct_path;
+
             }
+            ctggraph_free(job->graph);
+            free(job->mt_contigs);
         }
+        free(jobs);
+        free(job_struc);
+        ctgpack_free(flush_pack);
+        free_structures(&structures);
         for (i = 0; i < *num_bfslinks; i++)
         {
             if (findint(*mainseeds, *mainseeds_num, (*bfslinks)[i].lctgsmp) == 1 &&
@@ -1003,7 +802,8 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
         }
     }
 
-    khash_t(Ha_nodeseq)* h_nodeseq = kh_init(Ha_nodeseq);
+    int* pack_ctgs = malloc((*mainseeds_num + 1) * sizeof(int));
+    int pack_num = 0;
 
     if (*mainseeds_num > 0) {
         int numseeds = 0;
@@ -1016,7 +816,7 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
     
         /* Assign sequences to main seeds for mt */
         if (strcmp(organelles_type, "mt") == 0) {
-            orgAss(exe_path, all_fna, ctgdepth ,output, ass_ctg_arr, ass_ctg_num, "mt", taxo);
+            orgAss(exe_path, store, ctgdepth ,output, ass_ctg_arr, ass_ctg_num, "mt", taxo);
         }
         /* main graph */
         FILE* fpmaingfa = fopen(maingfa, "w");
@@ -1025,26 +825,15 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
             exit(EXIT_FAILURE);
         }
         
-        int ret;
-        khiter_t iter;
         for (i = 0; i < *mainseeds_num; i++) {
             int seed = (*mainseeds)[i];
             if (rm_flag == 1 && findint(interfering_ctg, interfering_ctg_num, seed) == 1) continue;
             int ctg_RC = ctgdepth[seed - 1].len * ctgdepth[seed - 1].depth;
 
-            for (j = 0; j < num_dynseeds; j++) {
-                if (seed == fnainfos[j].ctg) {
-                    fprintf(fpmaingfa, "S\t%d\t%s\tLN:i:%d\tRC:i:%d\n", seed, fnainfos[j].seq, ctgdepth[seed - 1].len, ctg_RC);
-                    iter = kh_get(Ha_nodeseq, h_nodeseq, seed);
-                    if (iter == kh_end(h_nodeseq)) {
-                        iter = kh_put(Ha_nodeseq, h_nodeseq, seed, &ret);
-                        if (ret == 0) {
-                            fprintf(stderr, "Failed to insert into hash table\n");
-                            exit(EXIT_FAILURE);
-                        }
-                        kh_value(h_nodeseq, iter) = strdup(fnainfos[j].seq);
-                    }
-                }
+            seq = ctgstore_seq(store, seed, &seq_len);
+            if (seq != NULL) {
+                fprintf(fpmaingfa, "S\t%d\t%.*s\tLN:i:%d\tRC:i:%d\n", seed, (int)seq_len, seq, ctgdepth[seed - 1].len, ctg_RC);
+                pack_ctgs[pack_num++] = seed;
             }
         }
         for (i = 0; i < main_num; i++) {
@@ -1069,10 +858,8 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
         log_message(WARNING, "No main seeds found.");
     }
     /* path to fasta */
-    size_t pathfa_out_len = snprintf(NULL, 0, "%s/PMAT_%s.fa", gfa_output, organelles_type) + 1;
-    char pathfa[pathfa_out_len];
-    snprintf(pathfa, pathfa_out_len, "%s/PMAT_%s.fa", gfa_output, organelles_type);
-    path2fa(ps_struct, ps_num, h_nodeseq, pathfa);
+    CtgPack* pack = ctgpack_build(store, pack_ctgs, pack_num);
+    path2fa(ps_struct, ps_num, pack, pathfa);
     /* free memory */
     // for (int i = 0; i < main_num; i++) {
     //     free(mainlinks[i].lutr);
@@ -1087,14 +874,9 @@ void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** b
     // }
     // free(ps_struct);
     
-    for (k = kh_begin(h_nodeseq); k != kh_end(h_nodeseq); ++k) {
-        if (kh_exist(h_nodeseq, k)) {
-            free(kh_value(h_nodeseq, k));
-        }
-    }
-    kh_destroy(Ha_nodeseq, h_nodeseq);
+    ctgpack_free(pack);
+    free(pack_ctgs);
     // free(mainlinks);
     // free(mainseeds);
     // free(gfa_output);
-    // free(fnainfos);
 }
\ No newline at end of file
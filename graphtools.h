@@ -29,6 +29,10 @@ SOFTWARE.
 #include <stdint.h>
 #include "hitseeds.h"
 #include "BFSseed.h"
+#include "ctgstore.h"
+#include "ntsearch.h"
+#include "ctggraph.h"
+#include "log.h"
 #include "khash.h"
 
 
@@ -53,39 +57,69 @@ typedef struct {
     int num_nodes;
 } BFSstructure;
 
-KHASH_MAP_INIT_INT(Ha_structures, BFSstructure*)
-KHASH_MAP_INIT_INT(Ha_nodeseq, char*)
-
+/* 
+ * budgets of the M-path searches of one run, 0 for none, and where the first unfinished search flushes the 
+ * best path it has found so far, after the paths of the structures before it; no flushing without pack
+ */
+typedef struct {
+    double deadline;            /* realtime() the searches stop at */
+    uint64_t max_expansions;    /* states one search may expand */
+    int beam_width;             /* paths kept at each step of the search of a large structure */
+    const CtgPack* pack;
+    const char* output;
+} pathLimits;
+
+/* the M-path search of one structure; a job with search 0 is a single contig, whose path is given */
+typedef struct {
+    int search;
+    CtgGraph* graph;
+    int* mt_contigs;
+    int mt_num;
+    int ctg_s, utr_s, utr_e;    /* paths leave ctg_s by utr_s and close arriving by utr_e */
+    int flag_err;
+    float mt_ratio;
+    pathScore path;
+    logBuffer log;              /* messages of the search, held back while others run */
+} pathJob;
+
+/* connected structures; each structure points into the shared links and node arrays */
 typedef struct {
-    int ctg;
-    char *seq;
-} fnainfo;
+    BFSstructure* structure;
+    uint32_t num;
+    BFSlinks* links;
+    int* node;
+} BFSstructures;
 
 /* addseq: add sequence to the fna */
-void addseq(const char* allgraph, const char* all_fna, CtgDepth* ctgdepth);
+void addseq(const char* allgraph, const char* all_fna, CtgDepth* ctgdepth, int num_ctg);
+
+/* trim_circular: drop the repeated junction of circular contigs from the store, once for every later use */
+void trim_circular(CtgStore* store, CtgDepth* ctgdepth, int num_ctg, int num_threads);
 
 /* raw gfa && main gfa */
 void optgfa(const char* exe_path, int num_dynseeds, int** dynseeds, BFSlinks** bfslinks, int* num_bfslinks, 
-            CtgDepth* ctgdepth, const char* output, const char* all_fna, const char* allgraph, 
+            CtgDepth* ctgdepth, const char* output, const char* all_fna, const CtgStore* store, const char* allgraph, 
             const char* organelles_type, int* mainseeds_num, int** mainseeds, int interfering_ctg_num, 
-            int* interfering_ctg, int taxo, float filter_depth, char* cutseq);
+            int* interfering_ctg, int taxo, float filter_depth, const NtIndex* reads_idx, int num_threads, 
+            double path_time_limit, uint64_t path_max_expansions, int path_beam_width);
 
 /* findSpath: find the shortest path between two contigs */
 void findSpath(int node1, int node1utr, int node2, int node2utr, 
-              int main_num, BFSlinks* mainlinks, CtgDepth *ctg_depth);
+              const CtgGraph* graph, CtgDepth *ctg_depth);
 
 /* BFS_structure: find the BFS structure of the graph */
-uint32_t bfs_structure(int node_num, int link_num, BFSlinks* links, int* node_arry, khash_t(Ha_structures)* h_structures);
+uint32_t bfs_structure(int node_num, int link_num, BFSlinks* links, int* node_arry, BFSstructures* structures);
+void free_structures(BFSstructures* structures);
 
-/* findMpath: find the most likely path between two contigs */
-void findMpath(int node1, int node1utr, int node2, int node2utr, int main_num, BFSlinks* mainlinks, CtgDepth *ctg_depth, 
-    int* mt_contigs, int mt_num, int* pt_contigs, int pt_num, int* flag_err, float* mt_ratio, int taxo, pathScore *struc_path);
+/* findMpaths: find the most likely path of every structure, all searched on one pool of num_threads threads */
+void findMpaths(pathJob* jobs, int num_jobs, CtgDepth* ctg_depth, int* pt_contigs, int pt_num, int taxo, int num_threads, 
+    const pathLimits* limits);
 
 /* copy BFSlinks */
 void copy_BFSlinks(BFSlinks* dest, const BFSlinks* src);
 // void free_BFSlinks(BFSlinks *links, int num_links);
 
 /* convert path to fasta */
-void path2fa(pathScore *path, int ps_num, khash_t(Ha_nodeseq)* node_seq, const char *output);
+void path2fa(pathScore *path, int ps_num, const CtgPack* pack, const char *output);
 
 #endif
\ No newline at end of file
@@ -35,11 +35,10 @@ SOFTWARE.
 #include "log.h"
 #include "misc.h"
 #include "hitseeds.h"
+#include "ntsearch.h"
 #include "khash.h"
 
 
-static void run_blastn(const char *all_contigs, const char *db_path, char *blastn_out, int num_threads, int *num_hits);
-void mrun_blastn(const char *all_contigs, const char *db_path, char *final_out, int num_threads, int *num_hits);
 int compare_ctg_scores(const void *a, const void *b);
 
 
@@ -71,7 +70,7 @@ static float calc_score_fungi(float depth, int len, int num_genes) {
     return norm_score * num_genes * num_genes;
 }
 
-void HitSeeds(const char* exe_path, const char* organelles_type, const char* all_contigs,
+void HitSeeds(const char* exe_path, const char* organelles_type, const CtgStore* store,
              const char* output_path, int num_threads, int num_ctgs, CtgDepth *ctg_depth, 
              int** candidate_seeds, int* ctg_threshold, float filter_depth,
              int taxo, int verbose) {
@@ -119,31 +118,26 @@ void HitSeeds(const char* exe_path, const char* organelles_type, const char* all
     char* blastn_out = (char*)malloc(sizeof(*blastn_out) * (snprintf(NULL, 0, "%s/PMAT_mt_blastn.txt", output_path) + 1));
     sprintf(blastn_out, "%s/PMAT_mt_blastn.txt", output_path);
     
-    /* Run blastn */
+    /* Search conserved genes */
     int num_hits = 0;
-    mrun_blastn(all_contigs, db_path, blastn_out, num_threads, &num_hits); //* 
+    BlastDircMatch* matches = mrun_search(store, db_path, blastn_out, num_threads, &num_hits);
+    free(db_path);
+    free(blastn_out);
     
     khash_t(ctg_genes) *h_ctg_genes = kh_init(ctg_genes);
-    
-    FILE *blastn_file = fopen(blastn_out, "r");
-    if (!blastn_file) {
-        log_message(ERROR, "Failed to open file %s", blastn_out);
-        exit(EXIT_FAILURE);
-    }
 
-    char *line = NULL;
-    size_t len = 0;
     int best_ctg = 0;
     int best_gnum = 0;
+    int m_idx;
 
-    while (getline(&line, &len, blastn_file) != -1) {
+    for (m_idx = 0; m_idx < num_hits; m_idx++) {
         char query[256];
-        char gene[256];
-        float identity;
-        int align_len;
+        const char* gene = matches[m_idx].gene_id;
+        float identity = matches[m_idx].identity;
+        int align_len = matches[m_idx].align_len;
         int gene_idx = -1;
         
-        sscanf(line, "%s\t%s\t%f\t%d", query, gene, &identity, &align_len);
+        snprintf(query, sizeof(query), "%s", matches[m_idx].query_id);
         int ctg_id = rm_contig(query);
 
         for (i = 0; i < mtpcg_num; i++) {
@@ -206,8 +200,7 @@ void HitSeeds(const char* exe_path, const char* organelles_type, const char* all
         default:
             log_message(ERROR, "Invalid taxo type: %d", taxo);
             kh_destroy(ctg_genes, h_ctg_genes);
-            if(line) free(line);
-            if(blastn_file) fclose(blastn_file);
+            free_matches(matches, num_hits);
             return;
     }
 
@@ -284,11 +277,12 @@ void HitSeeds(const char* exe_path, const char* organelles_type, const char* all
     }
     kh_destroy(ctg_genes, h_ctg_genes);
     
-    free(sort_pcg_ctgs); free(line); fclose(blastn_file);
+    free(sort_pcg_ctgs);
+    free_matches(matches, num_hits);
 }
 
 
-void PtHitseeds(const char* exe_path, const char* organelles_type, const char* all_contigs, 
+void PtHitseeds(const char* exe_path, const char* organelles_type, const CtgStore* store, 
              const char* output_path, int num_threads, int num_ctgs, CtgDepth *ctg_depth, int* candidate_seeds, int ctg_threshold, float filter_depth, int verbose) {
 
     log_message(INFO, "Finding Pt seeds...");
@@ -299,53 +293,25 @@ void PtHitseeds(const char* exe_path, const char* organelles_type, const char* a
 
     mkdirfiles(output_path);
 
-    char* blastn_out = (char*)malloc(sizeof(*blastn_out) * (snprintf(NULL, 0, "%s/PMAT_pt_blastn.txt", output_path) + 1));
-    sprintf(blastn_out, "%s/PMAT_pt_blastn.txt", output_path);
-    
-    /* Run blastn */
+    /* Best hit of each contig */
     int num_hits = 0;
-    run_blastn(all_contigs, db_path, blastn_out, num_threads, &num_hits); //*
-    FILE *blastn_file = fopen(blastn_out, "r");
-    if (!blastn_file) {
-        log_message(ERROR, "Failed to open file %s", blastn_out);
-        exit(EXIT_FAILURE);
-    }
-    /* PCG; Contig; identity; length */
-    BlastInfo *blast_info = calloc(num_hits, sizeof(BlastInfo));
-    int blast_idx = 0;
-
-    if (!blast_info) {
-        log_message(ERROR, "Failed to allocate memory for BlastInfo");
-        exit(EXIT_FAILURE);
-    }
+    NtIndex* nt_idx = ntindex_load(db_path);
+    BlastDircMatch* matches = ntsearch(nt_idx, store, num_threads, 1, &num_hits);
+    ntindex_free(nt_idx);
+    free(db_path);
 
     /* PCGs; Contigs; Score */
     SortPcgCtgs *ptpcg_ctgs = NULL;
-    size_t blt_len;
     uint64_t i;
-    char *blt_line = NULL;
+    int m_idx;
     
     int seeds_ctg = 0;
-    /* Find the best hit for each PCG */
-    while ((blt_len = getline(&blt_line, &blt_len, blastn_file)) != -1) {
-        char* organgene;
-        char* tempctg;
-        int inttempctg;
-        float tempiden;
-        int templen;
-        if (blt_line[0] == '#') {
-            continue;
-        } else {
-            char* token = strtok(blt_line, "\t");
-            tempctg = strdup(token);
-            inttempctg = rm_contig(tempctg);
-            token = strtok(NULL, "\t");
-            organgene = strdup(token);
-            token = strtok(NULL, "\t");
-            tempiden = atof(token);
-            token = strtok(NULL, "\t");
-            templen = atoi(token);
-        }
+    for (m_idx = 0; m_idx < num_hits; m_idx++) {
+        char tempctg[256];
+        snprintf(tempctg, sizeof(tempctg), "%s", matches[m_idx].query_id);
+        int inttempctg = rm_contig(tempctg);
+        float tempiden = matches[m_idx].identity;
+        int templen = matches[m_idx].align_len;
 
         // int tem_flag = 0;
         int tempctg_int = rm_contig(tempctg);
@@ -393,9 +359,7 @@ void PtHitseeds(const char* exe_path, const char* organelles_type, const char* a
     }
 
     free(ptpcg_ctgs);
-    free(blt_line);
-    fclose(blastn_file);
-    free(blast_info);
+    free_matches(matches, num_hits);
 }
 
 
@@ -409,43 +373,6 @@ int compare_ctg_scores(const void *a, const void *b) {
     return 0;
 }
 
-static void run_blastn(const char *all_contigs, const char *db_path, char *blastn_out, int num_threads, int *num_hits) {
-    size_t comond_len = snprintf(NULL, 0, "blastn -db %s -query %s -outfmt 6 -num_threads %d -num_alignments 1 -max_hsps 1 > %s", 
-                                db_path, all_contigs, num_threads, blastn_out) + 1;
-    char* command = malloc(comond_len);
-    snprintf(command, comond_len, "blastn -db %s -query %s -outfmt 6 -num_threads %d -num_alignments 1 -max_hsps 1 > %s", db_path, all_contigs, num_threads, blastn_out);
-
-    execute_command(command, 0, 0);
-
-    if (access(blastn_out, F_OK) != 0) {
-        log_message(ERROR, "Failed to run blastn");
-        free(command);
-        return;
-    }
-
-    free(command);
-
-    size_t line_len;
-    char *line = NULL;
-    FILE *blastn_file = fopen(blastn_out, "r");
-    if (!blastn_file) {
-        log_message(ERROR, "Failed to open file %s", blastn_out);
-        return;
-    }
-
-    while ((line_len = getline(&line, &line_len, blastn_file)) != -1) {
-        if (line[0] == '#') {
-            continue;
-        } else {
-            (*num_hits) += 1;
-        }
-    }
-
-    fclose(blastn_file);
-    free(line);
-}
-
-
 static int compare_blast_dirc_matches(const void* a, const void* b) {
     const BlastDircMatch* ma = (const BlastDircMatch*)a;
     const BlastDircMatch* mb = (const BlastDircMatch*)b;
@@ -529,86 +456,34 @@ static void filter_same_gene_matches(BlastDircMatch* matches, int* match_count)
 
 
 
-void mrun_blastn(const char *all_contigs, const char *db_path, char *final_out, int num_threads, int *num_hits) {
-    char* temp_out = (char*)malloc(sizeof(*temp_out) * (snprintf(NULL, 0, "%s.temp", final_out) + 1));
-    sprintf(temp_out, "%s.temp", final_out);
-
-    uint64_t i;
-    char* command = (char*)malloc(sizeof(*command) * (snprintf(NULL, 0, "blastn -db %s -query %s -outfmt 6 -num_threads %d > %s",
-                                db_path, all_contigs, num_threads, temp_out) + 1));
-    sprintf(command, "blastn -db %s -query %s -outfmt 6 -num_threads %d > %s",
-            db_path, all_contigs, num_threads, temp_out);
-    execute_command(command, 0, 0);
-    free(command);
-
-    struct stat st;
-    stat(temp_out, &st);
-    if (st.st_size == 0) {
-        FILE *final_fp = fopen(final_out, "w");
-        if(final_fp) fclose(final_fp);
-        remove(temp_out);
-        *num_hits = 0;
-        // log_message(WARNING, "No BLAST hits found");
-        return;
-    }
-
-    FILE *temp_fp = fopen(temp_out, "r");
-    if (!temp_fp) {
-        log_message(ERROR, "Failed to open temp blast output file");
-        remove(temp_out);
-        return;
-    }
-
-    int total_matches = 0;
-    char line[1024];
-    while(fgets(line, sizeof(line), temp_fp)) {
-        total_matches++;
+void free_matches(BlastDircMatch* matches, int num_matches) {
+    int i;
+    for (i = 0; i < num_matches; i++) {
+        free(matches[i].query_id);
+        free(matches[i].gene_id);
     }
+    free(matches);
+}
 
-    rewind(temp_fp);
+BlastDircMatch* mrun_search(const CtgStore* store, const char *db_path, const char *final_out, int num_threads, int *num_hits) {
 
-    BlastDircMatch* matches = (BlastDircMatch*)malloc(sizeof(BlastDircMatch) * total_matches);
+    uint64_t i;
     int match_count = 0;
+    NtIndex* nt_idx = ntindex_load(db_path);
+    BlastDircMatch* matches = ntsearch(nt_idx, store, num_threads, 0, &match_count);
+    ntindex_free(nt_idx);
 
-    while (fgets(line, sizeof(line), temp_fp)) {
-        if(strlen(line) < 10) continue;
-
-        BlastDircMatch *match = &matches[match_count];
-        char gene_full[256];
-        
-        if(sscanf(line, "%ms\t%[^\t]\t%f\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f",
-            &match->query_id,
-            gene_full,
-            &match->identity,
-            &match->align_len,
-            &match->mismatch,
-            &match->gap,
-            &match->qstart,
-            &match->qend,
-            &match->sstart,
-            &match->send,
-            &match->evalue,
-            &match->score) != 12) {
-            continue;
-        }
-
-        char *last_underscore = strrchr(gene_full, '_');
+    for (i = 0; i < match_count; i++) {
+        BlastDircMatch *match = &matches[i];
+        char *last_underscore = strrchr(match->gene_id, '_');
         if (last_underscore != NULL) {
-            match->gene_id = strdup(last_underscore + 1);
-        } else {
-            match->gene_id = strdup(gene_full);
+            memmove(match->gene_id, last_underscore + 1, strlen(last_underscore + 1) + 1);
         }
-
         if (match->sstart > match->send) {
             int temp = match->sstart;
             match->sstart = match->send;
             match->send = temp;
-            match->direction = 2;
-        } else {
-            match->direction = 1;
         }
-        
-        match_count++;
     }
 
     /* Sort the matches by query id, gene id, and start position */
@@ -640,14 +515,6 @@ void mrun_blastn(const char *all_contigs, const char *db_path, char *final_out,
         fclose(dirc_fp);
     }
 
-    for (i = 0; i < match_count; i++) {
-        free(matches[i].query_id);
-        free(matches[i].gene_id);
-    }
-    free(matches);
-    
-    fclose(temp_fp);
-    remove(temp_out);
-
     *num_hits = match_count;
-}
\ No newline at end of file
+    return matches;
+}
@@ -28,6 +28,7 @@ SOFTWARE.
 #define HITSEEDS_H
 
 #include "khash.h"
+#include "ctgstore.h"
 
 
 typedef struct {
@@ -117,14 +118,16 @@ static const int anl_mtpcg_num = 13;
 
 KHASH_MAP_INIT_INT(ctg_genes, ContigGenes*)
 
-/* find the candidate seeds for the given contigs */
-void mrun_blastn(const char *all_contigs, const char *db_path, char *final_out, int num_threads, int *num_hits);
+/* conserved gene hits of all contigs (overlapping hits of a gene filtered), also written to final_out */
+BlastDircMatch* mrun_search(const CtgStore* store, const char *db_path, const char *final_out, int num_threads, int *num_hits);
+void free_matches(BlastDircMatch* matches, int num_matches);
 
-void PtHitseeds(const char* exe_path, const char* organelles_type, const char* all_contigs, 
+/* find the candidate seeds for the given contigs */
+void PtHitseeds(const char* exe_path, const char* organelles_type, const CtgStore* store, 
              const char* output_path, int num_threads, int num_ctgs, CtgDepth *ctg_depth, 
              int* candidate_seeds, int ctg_threshold, float filter_depth, int verbose); 
 
-void HitSeeds(const char* exe_path, const char* organelles_type, const char* all_contigs, 
+void HitSeeds(const char* exe_path, const char* organelles_type, const CtgStore* store, 
             const char* output_path, int num_threads, int num_ctgs, CtgDepth *ctg_depth, 
             int** candidate_seeds, int* ctg_threshold, float filter_depth, int taxo, int verbose);
 
@@ -25,6 +25,7 @@ SOFTWARE.
 
 
 #include <stdarg.h>
+#include <stdlib.h>
 #include <time.h>
 #include "log.h"
 
@@ -32,6 +33,9 @@ SOFTWARE.
 
 FILE* log_output_stream = NULL;
 
+/* where the messages of this thread are kept, NULL while they go to the log */
+static __thread logBuffer* log_buffer = NULL;
+
 static const char *log_level_strings[] = {
     "INFO",
     "WARNING",
@@ -42,6 +46,48 @@ void set_log_output(FILE* stream) {
     log_output_stream = stream;
 }
 
+void log_capture(logBuffer* buf) {
+    log_buffer = buf;
+}
+
+static void buffer_append(logBuffer* buf, const char* fmt, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int n = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    if (n < 0) return;
+    if (buf->len + n + 1 > buf->cap) {
+        buf->cap = 2 * (buf->len + n + 1);
+        buf->s = realloc(buf->s, buf->cap);
+        if (buf->s == NULL) {
+            fprintf(stderr, "Failed to allocate memory for the log\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    vsnprintf(buf->s + buf->len, n + 1, fmt, args);
+    buf->len += n;
+}
+
+static void buffer_printf(logBuffer* buf, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    buffer_append(buf, fmt, args);
+    va_end(args);
+}
+
+void log_release(logBuffer* buf) {
+    if (log_output_stream == NULL) {
+        log_output_stream = stdout;
+    }
+    if (buf->len > 0) {
+        fwrite(buf->s, 1, buf->len, log_output_stream);
+        fflush(log_output_stream);
+    }
+    free(buf->s);
+    buf->s = NULL;
+    buf->len = buf->cap = 0;
+}
+
 void log_section_header(const char* message) {
     printf("** %s \n", message);
 }
@@ -53,6 +99,11 @@ void log_section_tail(const char* message) {
 void log_info(const char* format, ...) {
     va_list args;
     va_start(args, format);
+    if (log_buffer != NULL) {
+        buffer_append(log_buffer, format, args);
+        va_end(args);
+        return;
+    }
     if (log_output_stream == NULL) {
         log_output_stream = stdout;
     }
@@ -85,6 +136,10 @@ void log_message(int level, const char *fmt, ...) {
     vsnprintf(message, sizeof(message), fmt, args);
     va_end(args);
 
+    if (log_buffer != NULL) {
+        buffer_printf(log_buffer, "[%s] %s: %s\n", time_buffer, log_level_strings[level], message);
+        return;
+    }
     fprintf(log_output_stream, "[%s] %s: %s\n", time_buffer, log_level_strings[level], message);
     fflush(log_output_stream);
 }
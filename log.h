@@ -35,11 +35,21 @@ SOFTWARE.
 
 extern FILE* log_output_stream;
 
+/* messages held back from the log, to be written out in an order other than the one they came in */
+typedef struct {
+    char* s;
+    size_t len, cap;
+} logBuffer;
+
 void log_section_header(const char* message);
 void log_section_tail(const char* message);
 void log_info(const char* fmt, ...);
 void log_message(int level, const char* fmt, ...);
 void set_log_output(FILE* stream);
+/* keep the messages of the calling thread in buf until log_capture(NULL) */
+void log_capture(logBuffer* buf);
+/* write out and free the messages kept in buf */
+void log_release(logBuffer* buf);
 
 #endif // LOG_H
 
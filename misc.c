@@ -164,6 +164,12 @@ void sleep_ms(long milliseconds) {
     nanosleep(&req, NULL);
 }
 
+double realtime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
 void removeUnique(int arr[], int *size) {
     if (*size <= 1) return;
     uint64_t i, j;
@@ -50,6 +50,7 @@ char* pmat_path(const char *input);             /* return path of PMAT2 */
 int is_numeric(const char *str);                /* check if string is numeric */ 
 
 void sleep_ms(long milliseconds);
+double realtime(void);                          /* seconds on a monotonic clock */
 
 void mkdirfiles(const char *dir_path);          /* create directory and all intermediate directories if not exist */
 int delete_directory(const char *path);         /* delete directory recursively */
@@ -0,0 +1,1376 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 Hanfc <h2624366594@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <zlib.h>
+#include <fcntl.h>      // open
+#include <unistd.h>     // close
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // stat
+
+#include "ntsearch.h"
+#include "kseq.h"
+#include "ksort.h"
+#include "kthread.h"
+#include "misc.h"
+#include "log.h"
+
+KSEQ_INIT(gzFile, gzread)
+
+extern unsigned char seq_nt4_table[256];
+
+#define NT_K 15             /* minimizer k-mer size */
+#define NT_GENE_W 10        /* minimizer window of the gene databases */
+#define NT_READ_W 20        /* minimizer window of the read index */
+#define NT_MAX_W 32
+#define NT_MAX_OCC 1000     /* skip minimizers occurring more often in the database */
+#define NT_READ_MAX_OCC 10000
+#define NT_BUCKET_BITS 18   /* minimizer hashes are looked up in 2^18 buckets */
+#define NT_READ_BLOCK 4096  /* reads sketched per job */
+#define NT_READ_PART_BITS 6  /* read minimizers are spilled to 2^6 files by their top hash bits, then sorted one file at a time */
+#define NT_SPILL_BUF 4096
+#define NT_MAX_GAP 5000     /* max distance between chained anchors */
+#define NT_CHAIN_BW 500     /* max diagonal drift between chained anchors */
+#define NT_CHAIN_SKIP 50    /* predecessors tried per anchor */
+#define NT_MIN_CHAIN 40     /* min chaining score */
+#define NT_MAX_CHAINS 32    /* chains kept per subject and strand */
+#define NT_EXT_LEN 2000     /* max extension at each chain end */
+#define NT_EXT_BAND 50
+#define NT_GAP_BAND 16
+#define NT_MAX_EVALUE 10.0
+#define NT_OVL_SEED 32      /* exact seed at the contig start, one 64-bit k-mer */
+#define NT_OVL_MIN 50       /* min end overlap of a circular contig */
+#define NT_OVL_MAX 20000
+#define NT_OVL_CAND 16      /* seed hits verified per contig */
+
+/* 
+ * megablast scoring, the blastn default task: reward 1, penalty -2 and linear 
+ * gaps of reward / 2 - penalty = 2.5 per base, kept in half units so that the 
+ * DP stays integral; raw scores are halved before the Karlin-Altschul statistics
+ */
+#define NT_MATCH 2
+#define NT_MISMATCH 4
+#define NT_GAPO 0
+#define NT_GAPE 5
+#define NT_SCORE_SCALE 2
+#define NT_ZDROP 100
+#define NT_LAMBDA 1.28
+#define NT_KA 0.46
+
+#define NT_NEG_INF (-0x20000000)
+
+static const char NT_IDX_MAGIC[8] = {'P', 'M', 'A', 'T', 'M', 'Z', 'I', '2'};
+
+typedef struct {
+    uint64_t h;
+    uint64_t v;
+} MzPair;
+
+typedef struct {
+    uint64_t x;             /* sid << 33 | strand << 32 | query end position */
+    uint64_t y;             /* subject end position */
+} Anchor;
+
+#define anchor_lt(a, b) ((a).x < (b).x || ((a).x == (b).x && (a).y < (b).y))
+KSORT_INIT(anchor, Anchor, anchor_lt)
+KSORT_INIT_GENERIC(uint64_t)
+
+typedef struct {
+    int score;
+    int match;
+    int mismatch;
+    int gapo;
+    int gap_col;
+} AlnStat;
+
+/* per-thread buffers */
+typedef struct {
+    MzPair* mz;
+    size_t mz_n, mz_m;
+    Anchor* a;
+    size_t a_n, a_m;
+    int32_t* f;
+    int32_t* p;
+    uint8_t* used;
+    uint64_t* order;
+    Anchor* chain;
+    size_t chain_m;
+    int chain_beg[NT_MAX_CHAINS];
+    int chain_len[NT_MAX_CHAINS];
+    uint8_t* qfwd;
+    uint8_t* qrev;
+    size_t q_m;
+    uint8_t* sbuf;
+    size_t s_m;
+    uint8_t* tq;
+    uint8_t* ts;
+    size_t t_m;
+    int32_t* dp;
+    size_t dp_m;
+    uint8_t* tb;
+    size_t tb_m;
+} NtBuf;
+
+typedef struct {
+    BlastDircMatch* m;
+    int n;
+    int cap;
+} NtHits;
+
+typedef struct {
+    const NtIndex* idx;
+    const CtgStore* store;
+    int best_only;
+    NtBuf* buf;
+    NtHits* hits;
+} NtSearchData;
+
+typedef struct {
+    const NtIndex* idx;
+    char** seqs;
+    int span_beg;
+    int span_end;
+    float min_iden;
+    int max_count;
+    NtBuf* buf;
+    int* counts;
+} NtSpanData;
+
+typedef struct {
+    const NtIndex* idx;
+    long first;             /* first block of the batch */
+    uint8_t** code;         /* per-thread encoded read */
+    size_t* code_m;
+    MzPair** mz;            /* per-block minimizers of the batch */
+    size_t* mz_n;
+    size_t* mz_m;
+} NtSketchData;
+
+
+static inline uint64_t hash64(uint64_t key, uint64_t mask) {
+    key = (~key + (key << 21)) & mask;
+    key = key ^ key >> 24;
+    key = ((key + (key << 3)) + (key << 8)) & mask;
+    key = key ^ key >> 14;
+    key = ((key + (key << 2)) + (key << 4)) & mask;
+    key = key ^ key >> 28;
+    key = (key + (key << 31)) & mask;
+    return key;
+}
+
+/* (w,k)-minimizers of a 2-bit encoded sequence: h = hash, v = end position << 1 | strand */
+static void mz_sketch(const uint8_t* seq, uint32_t len, int w, uint64_t tag, MzPair** mz, size_t* n, size_t* m) {
+    uint64_t shift = 2 * (NT_K - 1), mask = (1ULL << 2 * NT_K) - 1;
+    uint64_t kmer[2] = {0, 0};
+    uint64_t win_h[NT_MAX_W];
+    uint64_t win_v[NT_MAX_W];
+    uint64_t min_h = UINT64_MAX, min_v = 0, last_v = UINT64_MAX;
+    uint32_t i, l = 0;
+    int j, b = 0, min_b = 0;
+
+    for (j = 0; j < w; j++) win_h[j] = UINT64_MAX;
+    for (i = 0; i < len; i++) {
+        int c = seq[i];
+        uint64_t h = UINT64_MAX, v = 0;
+        if (c < 4) {
+            kmer[0] = (kmer[0] << 2 | c) & mask;
+            kmer[1] = kmer[1] >> 2 | (uint64_t)(3 - c) << shift;
+            if (++l >= NT_K && kmer[0] != kmer[1]) {
+                int z = kmer[0] < kmer[1] ? 0 : 1;
+                h = hash64(kmer[z], mask);
+                v = (uint64_t)i << 1 | z;
+            }
+        } else {
+            l = 0;
+        }
+        win_h[b] = h;
+        win_v[b] = v;
+        if (h <= min_h) {
+            /* the new k-mer is the window minimum (rightmost on ties) */
+            min_h = h; min_v = v; min_b = b;
+        } else if (b == min_b) {
+            /* the minimum left the window, rescan from the oldest k-mer */
+            min_h = UINT64_MAX;
+            for (j = 1; j <= w; j++) {
+                int t = (b + j) % w;
+                if (win_h[t] <= min_h) {
+                    min_h = win_h[t]; min_v = win_v[t]; min_b = t;
+                }
+            }
+        }
+        if (++b == w) b = 0;
+        if (i + 1 >= NT_K + w - 1 && min_h != UINT64_MAX && min_v != last_v) {
+            if (*n == *m) {
+                *m = *m ? *m << 1 : 256;
+                *mz = realloc(*mz, *m * sizeof(MzPair));
+            }
+            (*mz)[*n].h = min_h;
+            (*mz)[*n].v = tag | min_v;
+            (*n)++;
+            last_v = min_v;
+        }
+    }
+}
+
+/* one stable counting pass on 15 bits of h, from the runs src[0 .. num_src) in turn into dst */
+static void mz_radix_pass(MzPair* const* src, const size_t* src_n, long num_src, MzPair* dst, int shift) {
+    size_t* cnt = calloc(32768, sizeof(size_t));
+    if (cnt == NULL) {
+        log_message(ERROR, "Failed to allocate memory for the minimizer index");
+        exit(EXIT_FAILURE);
+    }
+    long r;
+    size_t i, sum = 0;
+    for (r = 0; r < num_src; r++) {
+        for (i = 0; i < src_n[r]; i++) cnt[src[r][i].h >> shift & 0x7fff]++;
+    }
+    for (i = 0; i < 32768; i++) {
+        size_t c = cnt[i];
+        cnt[i] = sum;
+        sum += c;
+    }
+    for (r = 0; r < num_src; r++) {
+        for (i = 0; i < src_n[r]; i++) dst[cnt[src[r][i].h >> shift & 0x7fff]++] = src[r][i];
+    }
+    free(cnt);
+}
+
+/* stable LSD radix sort on h (2k = 30 bits), 15 bits per pass */
+static void mz_radix_sort(MzPair* a, size_t n) {
+    MzPair* tmp = malloc((n > 0 ? n : 1) * sizeof(MzPair));
+    if (tmp == NULL) {
+        log_message(ERROR, "Failed to allocate memory for the minimizer index");
+        exit(EXIT_FAILURE);
+    }
+    mz_radix_pass(&a, &n, 1, tmp, 0);
+    mz_radix_pass(&tmp, &n, 1, a, 15);
+    free(tmp);
+}
+
+static void add_subject(NtIndex* idx, const char* name, uint64_t* seq_m) {
+    idx->name = realloc(idx->name, (idx->num_seqs + 1) * sizeof(char*));
+    idx->len = realloc(idx->len, (idx->num_seqs + 1) * sizeof(uint32_t));
+    idx->offset = realloc(idx->offset, (idx->num_seqs + 1) * sizeof(uint64_t));
+    idx->name[idx->num_seqs] = strdup(name);
+    idx->len[idx->num_seqs] = 0;
+    idx->offset[idx->num_seqs] = idx->total_len;
+    idx->num_seqs++;
+}
+
+static void grow_seq(NtIndex* idx, uint64_t* seq_m, uint64_t add) {
+    if (idx->total_len + add > *seq_m) {
+        while (idx->total_len + add > *seq_m) *seq_m = *seq_m ? *seq_m << 1 : 1 << 20;
+        idx->seq = realloc(idx->seq, *seq_m);
+        if (idx->seq == NULL) {
+            log_message(ERROR, "Failed to allocate memory for the gene database");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void load_fasta(NtIndex* idx, const char* db_path) {
+    gzFile fp = gzopen(db_path, "r");
+    if (fp == NULL) {
+        log_message(ERROR, "Failed to open %s", db_path);
+        exit(EXIT_FAILURE);
+    }
+    kseq_t* ks = kseq_init(fp);
+    uint64_t seq_m = 0;
+    uint64_t i;
+    while (kseq_read(ks) >= 0) {
+        add_subject(idx, ks->name.s, &seq_m);
+        grow_seq(idx, &seq_m, ks->seq.l);
+        for (i = 0; i < ks->seq.l; i++) {
+            idx->seq[idx->total_len + i] = seq_nt4_table[(uint8_t)ks->seq.s[i]];
+        }
+        idx->len[idx->num_seqs - 1] = ks->seq.l;
+        idx->total_len += ks->seq.l;
+    }
+    kseq_destroy(ks);
+    gzclose(fp);
+}
+
+static uint8_t* read_whole(const char* path, size_t* size) {
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        log_message(ERROR, "Failed to open %s", path);
+        exit(EXIT_FAILURE);
+    }
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    rewind(fp);
+    uint8_t* data = malloc(*size + 1);
+    if (data == NULL || fread(data, 1, *size, fp) != *size) {
+        log_message(ERROR, "Failed to read %s", path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(fp);
+    return data;
+}
+
+static inline uint32_t be32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+/* BLAST nucleotide database volume, format version 4 or 5 */
+static void load_blastdb(NtIndex* idx, const char* db_path) {
+    size_t path_len = strlen(db_path) + 5;
+    char nin_path[path_len], nhr_path[path_len], nsq_path[path_len];
+    snprintf(nin_path, path_len, "%s.nin", db_path);
+    snprintf(nhr_path, path_len, "%s.nhr", db_path);
+    snprintf(nsq_path, path_len, "%s.nsq", db_path);
+
+    size_t nin_size, nhr_size, nsq_size;
+    uint8_t* nin = read_whole(nin_path, &nin_size);
+    uint8_t* nhr = read_whole(nhr_path, &nhr_size);
+    uint8_t* nsq = read_whole(nsq_path, &nsq_size);
+
+    size_t p = 0;
+    uint32_t version = be32(nin + p); p += 4;
+    uint32_t dbtype = be32(nin + p); p += 4;
+    if ((version != 4 && version != 5) || dbtype != 0) {
+        log_message(ERROR, "Unsupported BLAST database %s (version %u, type %u)", db_path, version, dbtype);
+        exit(EXIT_FAILURE);
+    }
+    if (version == 5) p += 4;                   /* volume */
+    p += 4 + be32(nin + p);                     /* title */
+    if (version == 5) p += 4 + be32(nin + p);   /* lmdb file */
+    p += 4 + be32(nin + p);                     /* date */
+    uint32_t num_oids = be32(nin + p); p += 4;
+    p += 8 + 4;                                 /* total length, max length */
+    if (p + 3 * 4 * (size_t)(num_oids + 1) > nin_size) {
+        log_message(ERROR, "Truncated BLAST database index %s", nin_path);
+        exit(EXIT_FAILURE);
+    }
+    const uint8_t* hdr_off = nin + p;
+    const uint8_t* seq_off = hdr_off + 4 * (num_oids + 1);
+    const uint8_t* amb_off = seq_off + 4 * (num_oids + 1);
+
+    static const uint8_t nt_code[4] = {0, 1, 2, 3};
+    uint64_t seq_m = 0;
+    uint32_t i, j;
+    for (i = 0; i < num_oids; i++) {
+        /* title: the first VisibleString of the Blast-def-line-set */
+        uint32_t hb = be32(hdr_off + 4 * i), he = be32(hdr_off + 4 * (i + 1));
+        char name[4096] = "";
+        for (j = hb; j + 1 < he && j < hb + 32; j++) {
+            if (nhr[j] != 0x1a) continue;
+            uint32_t tlen = nhr[j + 1], tpos = j + 2;
+            if (tlen & 0x80) {
+                int nb = tlen & 0x7f, b;
+                tlen = 0;
+                for (b = 0; b < nb; b++) tlen = tlen << 8 | nhr[tpos++];
+            }
+            if (tlen >= sizeof(name)) tlen = sizeof(name) - 1;
+            memcpy(name, nhr + tpos, tlen);
+            name[tlen] = '\0';
+            break;
+        }
+        name[strcspn(name, " \t")] = '\0';
+        add_subject(idx, name, &seq_m);
+
+        /* 2-bit packed, the low 2 bits of the last byte give the bases it holds */
+        uint32_t sb = be32(seq_off + 4 * i), se = be32(amb_off + 4 * i);
+        if (se <= sb || se > nsq_size) continue;
+        uint32_t slen = (se - sb - 1) * 4 + (nsq[se - 1] & 3);
+        grow_seq(idx, &seq_m, slen);
+        uint8_t* dst = idx->seq + idx->total_len;
+        for (j = 0; j < slen; j++) {
+            dst[j] = nt_code[nsq[sb + (j >> 2)] >> (6 - ((j & 3) << 1)) & 3];
+        }
+        idx->len[idx->num_seqs - 1] = slen;
+        idx->total_len += slen;
+    }
+
+    free(nin);
+    free(nhr);
+    free(nsq);
+}
+
+static void build_buckets(NtIndex* idx) {
+    uint64_t b, i = 0, num_buckets = 1ULL << NT_BUCKET_BITS;
+    idx->bucket = malloc((num_buckets + 1) * sizeof(uint64_t));
+    for (b = 0; b <= num_buckets; b++) {
+        while (i < idx->num_keys && idx->key[i] >> (2 * NT_K - NT_BUCKET_BITS) < b) i++;
+        idx->bucket[b] = i;
+    }
+}
+
+/* sort the minimizers and group them by hash; max_occ == 0 keeps every minimizer */
+static void build_keys(NtIndex* idx, MzPair* mz, size_t mz_n, uint64_t max_occ) {
+    mz_radix_sort(mz, mz_n);
+
+    size_t j, start = 0, n_pos = 0, n_keys = 0;
+    for (j = 1; j <= mz_n; j++) {
+        if (j < mz_n && mz[j].h == mz[start].h) continue;
+        if (max_occ == 0 || j - start <= max_occ) {
+            n_keys++;
+            n_pos += j - start;
+        }
+        start = j;
+    }
+    idx->num_keys = n_keys;
+    idx->key = malloc((n_keys > 0 ? n_keys : 1) * sizeof(uint64_t));
+    idx->key_off = malloc((n_keys + 1) * sizeof(uint64_t));
+    idx->pos = malloc((n_pos > 0 ? n_pos : 1) * sizeof(uint64_t));
+    if (idx->key == NULL || idx->key_off == NULL || idx->pos == NULL) {
+        log_message(ERROR, "Failed to allocate memory for the minimizer index");
+        exit(EXIT_FAILURE);
+    }
+    n_keys = n_pos = start = 0;
+    for (j = 1; j <= mz_n; j++) {
+        if (j < mz_n && mz[j].h == mz[start].h) continue;
+        if (max_occ == 0 || j - start <= max_occ) {
+            idx->key[n_keys] = mz[start].h;
+            idx->key_off[n_keys++] = n_pos;
+            for (; start < j; start++) {
+                idx->pos[n_pos++] = mz[start].v;
+            }
+        }
+        start = j;
+    }
+    idx->key_off[n_keys] = n_pos;
+    build_buckets(idx);
+}
+
+/* occurrences of minimizer h: pos[*off .. *off + return) */
+static inline uint64_t mz_lookup(const NtIndex* idx, uint64_t h, uint64_t* off) {
+    uint64_t b = h >> (2 * NT_K - NT_BUCKET_BITS);
+    uint64_t lo = idx->bucket[b], hi = idx->bucket[b + 1];
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (idx->key[mid] < h) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == idx->bucket[b + 1] || idx->key[lo] != h) return 0;
+    *off = idx->key_off[lo];
+    return idx->key_off[lo + 1] - *off;
+}
+
+NtIndex* ntindex_load(const char* db_path) {
+
+    NtIndex* idx = calloc(1, sizeof(NtIndex));
+    size_t nin_len = snprintf(NULL, 0, "%s.nin", db_path) + 1;
+    char nin_path[nin_len];
+    snprintf(nin_path, nin_len, "%s.nin", db_path);
+    if (is_file(db_path)) {
+        load_fasta(idx, db_path);
+    } else if (is_file(nin_path)) {
+        load_blastdb(idx, db_path);
+    } else {
+        log_message(ERROR, "Gene database not found: %s", db_path);
+        exit(EXIT_FAILURE);
+    }
+    if (idx->num_seqs == 0) {
+        log_message(ERROR, "No sequences in the gene database %s", db_path);
+        exit(EXIT_FAILURE);
+    }
+
+    /* minimizer index */
+    MzPair* mz = NULL;
+    size_t mz_n = 0, mz_m = 0;
+    int i;
+    idx->w = NT_GENE_W;
+    for (i = 0; i < idx->num_seqs; i++) {
+        mz_sketch(idx->seq + idx->offset[i], idx->len[i], idx->w, (uint64_t)i << 32, &mz, &mz_n, &mz_m);
+    }
+    build_keys(idx, mz, mz_n, NT_MAX_OCC);
+    free(mz);
+
+    return idx;
+}
+
+/* record offsets and lengths of the single-line FASTA reads */
+static void scan_reads(NtIndex* idx, const char* reads_fa) {
+    const char* p = idx->raw;
+    const char* end = idx->raw + idx->raw_size;
+    int m = 0, in_seq = 0;
+    while (p < end) {
+        const char* nl = memchr(p, '\n', end - p);
+        const char* le = nl != NULL ? nl : end;
+        size_t l = le - p;
+        if (l > 0 && p[l - 1] == '\r') l--;
+        if (l > 0 && p[0] == '>') {
+            if (idx->num_seqs == m) {
+                m = m ? m << 1 : 1 << 16;
+                idx->len = realloc(idx->len, m * sizeof(uint32_t));
+                idx->offset = realloc(idx->offset, m * sizeof(uint64_t));
+                if (idx->len == NULL || idx->offset == NULL) {
+                    log_message(ERROR, "Failed to allocate memory for the read index");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            idx->offset[idx->num_seqs] = le - idx->raw;
+            idx->len[idx->num_seqs] = 0;
+            idx->num_seqs++;
+            in_seq = 0;
+        } else if (l > 0) {
+            if (idx->num_seqs == 0 || in_seq || l > INT32_MAX) {
+                log_message(ERROR, "%s is not a single-line FASTA file", reads_fa);
+                exit(EXIT_FAILURE);
+            }
+            idx->offset[idx->num_seqs - 1] = p - idx->raw;
+            idx->len[idx->num_seqs - 1] = l;
+            idx->total_len += l;
+            in_seq = 1;
+        }
+        p = le + 1;
+    }
+}
+
+static void worker_sketch(void* data, long i, int tid) {
+    NtSketchData* d = (NtSketchData*)data;
+    const NtIndex* idx = d->idx;
+    long block = d->first + i;
+    long sid, end = (block + 1) * NT_READ_BLOCK < idx->num_seqs ? (block + 1) * NT_READ_BLOCK : idx->num_seqs;
+    uint32_t j;
+    for (sid = block * NT_READ_BLOCK; sid < end; sid++) {
+        uint32_t len = idx->len[sid];
+        const char* s = idx->raw + idx->offset[sid];
+        if (len > d->code_m[tid]) {
+            d->code_m[tid] = len;
+            d->code[tid] = realloc(d->code[tid], len);
+        }
+        for (j = 0; j < len; j++) d->code[tid][j] = seq_nt4_table[(uint8_t)s[j]];
+        mz_sketch(d->code[tid], len, idx->w, (uint64_t)sid << 32, &d->mz[i], &d->mz_n[i], &d->mz_m[i]);
+    }
+}
+
+/* 
+ * .mzi layout: magic, k and w, hdr (read file size and mtime, reads, keys, positions), 
+ * read offsets, read lengths padded to 8 bytes, positions, keys, key offsets
+ */
+static uint64_t mzi_size(uint64_t num_seqs, uint64_t num_keys, uint64_t num_pos, uint64_t* len_pad) {
+    *len_pad = (8 - num_seqs * sizeof(uint32_t) % 8) % 8;
+    return 8 + 2 * sizeof(uint32_t) + 5 * sizeof(uint64_t) + num_seqs * (sizeof(uint64_t) + sizeof(uint32_t)) + *len_pad 
+        + (num_pos + 2 * num_keys + 1) * sizeof(uint64_t);
+}
+
+static void write_fail(const char* path) {
+    log_message(ERROR, "Failed to write the read index %s", path);
+    exit(EXIT_FAILURE);
+}
+
+/* append the contents of fp to out */
+static void append_file(FILE* out, FILE* fp, const char* path) {
+    char buf[65536];
+    size_t n;
+    rewind(fp);
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        if (fwrite(buf, 1, n, out) != n) write_fail(path);
+    }
+    if (ferror(fp)) write_fail(path);
+}
+
+/* 
+ * Index the reads straight into idx_path. The reads are sketched once, a batch of 
+ * blocks at a time, and their minimizers spilled in read order to 2^NT_READ_PART_BITS 
+ * part files by the top bits of the hash. Each part is then sorted on its own and 
+ * written, so memory stays bounded by a batch and a part. Keys and key offsets go 
+ * to side files until every position is written.
+ */
+static void build_reads(const NtIndex* idx, const struct stat* st, const char* idx_path, int num_threads) {
+    long i, num_blocks = (idx->num_seqs + NT_READ_BLOCK - 1) / NT_READ_BLOCK;
+    long batch = 4L * num_threads;
+    int p, num_parts = 1 << NT_READ_PART_BITS;
+    size_t k;
+    NtSketchData d;
+    d.idx = idx;
+    d.code = calloc(num_threads, sizeof(uint8_t*));
+    d.code_m = calloc(num_threads, sizeof(size_t));
+    d.mz = calloc(batch, sizeof(MzPair*));
+    d.mz_n = calloc(batch, sizeof(size_t));
+    d.mz_m = calloc(batch, sizeof(size_t));
+
+    size_t path_len = snprintf(NULL, 0, "%s.%d.tmp", idx_path, num_parts) + 1;
+    char part_path[path_len];
+    FILE** part = calloc(num_parts, sizeof(FILE*));
+    uint64_t* part_n = calloc(num_parts, sizeof(uint64_t));
+    MzPair* spill = malloc((size_t)num_parts * NT_SPILL_BUF * sizeof(MzPair));
+    uint32_t* spill_n = calloc(num_parts, sizeof(uint32_t));
+    if (part == NULL || part_n == NULL || spill == NULL || spill_n == NULL) {
+        log_message(ERROR, "Failed to allocate memory for the read index");
+        exit(EXIT_FAILURE);
+    }
+    for (p = 0; p < num_parts; p++) {
+        snprintf(part_path, path_len, "%s.%d.tmp", idx_path, p);
+        part[p] = fopen(part_path, "w+b");
+        if (part[p] == NULL) write_fail(idx_path);
+    }
+    for (d.first = 0; d.first < num_blocks; d.first += batch) {
+        long n = num_blocks - d.first < batch ? num_blocks - d.first : batch;
+        kt_for(num_threads, worker_sketch, &d, n);
+        for (i = 0; i < n; i++) {
+            for (k = 0; k < d.mz_n[i]; k++) {
+                p = d.mz[i][k].h >> (2 * NT_K - NT_READ_PART_BITS);
+                MzPair* s = spill + (size_t)p * NT_SPILL_BUF;
+                s[spill_n[p]++] = d.mz[i][k];
+                if (spill_n[p] == NT_SPILL_BUF) {
+                    if (fwrite(s, sizeof(MzPair), NT_SPILL_BUF, part[p]) != NT_SPILL_BUF) write_fail(idx_path);
+                    spill_n[p] = 0;
+                }
+            }
+            d.mz_n[i] = 0;
+        }
+    }
+    uint64_t num_pos = 0;
+    for (p = 0; p < num_parts; p++) {
+        if (spill_n[p] > 0 && fwrite(spill + (size_t)p * NT_SPILL_BUF, sizeof(MzPair), spill_n[p], part[p]) != spill_n[p]) {
+            write_fail(idx_path);
+        }
+        part_n[p] = ftello(part[p]) / sizeof(MzPair);
+        num_pos += part_n[p];
+    }
+    free(spill);
+    free(spill_n);
+    for (i = 0; i < batch; i++) free(d.mz[i]);
+    for (i = 0; i < num_threads; i++) free(d.code[i]);
+    free(d.code); free(d.code_m);
+    free(d.mz); free(d.mz_n); free(d.mz_m);
+
+    path_len = snprintf(NULL, 0, "%s.key.tmp", idx_path) + 1;
+    char tmp_path[path_len], key_path[path_len], off_path[path_len];
+    snprintf(tmp_path, path_len, "%s.tmp", idx_path);
+    snprintf(key_path, path_len, "%s.key.tmp", idx_path);
+    snprintf(off_path, path_len, "%s.off.tmp", idx_path);
+    FILE* fp = fopen(tmp_path, "wb");
+    FILE* fk = fopen(key_path, "w+b");
+    FILE* fo = fopen(off_path, "w+b");
+    if (fp == NULL || fk == NULL || fo == NULL) write_fail(idx_path);
+    uint64_t len_pad, pad = 0;
+    mzi_size(idx->num_seqs, 0, num_pos, &len_pad);
+    uint32_t kw[2] = {NT_K, (uint32_t)idx->w};
+    uint64_t hdr[5] = {(uint64_t)st->st_size, (uint64_t)st->st_mtime, (uint64_t)idx->num_seqs, 0, num_pos};
+    if (fwrite(NT_IDX_MAGIC, 1, 8, fp) != 8 
+        || fwrite(kw, sizeof(uint32_t), 2, fp) != 2 
+        || fwrite(hdr, sizeof(uint64_t), 5, fp) != 5 
+        || fwrite(idx->offset, sizeof(uint64_t), idx->num_seqs, fp) != (size_t)idx->num_seqs 
+        || fwrite(idx->len, sizeof(uint32_t), idx->num_seqs, fp) != (size_t)idx->num_seqs 
+        || fwrite(&pad, 1, len_pad, fp) != len_pad) {
+        write_fail(idx_path);
+    }
+
+    /* parts are in read order, so the stable sort on h leaves each key's positions ascending */
+    uint64_t num_keys = 0, done = 0;
+    uint64_t wbuf[4096];
+    for (p = 0; p < num_parts; p++) {
+        uint64_t j, w = 0, n = part_n[p];
+        MzPair* s = n > 0 ? malloc(n * sizeof(MzPair)) : NULL;
+        if (n > 0 && s == NULL) {
+            log_message(ERROR, "Failed to allocate memory for the read index");
+            exit(EXIT_FAILURE);
+        }
+        rewind(part[p]);
+        if (n > 0 && fread(s, sizeof(MzPair), n, part[p]) != n) write_fail(idx_path);
+        fclose(part[p]);
+        snprintf(part_path, sizeof(part_path), "%s.%d.tmp", idx_path, p);
+        remove(part_path);
+        if (n == 0) continue;
+        mz_radix_sort(s, n);
+        for (j = 0; j < n; j++) {
+            if (j == 0 || s[j].h != s[j - 1].h) {
+                uint64_t off = done + j;
+                if (fwrite(&s[j].h, sizeof(uint64_t), 1, fk) != 1 || fwrite(&off, sizeof(uint64_t), 1, fo) != 1) write_fail(idx_path);
+                num_keys++;
+            }
+            wbuf[w++] = s[j].v;
+            if (w == 4096 || j + 1 == n) {
+                if (fwrite(wbuf, sizeof(uint64_t), w, fp) != w) write_fail(idx_path);
+                w = 0;
+            }
+        }
+        done += n;
+        free(s);
+    }
+    free(part);
+    free(part_n);
+    if (fwrite(&num_pos, sizeof(uint64_t), 1, fo) != 1) write_fail(idx_path);
+    append_file(fp, fk, idx_path);
+    append_file(fp, fo, idx_path);
+    hdr[3] = num_keys;
+    if (fseek(fp, 8 + 2 * sizeof(uint32_t), SEEK_SET) != 0 || fwrite(hdr, sizeof(uint64_t), 5, fp) != 5) write_fail(idx_path);
+    if (fclose(fp) != 0) write_fail(idx_path);
+    fclose(fk);
+    fclose(fo);
+    remove(key_path);
+    remove(off_path);
+    rename_file(tmp_path, idx_path);
+}
+
+/* map a saved read index; 0 when it is missing or was built from another file */
+static int load_reads(NtIndex* idx, const struct stat* st, const char* idx_path) {
+    int fd = open(idx_path, O_RDONLY);
+    struct stat ist;
+    if (fd < 0) return 0;
+    uint64_t head[2 + 5];
+    if (fstat(fd, &ist) != 0 || (size_t)ist.st_size < sizeof(head) || read(fd, head, sizeof(head)) != (ssize_t)sizeof(head)) {
+        close(fd);
+        return 0;
+    }
+    const uint32_t* kw = (const uint32_t*)&head[1];
+    const uint64_t* hdr = &head[2];
+    uint64_t len_pad;
+    if (memcmp(head, NT_IDX_MAGIC, 8) != 0 || kw[0] != NT_K || kw[1] != NT_READ_W 
+        || hdr[0] != (uint64_t)st->st_size || hdr[1] != (uint64_t)st->st_mtime || hdr[2] > INT32_MAX 
+        || mzi_size(hdr[2], hdr[3], hdr[4], &len_pad) != (uint64_t)ist.st_size) {
+        close(fd);
+        return 0;
+    }
+    char* map = mmap(NULL, ist.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+    int num_seqs = hdr[2];
+    uint64_t num_keys = hdr[3], num_pos = hdr[4];
+    char* p = map + sizeof(head);
+    uint64_t* offset = (uint64_t*)p;
+    p += num_seqs * sizeof(uint64_t);
+    uint32_t* len = (uint32_t*)p;
+    p += num_seqs * sizeof(uint32_t) + len_pad;
+    uint64_t* pos = (uint64_t*)p;
+    p += num_pos * sizeof(uint64_t);
+    uint64_t* key = (uint64_t*)p;
+    p += num_keys * sizeof(uint64_t);
+    uint64_t* key_off = (uint64_t*)p;
+    int ok = key_off[num_keys] == num_pos;
+    int i;
+    for (i = 0; ok && i < num_seqs; i++) {
+        if (offset[i] + len[i] > idx->raw_size) ok = 0;
+    }
+    if (!ok) {
+        munmap(map, ist.st_size);
+        return 0;
+    }
+    idx->map = map;
+    idx->map_size = ist.st_size;
+    idx->num_seqs = num_seqs;
+    idx->offset = offset;
+    idx->len = len;
+    idx->num_keys = num_keys;
+    idx->key = key;
+    idx->key_off = key_off;
+    idx->pos = pos;
+    idx->total_len = 0;
+    for (i = 0; i < num_seqs; i++) idx->total_len += len[i];
+    build_buckets(idx);
+    return 1;
+}
+
+NtIndex* ntindex_reads(const char* reads_fa, const char* idx_path, int num_threads) {
+
+    NtIndex* idx = calloc(1, sizeof(NtIndex));
+    idx->w = NT_READ_W;
+    int fd = open(reads_fa, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        log_message(ERROR, "Failed to open %s", reads_fa);
+        exit(EXIT_FAILURE);
+    }
+    idx->raw_size = st.st_size;
+    if (idx->raw_size > 0) {
+        idx->raw = mmap(NULL, idx->raw_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (idx->raw == MAP_FAILED) {
+            log_message(ERROR, "Failed to map %s", reads_fa);
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(fd);
+
+    if (!load_reads(idx, &st, idx_path)) {
+        log_message(INFO, "Indexing reads: %s", reads_fa);
+        scan_reads(idx, reads_fa);
+        build_reads(idx, &st, idx_path, num_threads);
+        free(idx->offset);
+        free(idx->len);
+        idx->offset = NULL;
+        idx->len = NULL;
+        idx->num_seqs = 0;
+        idx->total_len = 0;
+        if (!load_reads(idx, &st, idx_path)) {
+            log_message(ERROR, "Failed to load the read index %s", idx_path);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return idx;
+}
+
+void ntindex_free(NtIndex* idx) {
+    if (idx == NULL) return;
+    int i;
+    if (idx->name != NULL) {
+        for (i = 0; i < idx->num_seqs; i++) {
+            free(idx->name[i]);
+        }
+        free(idx->name);
+    }
+    free(idx->seq);
+    if (idx->raw != NULL) munmap((void*)idx->raw, idx->raw_size);
+    free(idx->bucket);
+    if (idx->map != NULL) {
+        munmap(idx->map, idx->map_size);
+    } else {
+        free(idx->len);
+        free(idx->offset);
+        free(idx->key);
+        free(idx->key_off);
+        free(idx->pos);
+    }
+    free(idx);
+}
+
+
+/* 
+ * Banded Gotoh alignment of q against s, anchored at (0,0), on the diagonals 
+ * lo <= j - i <= hi. With extend == 0 the alignment must end at (ql, sl); 
+ * otherwise it ends at the best-scoring cell, with z-drop. 
+ */
+static void band_align(const uint8_t* q, int ql, const uint8_t* s, int sl, int lo, int hi, int extend, 
+                       NtBuf* b, AlnStat* st, int* q_end, int* s_end) {
+    int W = hi - lo + 1;
+    int i, dd;
+    size_t need_dp = (size_t)W * 6;
+    size_t need_tb = (size_t)(ql + 1) * W;
+    if (need_dp > b->dp_m) {
+        b->dp_m = need_dp;
+        b->dp = realloc(b->dp, need_dp * sizeof(int32_t));
+    }
+    if (need_tb > b->tb_m) {
+        b->tb_m = need_tb;
+        b->tb = realloc(b->tb, need_tb);
+    }
+    int32_t *Hp = b->dp, *Ep = Hp + W, *Fp = Ep + W;
+    int32_t *Hc = Fp + W, *Ec = Hc + W, *Fc = Ec + W;
+
+    int best = 0, best_i = 0, best_j = 0;
+    for (i = 0; i <= ql; i++) {
+        uint8_t* tb = b->tb + (size_t)i * W;
+        int row_max = NT_NEG_INF;
+        for (dd = 0; dd < W; dd++) {
+            int j = i + lo + dd;
+            if (j < 0 || j > sl) {
+                Hc[dd] = Ec[dd] = Fc[dd] = NT_NEG_INF;
+                tb[dd] = 0;
+                continue;
+            }
+            if (i == 0 && j == 0) {
+                Hc[dd] = 0;
+                Ec[dd] = Fc[dd] = NT_NEG_INF;
+                tb[dd] = 0;
+                continue;
+            }
+            int f = NT_NEG_INF, e = NT_NEG_INF, h = NT_NEG_INF;
+            uint8_t bits = 0;
+            if (i > 0 && dd + 1 < W) {
+                int hf = Hp[dd + 1] - NT_GAPO - NT_GAPE, ff = Fp[dd + 1] - NT_GAPE;
+                if (ff > hf) { f = ff; bits |= 8; } else f = hf;
+            }
+            if (dd > 0) {
+                int he = Hc[dd - 1] - NT_GAPO - NT_GAPE, ee = Ec[dd - 1] - NT_GAPE;
+                if (ee > he) { e = ee; bits |= 4; } else e = he;
+            }
+            if (i > 0 && j > 0) {
+                h = Hp[dd] + (q[i - 1] == s[j - 1] && q[i - 1] < 4 ? NT_MATCH : -NT_MISMATCH);
+            }
+            if (e > h) { h = e; bits |= 1; }
+            if (f > h) { h = f; bits = (bits & ~3) | 2; }
+            Hc[dd] = h; Ec[dd] = e; Fc[dd] = f;
+            tb[dd] = bits;
+            if (h > row_max) row_max = h;
+            if (extend && h > best) {
+                best = h; best_i = i; best_j = j;
+            }
+        }
+        int32_t* t;
+        t = Hp; Hp = Hc; Hc = t;
+        t = Ep; Ep = Ec; Ec = t;
+        t = Fp; Fp = Fc; Fc = t;
+        if (extend && row_max < best - NT_ZDROP) break;
+    }
+
+    int ti, tj;
+    if (extend) {
+        ti = best_i; tj = best_j;
+        st->score += best;
+    } else {
+        ti = ql; tj = sl;
+        st->score += Hp[sl - ql - lo];
+    }
+    *q_end = ti;
+    *s_end = tj;
+
+    /* traceback */
+    int state = 0;
+    while (ti > 0 || tj > 0) {
+        uint8_t bits = b->tb[(size_t)ti * W + (tj - ti - lo)];
+        if (state == 0) {
+            int src = bits & 3;
+            if (src == 0 && ti > 0 && tj > 0) {
+                if (q[ti - 1] == s[tj - 1] && q[ti - 1] < 4) st->match++;
+                else st->mismatch++;
+                ti--; tj--;
+                continue;
+            }
+            if (src == 0) src = ti > 0 ? 2 : 1;
+            state = src;
+        }
+        st->gap_col++;
+        if (state == 1) {
+            if (!(bits & 4)) { st->gapo++; state = 0; }
+            tj--;
+        } else {
+            if (!(bits & 8)) { st->gapo++; state = 0; }
+            ti--;
+        }
+    }
+}
+
+static inline uint8_t* buf_reserve(uint8_t** p, size_t* m, size_t n) {
+    if (n > *m) {
+        *m = n;
+        *p = realloc(*p, n);
+    }
+    return *p;
+}
+
+static void ext_align(const uint8_t* q, int ql, const uint8_t* s, int sl, int reverse, 
+                      NtBuf* b, AlnStat* st, int* q_ext, int* s_ext) {
+    *q_ext = *s_ext = 0;
+    if (ql == 0 || sl == 0) return;
+    if (ql > NT_EXT_LEN) ql = NT_EXT_LEN;
+    if (sl > NT_EXT_LEN) sl = NT_EXT_LEN;
+    size_t need = ql > sl ? ql : sl;
+    if (need > b->t_m) {
+        b->t_m = need;
+        b->tq = realloc(b->tq, need);
+        b->ts = realloc(b->ts, need);
+    }
+    int i;
+    if (reverse) {
+        /* q and s point just past the flank */
+        for (i = 0; i < ql; i++) b->tq[i] = q[-1 - i];
+        for (i = 0; i < sl; i++) b->ts[i] = s[-1 - i];
+        q = b->tq;
+        s = b->ts;
+    }
+    band_align(q, ql, s, sl, -NT_EXT_BAND, NT_EXT_BAND, 1, b, st, q_ext, s_ext);
+}
+
+/* 2-bit codes of subject sid; reads are encoded from the mapped file into b->sbuf */
+static const uint8_t* subject_seq(const NtIndex* idx, int sid, NtBuf* b) {
+    if (idx->seq != NULL) return idx->seq + idx->offset[sid];
+    uint32_t j, len = idx->len[sid];
+    const char* s = idx->raw + idx->offset[sid];
+    buf_reserve(&b->sbuf, &b->s_m, len);
+    for (j = 0; j < len; j++) b->sbuf[j] = seq_nt4_table[(uint8_t)s[j]];
+    return b->sbuf;
+}
+
+/* align one chain of anchors (ascending) against subject ss */
+static void chain_align(const Anchor* a, int n, const uint8_t* qs, int qlen, const uint8_t* ss, int slen, 
+                        NtBuf* b, AlnStat* st, int* qb, int* qe, int* sb, int* se) {
+    int i, eq, es;
+
+    memset(st, 0, sizeof(AlnStat));
+    int cq = (int32_t)a[0].x - NT_K + 1;
+    int cs = (int)a[0].y - NT_K + 1;
+    ext_align(qs + cq, cq, ss + cs, cs, 1, b, st, &eq, &es);
+    *qb = cq - eq;
+    *sb = cs - es;
+
+    for (i = 0; i < n; i++) {
+        int aq = (int32_t)a[i].x - NT_K + 1;
+        int as = (int)a[i].y - NT_K + 1;
+        if (aq >= cq && as >= cs) {
+            int gq = aq - cq, gs = as - cs;
+            if (gq > 0 || gs > 0) {
+                int lo = (gs - gq < 0 ? gs - gq : 0) - NT_GAP_BAND;
+                int hi = (gs - gq > 0 ? gs - gq : 0) + NT_GAP_BAND;
+                band_align(qs + cq, gq, ss + cs, gs, lo, hi, 0, b, st, &eq, &es);
+            }
+            st->match += NT_K;
+            st->score += NT_K * NT_MATCH;
+            cq = aq + NT_K;
+            cs = as + NT_K;
+        } else if (cq - aq == cs - as && cq - aq < NT_K) {
+            int add = NT_K - (cq - aq);
+            st->match += add;
+            st->score += add * NT_MATCH;
+            cq += add;
+            cs += add;
+        }
+    }
+
+    ext_align(qs + cq, qlen - cq, ss + cs, slen - cs, 0, b, st, &eq, &es);
+    *qe = cq + eq;
+    *se = cs + es;
+}
+
+static void push_hit(NtHits* hits, const NtIndex* idx, const char* qname, int qlen, int sid, int strand, 
+                     const AlnStat* st, int qb, int qe, int sb, int se) {
+    int align_len = st->match + st->mismatch + st->gap_col;
+    if (align_len == 0) return;
+    double bits = (NT_LAMBDA * st->score / NT_SCORE_SCALE - log(NT_KA)) / M_LN2;
+    double evalue = (double)qlen * idx->total_len * pow(2.0, -bits);
+    if (evalue > NT_MAX_EVALUE) return;
+
+    if (hits->n == hits->cap) {
+        hits->cap = hits->cap ? hits->cap << 1 : 4;
+        hits->m = realloc(hits->m, hits->cap * sizeof(BlastDircMatch));
+    }
+    BlastDircMatch* m = &hits->m[hits->n++];
+    m->query_id = strdup(qname);
+    m->gene_id = strdup(idx->name[sid]);
+    m->identity = 100.0 * st->match / align_len;
+    m->align_len = align_len;
+    m->mismatch = st->mismatch;
+    m->gap = st->gapo;
+    if (strand == 0) {
+        m->qstart = qb + 1;
+        m->qend = qe;
+        m->sstart = sb + 1;
+        m->send = se;
+        m->direction = 1;
+    } else {
+        m->qstart = qlen - qe + 1;
+        m->qend = qlen - qb;
+        m->sstart = se;
+        m->send = sb + 1;
+        m->direction = 2;
+    }
+    m->evalue = evalue;
+    m->score = bits;
+}
+
+/* encode both strands of the query */
+static void encode_query(NtBuf* b, const char* seq, uint32_t qlen) {
+    uint32_t j;
+    buf_reserve(&b->qfwd, &b->q_m, qlen);
+    b->qrev = realloc(b->qrev, b->q_m);
+    for (j = 0; j < qlen; j++) {
+        uint8_t c = seq_nt4_table[(uint8_t)seq[j]];
+        b->qfwd[j] = c;
+        b->qrev[qlen - 1 - j] = c < 4 ? 3 - c : 4;
+    }
+}
+
+/* minimizer hits of the query, sorted by subject, strand and position */
+static size_t collect_anchors(const NtIndex* idx, NtBuf* b, uint32_t qlen, uint64_t max_occ) {
+    b->mz_n = 0;
+    mz_sketch(b->qfwd, qlen, idx->w, 0, &b->mz, &b->mz_n, &b->mz_m);
+    b->a_n = 0;
+    size_t k;
+    for (k = 0; k < b->mz_n; k++) {
+        uint64_t off = 0, cnt = mz_lookup(idx, b->mz[k].h, &off), l;
+        if (cnt == 0 || cnt > max_occ) continue;
+        uint32_t qpos = b->mz[k].v >> 1;
+        int qstrand = b->mz[k].v & 1;
+        if (b->a_n + cnt > b->a_m) {
+            while (b->a_n + cnt > b->a_m) b->a_m = b->a_m ? b->a_m << 1 : 1024;
+            b->a = realloc(b->a, b->a_m * sizeof(Anchor));
+        }
+        for (l = 0; l < cnt; l++) {
+            uint64_t v = idx->pos[off + l];
+            uint64_t sid = v >> 32;
+            int strand = qstrand ^ (int)(v & 1);
+            uint32_t spos = (uint32_t)v >> 1;
+            uint32_t q = strand == 0 ? qpos : qlen - qpos + NT_K - 2;
+            b->a[b->a_n].x = sid << 33 | (uint64_t)strand << 32 | q;
+            b->a[b->a_n].y = spos;
+            b->a_n++;
+        }
+    }
+    if (b->a_n == 0) return 0;
+    ks_introsort(anchor, b->a_n, b->a);
+
+    if (b->a_n > b->chain_m) {
+        b->chain_m = b->a_n;
+        b->f = realloc(b->f, b->chain_m * sizeof(int32_t));
+        b->p = realloc(b->p, b->chain_m * sizeof(int32_t));
+        b->used = realloc(b->used, b->chain_m);
+        b->order = realloc(b->order, b->chain_m * sizeof(uint64_t));
+        b->chain = realloc(b->chain, b->chain_m * sizeof(Anchor));
+    }
+    return b->a_n;
+}
+
+/* 
+ * Chain the anchors b->a[start .. start + n) of one subject and strand. 
+ * Chains are stored best first, each in ascending order, at 
+ * b->chain + b->chain_beg[i]; returns their number.
+ */
+static int chain_anchors(NtBuf* b, size_t start, int n) {
+    Anchor* a = b->a + start;
+    int32_t* f = b->f + start;
+    int32_t* p = b->p + start;
+    uint8_t* used = b->used + start;
+    int ii, jj;
+    for (ii = 0; ii < n; ii++) {
+        int32_t qi = (int32_t)a[ii].x, si = (int32_t)a[ii].y;
+        int32_t best_f = NT_K, best_p = -1;
+        for (jj = ii - 1; jj >= 0 && jj >= ii - NT_CHAIN_SKIP; jj--) {
+            int32_t dq = qi - (int32_t)a[jj].x, ds = si - (int32_t)a[jj].y;
+            if (dq > NT_MAX_GAP) break;
+            if (dq <= 0 || ds <= 0 || ds > NT_MAX_GAP) continue;
+            int32_t dd = dq > ds ? dq - ds : ds - dq;
+            if (dd > NT_CHAIN_BW) continue;
+            int32_t min_d = dq < ds ? dq : ds;
+            int32_t sc = f[jj] + (min_d < NT_K ? min_d : NT_K);
+            if (dd) sc -= (int32_t)(0.01 * NT_K * dd + 0.5 * log2(dd));
+            if (sc > best_f) {
+                best_f = sc;
+                best_p = jj;
+            }
+        }
+        f[ii] = best_f;
+        p[ii] = best_p;
+        used[ii] = 0;
+        b->order[ii] = (uint64_t)best_f << 32 | ii;
+    }
+    ks_introsort(uint64_t, n, b->order);
+
+    int num_chains = 0, total = 0;
+    for (ii = n - 1; ii >= 0 && num_chains < NT_MAX_CHAINS; ii--) {
+        int e = b->order[ii] & 0xffffffff;
+        if (used[e]) continue;
+        int c = e, stop_f = 0, len = 0;
+        while (c >= 0 && !used[c]) {
+            used[c] = 1;
+            len++;
+            c = p[c];
+        }
+        if (c >= 0) stop_f = f[c];
+        if (f[e] - stop_f < NT_MIN_CHAIN) continue;
+
+        /* collect the chain in ascending order */
+        Anchor* chain = b->chain + total;
+        int t = len;
+        c = e;
+        while (t > 0) {
+            chain[--t] = a[c];
+            c = p[c];
+        }
+        b->chain_beg[num_chains] = total;
+        b->chain_len[num_chains] = len;
+        num_chains++;
+        total += len;
+    }
+    return num_chains;
+}
+
+static void worker_search(void* data, long i, int tid) {
+    NtSearchData* d = (NtSearchData*)data;
+    const NtIndex* idx = d->idx;
+    NtBuf* b = &d->buf[tid];
+    NtHits* hits = &d->hits[i];
+    int ctg = i + 1;
+    uint32_t qlen;
+    const char* seq = ctgstore_seq(d->store, ctg, &qlen);
+    if (seq == NULL || qlen < NT_K) return;
+
+    encode_query(b, seq, qlen);
+    if (collect_anchors(idx, b, qlen, NT_MAX_OCC) == 0) return;
+
+    /* chain anchors per subject and strand */
+    int best_set = 0;
+    AlnStat best_st;
+    int best_sid = 0, best_strand = 0, best_qb = 0, best_qe = 0, best_sb = 0, best_se = 0;
+    size_t start = 0, end;
+    for (end = 1; end <= b->a_n; end++) {
+        if (end < b->a_n && b->a[end].x >> 32 == b->a[start].x >> 32) continue;
+        int sid = b->a[start].x >> 33;
+        int strand = (b->a[start].x >> 32) & 1;
+        int c, num_chains = chain_anchors(b, start, end - start);
+        for (c = 0; c < num_chains; c++) {
+            AlnStat st;
+            int qb, qe, sb, se;
+            chain_align(b->chain + b->chain_beg[c], b->chain_len[c], strand ? b->qrev : b->qfwd, qlen, 
+                        subject_seq(idx, sid, b), idx->len[sid], b, &st, &qb, &qe, &sb, &se);
+            if (d->best_only) {
+                if (!best_set || st.score > best_st.score) {
+                    best_set = 1;
+                    best_st = st;
+                    best_sid = sid; best_strand = strand;
+                    best_qb = qb; best_qe = qe; best_sb = sb; best_se = se;
+                }
+            } else {
+                push_hit(hits, idx, ctgstore_name(d->store, ctg), qlen, sid, strand, &st, qb, qe, sb, se);
+            }
+        }
+        start = end;
+    }
+    if (best_set) {
+        push_hit(hits, idx, ctgstore_name(d->store, ctg), qlen, best_sid, best_strand, &best_st, best_qb, best_qe, best_sb, best_se);
+    }
+}
+
+static void free_bufs(NtBuf* buf, int num_threads) {
+    int i;
+    for (i = 0; i < num_threads; i++) {
+        NtBuf* b = &buf[i];
+        free(b->mz); free(b->a); free(b->f); free(b->p); free(b->used); free(b->order); free(b->chain);
+        free(b->qfwd); free(b->qrev); free(b->sbuf); free(b->tq); free(b->ts); free(b->dp); free(b->tb);
+    }
+    free(buf);
+}
+
+BlastDircMatch* ntsearch(const NtIndex* idx, const CtgStore* store, int num_threads, int best_only, int* num_matches) {
+
+    NtSearchData d;
+    d.idx = idx;
+    d.store = store;
+    d.best_only = best_only;
+    d.buf = calloc(num_threads, sizeof(NtBuf));
+    d.hits = calloc(store->ctg_num, sizeof(NtHits));
+
+    kt_for(num_threads, worker_search, &d, store->ctg_num);
+
+    int i, total = 0;
+    for (i = 0; i < store->ctg_num; i++) {
+        total += d.hits[i].n;
+    }
+    BlastDircMatch* matches = malloc((total > 0 ? total : 1) * sizeof(BlastDircMatch));
+    total = 0;
+    for (i = 0; i < store->ctg_num; i++) {
+        if (d.hits[i].n > 0) {
+            memcpy(matches + total, d.hits[i].m, d.hits[i].n * sizeof(BlastDircMatch));
+            total += d.hits[i].n;
+        }
+        free(d.hits[i].m);
+    }
+    free(d.hits);
+    free_bufs(d.buf, num_threads);
+
+    *num_matches = total;
+    return matches;
+}
+
+static void worker_span(void* data, long i, int tid) {
+    NtSpanData* d = (NtSpanData*)data;
+    const NtIndex* idx = d->idx;
+    NtBuf* b = &d->buf[tid];
+    const char* seq = d->seqs[i];
+    uint32_t qlen = strlen(seq);
+    d->counts[i] = 0;
+    if (qlen < NT_K) return;
+
+    encode_query(b, seq, qlen);
+    if (collect_anchors(idx, b, qlen, NT_READ_MAX_OCC) == 0) return;
+
+    /* a read counts once, on the first chain that spans the junction */
+    int64_t last_sid = -1;
+    size_t start = 0, end;
+    for (end = 1; end <= b->a_n && d->counts[i] < d->max_count; end++) {
+        if (end < b->a_n && b->a[end].x >> 32 == b->a[start].x >> 32) continue;
+        int sid = b->a[start].x >> 33;
+        int strand = (b->a[start].x >> 32) & 1;
+        if (sid != last_sid) {
+            int c, num_chains = chain_anchors(b, start, end - start);
+            const uint8_t* ss = num_chains > 0 ? subject_seq(idx, sid, b) : NULL;
+            for (c = 0; c < num_chains; c++) {
+                AlnStat st;
+                int qb, qe, sb, se;
+                chain_align(b->chain + b->chain_beg[c], b->chain_len[c], strand ? b->qrev : b->qfwd, qlen, 
+                            ss, idx->len[sid], b, &st, &qb, &qe, &sb, &se);
+                int align_len = st.match + st.mismatch + st.gap_col;
+                int qstart = strand == 0 ? qb + 1 : qlen - qe + 1;
+                int qend = strand == 0 ? qe : qlen - qb;
+                if (align_len > 0 && st.match >= d->min_iden * align_len && qstart <= d->span_beg && qend >= d->span_end) {
+                    d->counts[i]++;
+                    last_sid = sid;
+                    break;
+                }
+            }
+        }
+        start = end;
+    }
+}
+
+int* ntsearch_spanning(const NtIndex* idx, char** seqs, int num_seqs, int span_beg, int span_end, 
+                       float min_iden, int max_count, int num_threads) {
+
+    NtSpanData d;
+    d.idx = idx;
+    d.seqs = seqs;
+    d.span_beg = span_beg;
+    d.span_end = span_end;
+    d.min_iden = min_iden;
+    d.max_count = max_count;
+    d.buf = calloc(num_threads, sizeof(NtBuf));
+    d.counts = calloc(num_seqs > 0 ? num_seqs : 1, sizeof(int));
+
+    kt_for(num_threads, worker_span, &d, num_seqs);
+
+    free_bufs(d.buf, num_threads);
+    return d.counts;
+}
+
+uint32_t ntsearch_self_overlap(const char* seq, uint32_t len, float min_iden) {
+    if (len < 2 * NT_OVL_MIN) return 0;
+    uint32_t max_ovl = len / 2 < NT_OVL_MAX ? len / 2 : NT_OVL_MAX;
+    uint64_t seed = 0, kmer = 0;
+    uint32_t i, l = 0, num_cand = 0, cand[NT_OVL_CAND];
+
+    for (i = 0; i < NT_OVL_SEED; i++) {
+        uint8_t c = seq_nt4_table[(uint8_t)seq[i]];
+        if (c > 3) return 0;
+        seed = seed << 2 | c;
+    }
+    /* rolling 2-bit k-mer over the last max_ovl bases, largest overlap first */
+    for (i = len - max_ovl; i < len && num_cand < NT_OVL_CAND; i++) {
+        uint8_t c = seq_nt4_table[(uint8_t)seq[i]];
+        if (c > 3) {
+            l = 0;
+            continue;
+        }
+        kmer = kmer << 2 | c;
+        if (++l >= NT_OVL_SEED && kmer == seed && len - (i + 1 - NT_OVL_SEED) >= NT_OVL_MIN) {
+            cand[num_cand++] = i + 1 - NT_OVL_SEED;
+        }
+    }
+    if (num_cand == 0) return 0;
+
+    /* the suffix from each hit must align to the contig start up to its last base */
+    NtBuf* b = calloc(1, sizeof(NtBuf));
+    encode_query(b, seq, len);
+    uint32_t ovl = 0;
+    for (i = 0; i < num_cand && ovl == 0; i++) {
+        int ql = len - cand[i];
+        int sl = ql + NT_GAP_BAND < (int)len ? ql + NT_GAP_BAND : (int)len;
+        int qe, se;
+        AlnStat st;
+        memset(&st, 0, sizeof(AlnStat));
+        band_align(b->qfwd + cand[i], ql, b->qfwd, sl, -NT_GAP_BAND, NT_GAP_BAND, 1, b, &st, &qe, &se);
+        int align_len = st.match + st.mismatch + st.gap_col;
+        if (align_len > 0 && st.match >= min_iden * align_len && ql - qe <= NT_GAP_BAND) {
+            ovl = ql;
+        }
+    }
+    free_bufs(b, 1);
+    return ovl;
+}
@@ -0,0 +1,91 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 Hanfc <h2624366594@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef NTSEARCH_H
+#define NTSEARCH_H
+
+#include <stdint.h>
+#include "hitseeds.h"
+#include "ctgstore.h"
+
+/* 
+ * Built-in nucleotide search against the conserved gene databases and the 
+ * cut reads. Gene subjects are read from the FASTA file or, when only the 
+ * BLAST database exists, from its .nin/.nhr/.nsq volume; reads are mapped 
+ * from the single-line FASTA written by BreakLongReads. Queries are seeded 
+ * with (k,w)-minimizers, anchors are chained per subject and strand, and 
+ * each chain is aligned by banded Smith-Waterman (gap fill between anchors, 
+ * z-drop extension at both ends). Gene hits are reported as blastn 
+ * -outfmt 6 would.
+ */
+typedef struct {
+    int num_seqs;
+    char** name;            /* subject titles, NULL for reads */
+    uint32_t* len;
+    uint64_t* offset;       /* offset of each subject in seq, or in raw for reads */
+    uint8_t* seq;           /* concatenated subjects, 2-bit codes (4 for others) */
+    const char* raw;        /* mapped read file when seq is NULL */
+    size_t raw_size;
+    uint64_t total_len;
+    int w;                  /* minimizer window */
+    uint64_t num_keys;
+    uint64_t* key;          /* distinct minimizer hashes, ascending */
+    uint64_t* key_off;      /* occurrences of key[i] are pos[key_off[i] .. key_off[i + 1]) */
+    uint64_t* bucket;       /* first key of each hash bucket */
+    uint64_t* pos;          /* sid << 32 | end position << 1 | strand */
+    void* map;              /* mapped .mzi holding offset, len, key, key_off and pos of the reads */
+    size_t map_size;
+} NtIndex;
+
+NtIndex* ntindex_load(const char* db_path);
+
+/* 
+ * Minimizer index of the cut reads, built with num_threads into idx_path 
+ * and mapped from there; reused while reads_fa is unchanged.
+ */
+NtIndex* ntindex_reads(const char* reads_fa, const char* idx_path, int num_threads);
+void ntindex_free(NtIndex* idx);
+
+/* 
+ * Search all contigs of the store; best_only keeps one hit per contig 
+ * (blastn -num_alignments 1 -max_hsps 1). Returned in contig order.
+ */
+BlastDircMatch* ntsearch(const NtIndex* idx, const CtgStore* store, int num_threads, int best_only, int* num_matches);
+
+/* 
+ * For each query, count the subjects aligned with at least min_iden identity 
+ * from query position span_beg or before to span_end or after (1-based, as 
+ * blastn reports them), counting up to max_count.
+ */
+int* ntsearch_spanning(const NtIndex* idx, char** seqs, int num_seqs, int span_beg, int span_end, 
+                       float min_iden, int max_count, int num_threads);
+
+/* 
+ * Length of the overlap between the end and the start of a contig written 
+ * with its circular junction repeated, 0 when none is found.
+ */
+uint32_t ntsearch_self_overlap(const char* seq, uint32_t len, float min_iden);
+
+#endif // NTSEARCH_H
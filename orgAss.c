@@ -79,7 +79,7 @@ static void update_gene_stats(GeneMap* map, const char* gene, float identity, in
     map->stats[map->count - 1].gene_len = gene_len;
 }
 
-void orgAss(const char* exe_path, const char* all_contigs, CtgDepth *ctg_depth, const char* output_path, const int* contig_ids, int num_contigs, const char* organelle_type, int taxo) {
+void orgAss(const char* exe_path, const CtgStore* store, CtgDepth *ctg_depth, const char* output_path, const int* contig_ids, int num_contigs, const char* organelle_type, int taxo) {
 
     AssessResult* result = calloc(1, sizeof(AssessResult));
     
@@ -147,7 +147,8 @@ void orgAss(const char* exe_path, const char* all_contigs, CtgDepth *ctg_depth,
         char db_path[db_path_len];
         snprintf(db_path, db_path_len, "%s%s", dir, db_suffix);
         int num_hits = 0;
-        mrun_blastn(all_contigs, db_path, blast_file, 6, &num_hits);
+        BlastDircMatch* matches = mrun_search(store, db_path, blast_file, 6, &num_hits);
+        free_matches(matches, num_hits);
         free(dir);
     }
 
@@ -54,7 +54,7 @@ typedef struct {
 } MtStructure;
 
 
-void orgAss(const char* exe_path, const char* all_contigs, CtgDepth *ctg_depth, 
+void orgAss(const char* exe_path, const CtgStore* store, CtgDepth *ctg_depth, 
             const char* output_path, const int* contig_ids, 
             int num_contigs, const char* organelle_type, int taxo);
 
@@ -31,99 +31,60 @@ SOFTWARE.
 #include "misc.h"
 #include "log.h"
 #include "graphtools.h"
-#include "khash.h"
-
-
-/*  Function to reverse complement a sequence */
-char *convert_seq(const char *seq, int flag) {
-    uint64_t i;
-    if (flag == 3) {
-        return strdup(seq);
-    } else if (flag == 5) {
-        size_t len = strlen(seq);
-        char *rev_comp = (char *)malloc(len + 1);
-        if (!rev_comp) {
-            fprintf(stderr, "Memory allocation failed\n");
-            exit(EXIT_FAILURE);
-        }
-
-        for (i = 0; i < len; i++) {
-            char base = seq[len - 1 - i]; // Reverse the sequence
-            switch (base) {
-                case 'A': rev_comp[i] = 'T'; break;
-                case 'T': rev_comp[i] = 'A'; break;
-                case 'C': rev_comp[i] = 'G'; break;
-                case 'G': rev_comp[i] = 'C'; break;
-                case 'a': rev_comp[i] = 'T'; break;
-                case 't': rev_comp[i] = 'A'; break;
-                case 'c': rev_comp[i] = 'G'; break;
-                case 'g': rev_comp[i] = 'C'; break;
-                default:  rev_comp[i] = base; break; 
-            }
-        }
-        rev_comp[len] = '\0';
-        return rev_comp;
-    }
-    return NULL;
-}
+#include "ctgstore.h"
 
 
-void path2fa(pathScore *path, int ps_num, khash_t(Ha_nodeseq)* node_seq, const char *output) {
+void path2fa(pathScore *path, int ps_num, const CtgPack* pack, const char *output) {
     FILE *ow = fopen(output, "w");
     if (!ow) {
         fprintf(stderr, "Failed to open output file\n");
         exit(EXIT_FAILURE);
     }
     uint64_t i, j;
+    /* one buffer for all paths, sized from the path lengths */
+    size_t final_cap = 1;
+    for (i = 0; i < ps_num; i++) {
+        if (path[i].path_len + 1 > final_cap) final_cap = path[i].path_len + 1;
+    }
+    char *final_seq = (char *)malloc(final_cap);
+    if (!final_seq) {
+        log_message(ERROR, "Failed to allocate memory for path sequences");
+        fclose(ow);
+        exit(EXIT_FAILURE);
+    }
     for (i = 0; i < ps_num; i++) {
         pathScore *ps = &path[i];
-        char *final_seq = (char *)malloc(1024);
-        if (!final_seq) {
-            log_message(ERROR, "Failed to process path %d", i);
-            fclose(ow);
-            exit(EXIT_FAILURE);
-        }
-        size_t final_len = 0;
 
         int ps_node_num = ps->node_num;
         if (ps->type == 0) {
             ps_node_num--; // Remove the start node
         }
+        size_t final_len = 0;
         for (j = 0; j < ps_node_num; j++) {
             int node_id = ps->path_node[j];
-            int orientation = ps->path_utr[j];
-
-            khiter_t iter = kh_get(Ha_nodeseq, node_seq, node_id);
-            if (iter == kh_end(node_seq)) {
+            uint32_t node_len = ctgpack_len(pack, node_id);
+            if (node_len == 0) {
                 log_message(ERROR, "Node sequence not found for node %d", node_id);
                 fclose(ow);
                 free(final_seq);
                 exit(EXIT_FAILURE);
             }
-            char *nodeseq = kh_value(node_seq, iter);
-            char *converted_seq = convert_seq(nodeseq, orientation);
-            // printf("Converted sequence %s\n", converted_seq);
-            if (!converted_seq) {
-                log_message(ERROR, "Failed to process node %d", node_id);
-                fclose(ow);
-                free(final_seq);
-                exit(EXIT_FAILURE);
-            }
-
-            size_t converted_len = strlen(converted_seq);
-            final_seq = (char *)realloc(final_seq, final_len + converted_len + 1);
+            final_len += node_len;
+        }
+        if (final_len + 1 > final_cap) {
+            final_cap = final_len + 1;
+            final_seq = (char *)realloc(final_seq, final_cap);
             if (!final_seq) {
                 fprintf(stderr, "Memory allocation failed for final_seq\n");
                 fclose(ow);
-                free(converted_seq);
                 exit(EXIT_FAILURE);
             }
-            memcpy(final_seq + final_len, converted_seq, converted_len);
-            final_len += converted_len;
-            final_seq[final_len] = '\0';
-
-            free(converted_seq);
         }
+        final_len = 0;
+        for (j = 0; j < ps_node_num; j++) {
+            final_len += ctgpack_seq(pack, ps->path_node[j], ps->path_utr[j], final_seq + final_len);
+        }
+        final_seq[final_len] = '\0';
 
         size_t buffer_size = 256;
         size_t offset = 0;
@@ -174,10 +135,10 @@ void path2fa(pathScore *path, int ps_num, khash_t(Ha_nodeseq)* node_seq, const c
         // Write to the output file
         fprintf(ow, ">%s\n%s\n", seq_id, final_seq);
 
-        // Clean up memory for this path's final sequence and ID
+        // Clean up memory for this path's ID
         free(seq_id);
-        free(final_seq);
     }
+    free(final_seq);
 
     // Clean up the output file
     fclose(ow);
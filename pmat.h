@@ -52,6 +52,9 @@ typedef struct {
     int8_t taxo;
     int8_t mem;
     int8_t kmersize;
+    double path_time_limit;         // Seconds the M-path searches may take, 0: no limit
+    uint64_t path_max_expansions;   // States one M-path search may expand, 0: no limit
+    int path_beam_width;            // Paths kept at each step of the M-path search of a large structure
 } autoMitoArgs;
 
 
@@ -68,6 +71,9 @@ typedef struct {
     int *seeds;          // Array of seed values
     int seedCount;       // Number of seeds
     int cpu;             // Number of CPUs
+    double path_time_limit;         // Seconds the M-path searches may take, 0: no limit
+    uint64_t path_max_expansions;   // States one M-path search may expand, 0: no limit
+    int path_beam_width;            // Paths kept at each step of the M-path search of a large structure
 } graphBuildArgs;
 
 